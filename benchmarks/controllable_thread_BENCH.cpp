@@ -0,0 +1,71 @@
+
+#include <controllable_thread.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace record_replay {
+namespace bench {
+
+/// @brief Round trip of handing the execution right to one of nr_threads parked threads and
+/// waiting until it has taken its turn, as the Scheduler thread does for every visible
+/// instruction.
+
+static void BM_ControllableThreadHandoff(benchmark::State& state)
+{
+   const auto nr_threads = static_cast<std::size_t>(state.range(0));
+   std::atomic<bool> stop(false);
+   std::vector<std::atomic<unsigned long>> turns(nr_threads);
+   std::vector<std::unique_ptr<scheduler::controllable_thread>> controlled(nr_threads);
+   std::vector<std::atomic<bool>> created(nr_threads);
+   std::vector<std::thread> threads;
+   for (std::size_t index = 0; index < nr_threads; ++index)
+   {
+      turns[index].store(0);
+      created[index].store(false);
+      threads.emplace_back([&, index] {
+         while (!created[index].load())
+            std::this_thread::yield();
+         while (true)
+         {
+            controlled[index]->post_task(false);
+            if (stop.load())
+               break;
+            ++turns[index];
+         }
+      });
+      controlled[index] = std::make_unique<scheduler::controllable_thread>(
+         index, threads.back().native_handle(), std::this_thread::get_id());
+      created[index].store(true);
+   }
+
+   std::size_t index = 0;
+   for (auto _ : state)
+   {
+      const auto turn = turns[index].load();
+      controlled[index]->grant_execution_right();
+      while (turns[index].load() == turn)
+         ;
+      index = (index + 1) % nr_threads;
+   }
+   state.SetItemsProcessed(state.iterations());
+
+   stop.store(true);
+   for (std::size_t index = 0; index < nr_threads; ++index)
+   {
+      controlled[index]->grant_execution_right();
+      threads[index].join();
+   }
+}
+BENCHMARK(BM_ControllableThreadHandoff)->RangeMultiplier(4)->Range(1, 64)->UseRealTime();
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace bench
+} // end namespace record_replay
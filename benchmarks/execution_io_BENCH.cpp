@@ -0,0 +1,115 @@
+
+#include "include/bench_helpers.hpp"
+
+#include <compressed_stream.hpp>
+#include <execution_io.hpp>
+#include <mapped_execution.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <fstream>
+#include <sstream>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace record_replay {
+namespace bench {
+
+/// @brief Writing an Execution of the given length and number of threads to record.txt format.
+
+static void BM_ExecutionWrite(benchmark::State& state)
+{
+   const auto execution = detail::execution(state.range(0), state.range(1));
+   std::size_t bytes = 0;
+   for (auto _ : state)
+   {
+      std::stringstream stream;
+      stream << execution;
+      bytes += stream.tellp();
+   }
+   state.SetBytesProcessed(bytes);
+   state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+BENCHMARK(BM_ExecutionWrite)->RangeMultiplier(4)->Ranges({{2, 32}, {64, 16384}});
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Reading back an Execution written by BM_ExecutionWrite.
+
+static void BM_ExecutionRead(benchmark::State& state)
+{
+   std::stringstream written;
+   written << detail::execution(state.range(0), state.range(1));
+   const auto record = written.str();
+   for (auto _ : state)
+   {
+      std::stringstream stream(record);
+      program_model::Execution execution;
+      stream >> execution;
+      benchmark::DoNotOptimize(execution);
+   }
+   state.SetBytesProcessed(state.iterations() * record.size());
+   state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+BENCHMARK(BM_ExecutionRead)->RangeMultiplier(4)->Ranges({{2, 32}, {64, 16384}});
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Mapping the same Execution written as record.bin and visiting the tid and the enabled
+/// threads of each transition.
+
+static void BM_MappedExecutionRead(benchmark::State& state)
+{
+   const std::string file_name = "execution_io_BENCH.bin";
+   std::size_t bytes = 0;
+   {
+      std::ofstream record(file_name, std::ios::binary);
+      program_model::write_binary(record, detail::execution(state.range(0), state.range(1)));
+      bytes = record.tellp();
+   }
+   for (auto _ : state)
+   {
+      const program_model::mapped_execution execution(file_name);
+      std::size_t visited = 0;
+      for (const auto& transition : execution)
+      {
+         visited += transition.tid() + transition.post().nr_enabled();
+      }
+      benchmark::DoNotOptimize(visited);
+   }
+   state.SetBytesProcessed(state.iterations() * bytes);
+   state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+BENCHMARK(BM_MappedExecutionRead)->RangeMultiplier(4)->Ranges({{2, 32}, {64, 16384}});
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Writing the same Execution to record.txt format compressed, as under trace_codec=lz4,
+/// reporting the compression ratio.
+
+static void BM_CompressedExecutionWrite(benchmark::State& state)
+{
+   const auto execution = detail::execution(state.range(0), state.range(1));
+   std::stringstream written;
+   written << execution;
+   const std::size_t bytes = written.tellp();
+   std::size_t compressed_bytes = 0;
+   for (auto _ : state)
+   {
+      std::stringstream stream;
+      {
+         program_model::compressed_ostream compressed(stream);
+         compressed << execution;
+      }
+      compressed_bytes = stream.tellp();
+   }
+   state.SetBytesProcessed(state.iterations() * bytes);
+   state.SetItemsProcessed(state.iterations() * state.range(1));
+   state.counters["ratio"] = static_cast<double>(bytes) / compressed_bytes;
+}
+BENCHMARK(BM_CompressedExecutionWrite)->RangeMultiplier(4)->Ranges({{2, 32}, {64, 16384}});
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace bench
+} // end namespace record_replay
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <execution.hpp>
+#include <state.hpp>
+#include <visible_instruction.hpp>
+
+#include <memory>
+#include <vector>
+
+
+namespace record_replay {
+namespace bench {
+namespace detail {
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Returns a dummy address for the object with the given index.
+
+inline program_model::Object object(const std::size_t index)
+{
+   using ptr_t = program_model::Object::ptr_t;
+   return program_model::Object(reinterpret_cast<ptr_t>(0x1000 + 8 * index));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Returns an atomic load, so that posting it never disables a thread or reports a data
+/// race and a pool can be cycled indefinitely.
+
+inline program_model::visible_instruction_t load(const program_model::Thread::tid_t tid,
+                                                 const std::size_t object_index)
+{
+   return program_model::memory_instruction(tid, program_model::memory_operation::Load,
+                                            object(object_index), true, {"bench", 1});
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Returns a State in which nr_threads threads are enabled, each with a next instruction.
+
+inline std::shared_ptr<program_model::State> state(const unsigned int nr_threads)
+{
+   program_model::Tids enabled;
+   program_model::NextSet next;
+   for (program_model::Thread::tid_t tid = 0; tid < static_cast<int>(nr_threads); ++tid)
+   {
+      enabled.insert(tid);
+      next.emplace(tid, program_model::next_t{load(tid, tid), true});
+   }
+   return std::make_shared<program_model::State>(enabled, next);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Returns an Execution of the given length, scheduling nr_threads threads round robin.
+
+inline program_model::Execution execution(const unsigned int nr_threads, const unsigned int length)
+{
+   const auto s = state(nr_threads);
+   program_model::Execution execution(s);
+   for (unsigned int index = 0; index < length; ++index)
+   {
+      const program_model::Thread::tid_t tid = index % nr_threads;
+      execution.push_back(load(tid, tid), s);
+   }
+   execution.set_status(program_model::Execution::Status::DONE);
+   return execution;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace detail
+} // end namespace bench
+} // end namespace record_replay
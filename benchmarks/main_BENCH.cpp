@@ -0,0 +1,9 @@
+
+#include "controllable_thread_BENCH.cpp"
+#include "execution_io_BENCH.cpp"
+#include "task_pool_BENCH.cpp"
+
+#include <benchmark/benchmark.h>
+
+
+BENCHMARK_MAIN();
@@ -0,0 +1,199 @@
+
+#include <execution_io.hpp>
+
+#include <replay.hpp>
+#include <scheduler_settings.hpp>
+
+#include <fork.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/preprocessor/stringize.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+/// @file overhead_BENCH.cpp
+/// @brief End-to-end overhead of the instrumentation and the Scheduler: each program is compiled
+/// natively and through scheduler::instrument and both executables are timed, the instrumented
+/// one under each strategy. Usage:
+///
+///    RecordReplayOverheadBench [--benchmark_...] [program.c|program.cpp ...]
+///
+/// Without programs, the programs in tests/test_programs/real_world are measured.
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+namespace record_replay {
+namespace bench {
+namespace detail {
+
+static const auto llvm_bin = boost::filesystem::path(BOOST_PP_STRINGIZE(LLVM_BIN));
+static const auto test_programs_dir =
+   boost::filesystem::path(BOOST_PP_STRINGIZE(TEST_PROGRAMS_DIR));
+static const auto bench_data_dir =
+   boost::filesystem::path(BOOST_PP_STRINGIZE(BENCH_BUILD_DIR)) / "bench_data";
+
+static const auto timeout = std::chrono::milliseconds(60000);
+
+//--------------------------------------------------------------------------------------------------
+
+struct program_data
+{
+   boost::filesystem::path source;
+   std::string compiler_options;
+   boost::filesystem::path native;
+   boost::filesystem::path instrumented;
+
+}; // end struct program_data
+
+//--------------------------------------------------------------------------------------------------
+
+/// @throws std::runtime_error if the program cannot be compiled.
+
+program_data compile(const boost::filesystem::path& source)
+{
+   const bool is_cpp = source.extension() == ".cpp";
+   program_data program{source, is_cpp ? "-std=c++14" : "", {}, {}};
+   const auto output_dir = bench_data_dir / source.filename();
+
+   program.instrumented =
+      scheduler::instrument(source, output_dir / "instrumented", "0", program.compiler_options);
+
+   boost::filesystem::create_directories(output_dir / "native");
+   program.native = output_dir / "native" / source.stem();
+   const std::string command = (llvm_bin / (is_cpp ? "clang++" : "clang")).string() +
+                               " -pthread -O0 " + program.compiler_options + " " +
+                               source.string() + " -o " + program.native.string();
+   if (system(command.c_str()) != 0)
+      throw std::runtime_error("cannot compile " + source.string() + " natively");
+   return program;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+double seconds(const std::function<void()>& run)
+{
+   const auto start = std::chrono::steady_clock::now();
+   run();
+   return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::size_t nr_steps(const boost::filesystem::path& record)
+{
+   program_model::Execution execution;
+   std::ifstream ifs(record.string());
+   ifs >> execution;
+   return execution.size();
+}
+
+} // end namespace detail
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Reports the wall time of the instrumented program as the iteration time, together
+/// with the wall time of the native program, the slowdown, the number of visible instructions
+/// (steps) of the execution, the steps per second and the overhead per step.
+/// @details The number of steps is taken from a first run that records the execution in text
+/// format. The timed runs use trace_format=none, so that they do not include writing the
+/// record (see BM_ExecutionWrite). Random uses a fixed seed, so that all runs follow the same
+/// schedule.
+
+static void BM_Overhead(benchmark::State& state, const detail::program_data& program,
+                        const std::string& strategy)
+{
+   const auto records = detail::bench_data_dir / program.source.filename() / strategy;
+   auto settings = scheduler::SchedulerSettings(strategy);
+   settings.set_seed(0);
+   scheduler::run_under_schedule(program.instrumented, {}, settings, detail::timeout, records);
+   const auto steps = detail::nr_steps(records / "record.txt");
+   settings.set_trace_format(scheduler::trace_format_t::None);
+
+   double native_time = 0;
+   double instrumented_time = 0;
+   for (auto _ : state)
+   {
+      native_time += detail::seconds(
+         [&program] { utils::sys::fork_process(program.native.string(), detail::timeout); });
+      const auto time = detail::seconds([&program, &settings, &records] {
+         scheduler::run_under_schedule(program.instrumented, {}, settings, detail::timeout,
+                                       records);
+      });
+      instrumented_time += time;
+      state.SetIterationTime(time);
+   }
+
+   const double iterations = state.iterations();
+   state.counters["native_time"] = native_time / iterations;
+   state.counters["slowdown"] = instrumented_time / native_time;
+   state.counters["steps"] = steps;
+   state.counters["steps_per_second"] = steps * iterations / instrumented_time;
+   state.counters["overhead_per_step"] =
+      steps > 0 ? (instrumented_time - native_time) / iterations / steps : 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace bench
+} // end namespace record_replay
+
+//--------------------------------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+   using namespace record_replay::bench;
+
+   benchmark::Initialize(&argc, argv);
+
+   std::vector<boost::filesystem::path> sources(argv + 1, argv + argc);
+   if (sources.empty())
+   {
+      for (const auto& entry :
+           boost::filesystem::directory_iterator(detail::test_programs_dir / "real_world"))
+      {
+         const auto extension = entry.path().extension();
+         if (extension == ".c" || extension == ".cpp")
+            sources.push_back(entry.path());
+      }
+      std::sort(sources.begin(), sources.end());
+   }
+
+   // A program that fails to compile is left out, rather than timed as a failing run
+   std::vector<detail::program_data> programs;
+   for (const auto& source : sources)
+   {
+      try
+      {
+         programs.push_back(detail::compile(source));
+      }
+      catch (const std::exception& e)
+      {
+         std::cerr << e.what() << "\n";
+      }
+   }
+   for (const auto& program : programs)
+   {
+      for (const std::string strategy : {"Random", "NonPreemptive"})
+      {
+         const auto name = "BM_Overhead/" + program.source.filename().string() + "/" + strategy;
+         benchmark::RegisterBenchmark(name.c_str(), BM_Overhead, program, strategy)
+            ->UseManualTime()
+            ->Iterations(5)
+            ->Unit(benchmark::kMillisecond);
+      }
+   }
+   benchmark::RunSpecifiedBenchmarks();
+   return 0;
+}
@@ -0,0 +1,82 @@
+
+#include "include/bench_helpers.hpp"
+
+#include <object_state.hpp>
+#include <task_pool.hpp>
+
+#include <benchmark/benchmark.h>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace record_replay {
+namespace bench {
+
+/// @brief One scheduling step on a pool in which every thread has posted: the selected thread's
+/// task becomes current, is performed and the thread posts its next task.
+
+static void BM_TaskPoolStep(benchmark::State& state)
+{
+   const auto nr_threads = static_cast<program_model::Thread::tid_t>(state.range(0));
+   scheduler::TaskPool pool;
+   for (program_model::Thread::tid_t tid = 0; tid < nr_threads; ++tid)
+   {
+      pool.register_thread(tid);
+      pool.post(tid, detail::load(tid, 0));
+   }
+   program_model::Thread::tid_t tid = 0;
+   for (auto _ : state)
+   {
+      benchmark::DoNotOptimize(pool.set_current(tid));
+      pool.yield(tid);
+      pool.post(tid, detail::load(tid, 0));
+      tid = (tid + 1) % nr_threads;
+   }
+   state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TaskPoolStep)->RangeMultiplier(4)->Range(1, 256);
+
+//--------------------------------------------------------------------------------------------------
+
+static void BM_TaskPoolProgramState(benchmark::State& state)
+{
+   const auto nr_threads = static_cast<program_model::Thread::tid_t>(state.range(0));
+   scheduler::TaskPool pool;
+   for (program_model::Thread::tid_t tid = 0; tid < nr_threads; ++tid)
+   {
+      pool.register_thread(tid);
+      pool.post(tid, detail::load(tid, tid));
+   }
+   for (auto _ : state)
+   {
+      benchmark::DoNotOptimize(pool.program_state());
+   }
+   state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TaskPoolProgramState)->RangeMultiplier(4)->Range(1, 256);
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Requests on and performs of a single object on which nr_threads threads wait.
+
+static void BM_ObjectStateRequestPerform(benchmark::State& state)
+{
+   const auto nr_threads = static_cast<program_model::Thread::tid_t>(state.range(0));
+   scheduler::object_state object(detail::object(0));
+   for (program_model::Thread::tid_t tid = 1; tid < nr_threads; ++tid)
+   {
+      object.request(detail::load(tid, 0));
+   }
+   const auto instruction = detail::load(0, 0);
+   for (auto _ : state)
+   {
+      benchmark::DoNotOptimize(object.request(instruction));
+      object.perform(0);
+   }
+   state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ObjectStateRequestPerform)->RangeMultiplier(4)->Range(1, 256);
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace bench
+} // end namespace record_replay
@@ -25,19 +25,64 @@ LightWeightPass::LightWeightPass()
 void LightWeightPass::onStartOfPass(llvm::Module& module)
 {
    mFunctions.initialize(module);
+   mSites.initialize(mFunctions);
+   if (whole_program_instrumentation())
+      mThreadEscape.initialize(module);
 }
 
 //--------------------------------------------------------------------------------------------------
 
 void LightWeightPass::instrumentFunction(llvm::Module& module, llvm::Function& function)
+{
+   mSpinLoops.initialize(function);
+   add_function_entry_and_exit_calls(module, mFunctions, function);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void LightWeightPass::runOnVisibleInstruction(llvm::Module& module, llvm::Function& function,
+                                              llvm::inst_iterator& inst_it,
+                                              const visible_instruction_t& visible_instruction)
+{
+   auto wrapper = concurrency_passes::wrap(module, mFunctions, mSites, mSpinLoops, inst_it);
+   visible_instruction.apply_visitor(wrapper);
+   ++m_nr_instrumented;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool LightWeightPass::isBlackListed(const llvm::Function& function) const
+{
+   return mFunctions.blacklisted(&function);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+const ThreadEscape* LightWeightPass::threadEscape() const
+{
+   return whole_program_instrumentation() ? &mThreadEscape : nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void LightWeightPass::onEndOfPass(llvm::Module& module)
+{
+   mSites.emit(module);
+   add_main_thread_registration(module, mFunctions);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void add_function_entry_and_exit_calls(llvm::Module& module, const Functions& functions,
+                                       llvm::Function& function)
 {
    if (!function.isDeclaration())
    {
       auto* function_name = instrumentation_utils::get_or_create_global_string_ptr(
          module, *inst_begin(function), "_recrep_function_name_" + function.getName().str(),
-         function.getName());
+         function.getName().str());
       // function entry
-      instrumentation_utils::add_call_begin(&function, mFunctions.Wrapper_enter_function(),
+      instrumentation_utils::add_call_begin(&function, functions.Wrapper_enter_function(),
                                             {function_name});
 
       // function exit
@@ -46,14 +91,14 @@ void LightWeightPass::instrumentFunction(llvm::Module& module, llvm::Function& f
          if (llvm::isa<llvm::ReturnInst>(&*inst_it) || llvm::isa<llvm::ResumeInst>(&*inst_it))
          {
             llvm::IRBuilder<> builder(&*inst_it);
-            builder.CreateCall(mFunctions.Wrapper_exit_function(), {function_name}, "");
+            builder.CreateCall(functions.Wrapper_exit_function(), {function_name}, "");
          }
          else if (const auto* call = llvm::dyn_cast<llvm::CallInst>(&*inst_it))
          {
             if (call->getCalledFunction()->getName() == "pthread_exit")
             {
                llvm::IRBuilder<> builder(&*inst_it);
-               builder.CreateCall(mFunctions.Wrapper_exit_function(), {function_name}, "");
+               builder.CreateCall(functions.Wrapper_exit_function(), {function_name}, "");
             }
          }
       }
@@ -62,29 +107,11 @@ void LightWeightPass::instrumentFunction(llvm::Module& module, llvm::Function& f
 
 //--------------------------------------------------------------------------------------------------
 
-void LightWeightPass::runOnVisibleInstruction(llvm::Module& module, llvm::Function& function,
-                                              llvm::inst_iterator inst_it,
-                                              const visible_instruction_t& visible_instruction)
-{
-   auto wrapper = concurrency_passes::wrap(module, mFunctions, inst_it);
-   visible_instruction.apply_visitor(wrapper);
-   ++m_nr_instrumented;
-}
-
-//--------------------------------------------------------------------------------------------------
-
-bool LightWeightPass::isBlackListed(const llvm::Function& function) const
-{
-   return mFunctions.blacklisted(&function);
-}
-
-//--------------------------------------------------------------------------------------------------
-
-void LightWeightPass::onEndOfPass(llvm::Module& module)
+void add_main_thread_registration(llvm::Module& module, const Functions& functions)
 {
    if (auto* main = module.getFunction("main"))
    {
-      instrumentation_utils::add_call_begin(main, mFunctions.Wrapper_register_main_thread(), {});
+      instrumentation_utils::add_call_begin(main, functions.Wrapper_register_main_thread(), {});
    }
 }
 
@@ -3,6 +3,9 @@
 #include "VisibleInstructionPass.hpp"
 #include "functions.hpp"
 #include "llvm_visible_instruction.hpp"
+#include "sites.hpp"
+#include "spin_loops.hpp"
+#include "thread_escape.hpp"
 
 #include <llvm/IR/InstIterator.h>
 
@@ -19,6 +22,9 @@ namespace concurrency_passes {
 /// program with a Scheduler object and wraps visible instructions in handles that
 /// allow the Scheduler to record and/or replay the program under a given thread
 /// interleaving.
+/// @details With -record-replay-whole-program, the module is taken to be the whole program
+/// (e.g. merged by llvm-link or at LTO link time) and only accesses to memory that may be shared
+/// between threads are instrumented (see ThreadEscape).
 
 class LightWeightPass : public VisibleInstructionPass
 {
@@ -32,15 +38,31 @@ public:
    void onStartOfPass(llvm::Module& module) override;
    void instrumentFunction(llvm::Module& module, llvm::Function& function) override;
    void runOnVisibleInstruction(llvm::Module& module, llvm::Function& function,
-                                llvm::inst_iterator inst_it,
+                                llvm::inst_iterator& inst_it,
                                 const visible_instruction_t& visible_instruction) override;
    void onEndOfPass(llvm::Module& module) override;
 
 private:
    bool isBlackListed(const llvm::Function& function) const override;
+   const ThreadEscape* threadEscape() const override;
 
    Functions mFunctions;
+   Sites mSites;
+   SpinLoops mSpinLoops;
+   ThreadEscape mThreadEscape;
 
 }; // end class LightWeightPass
 
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Adds calls to the enter and exit wrappers at the entry and at the exits of function.
+
+void add_function_entry_and_exit_calls(llvm::Module& module, const Functions& functions,
+                                       llvm::Function& function);
+
+/// @brief Registers the main thread with the Scheduler at the entry of main, before the calls
+/// added by add_function_entry_and_exit_calls.
+
+void add_main_thread_registration(llvm::Module& module, const Functions& functions);
+
 } // end namespace concurrency_passes
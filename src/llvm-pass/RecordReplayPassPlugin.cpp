@@ -0,0 +1,370 @@
+
+#include "RecordReplayPassPlugin.hpp"
+
+#include "RecordReplayPass.hpp"
+#include "functions.hpp"
+#include "instrumentation_utils.hpp"
+#include "llvm_visible_instruction.hpp"
+#include "sites.hpp"
+#include "spin_loops.hpp"
+#include "thread_escape.hpp"
+
+#include <llvm/Config/llvm-config.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Metadata.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Passes/PassPlugin.h>
+
+#include <boost/optional.hpp>
+
+#include <vector>
+
+
+namespace concurrency_passes {
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+/// @brief Kind of the metadata attaching the site tables of a function to the function.
+const char* const sites_metadata = "recrep.sites";
+
+/// @brief Name of the named metadata marking a module as instrumented.
+const char* const instrumented_metadata = "recrep.instrumented";
+
+/// @brief Returns the initialized Functions of module, or none if module was already
+/// instrumented, e.g. when the passes run in a ThinLTO backend after instrumenting at compile
+/// time.
+/// @throws std::invalid_argument if module lacks a type the wrappers need.
+
+boost::optional<Functions> initialize_functions(llvm::Module& module)
+{
+   if (module.getNamedMetadata(instrumented_metadata))
+      return boost::none;
+   Functions functions;
+   functions.initialize(module);
+   return functions;
+}
+
+/// @brief Creates the globals that instrumenting function refers to: the name of function, the
+/// file names of its thread management instructions and its site tables.
+/// @return The site tables of function, of size 0 if it has no memory and lock instructions.
+
+Sites::table_t prepare_function(llvm::Module& module, const Functions& functions,
+                               llvm::Function& function)
+{
+   SpinLoops spin_loops;
+   spin_loops.initialize(function);
+   instrumentation_utils::get_or_create_global_string_constant(
+      module, "_recrep_function_name_" + function.getName().str(), function.getName().str());
+
+   Sites sites;
+   sites.initialize(functions);
+   llvm_visible_instruction::creator creator;
+   for (auto& instruction : llvm::instructions(function))
+   {
+      if (const auto visible_instruction = creator.visit(instruction))
+      {
+         auto declare = concurrency_passes::declare_globals(module, functions, sites, spin_loops,
+                                                            instruction);
+         visible_instruction->apply_visitor(declare);
+      }
+   }
+   return sites.declare_tables(module);
+}
+
+/// @brief Instruments function as LightWeightPass does.
+/// @param declared The site tables of function created by prepare_function, or none to create
+/// them.
+/// @return The site tables of function, of size 0 if it has no memory and lock instructions.
+
+Sites::table_t instrument_function(llvm::Module& module, const Functions& functions,
+                                   llvm::Function& function, const ThreadEscape* thread_escape,
+                                   const boost::optional<Sites::table_t>& declared = boost::none)
+{
+   SpinLoops spin_loops;
+   spin_loops.initialize(function);
+   add_function_entry_and_exit_calls(module, functions, function);
+
+   Sites sites;
+   sites.initialize(functions);
+   llvm_visible_instruction::creator creator(thread_escape);
+   for (auto inst_it = llvm::inst_begin(function); inst_it != llvm::inst_end(function); ++inst_it)
+   {
+      if (const auto visible_instruction = creator.visit(*inst_it))
+      {
+         auto wrapper = concurrency_passes::wrap(module, functions, sites, spin_loops, inst_it);
+         visible_instruction->apply_visitor(wrapper);
+      }
+   }
+   if (!declared)
+      return sites.emit_tables(module);
+   sites.emit_prologues(module, *declared);
+   return *declared;
+}
+
+/// @brief Attaches table to function as !recrep.sites metadata.
+
+void set_sites_metadata(llvm::Function& function, const Sites::table_t& table)
+{
+   using namespace llvm;
+   auto& context = function.getContext();
+   function.setMetadata(
+      sites_metadata,
+      MDNode::get(context,
+                  {ConstantAsMetadata::get(table.sites), ConstantAsMetadata::get(table.enabled),
+                   ConstantAsMetadata::get(ConstantInt::get(Type::getInt32Ty(context),
+                                                            table.size))}));
+}
+
+/// @brief Returns the table attached to function as !recrep.sites metadata, or a table of size 0.
+
+Sites::table_t sites_metadata_of(const llvm::Function& function)
+{
+   using namespace llvm;
+   if (const auto* node = function.getMetadata(sites_metadata))
+   {
+      return {mdconst::extract<Constant>(node->getOperand(0)),
+              mdconst::extract<Constant>(node->getOperand(1)),
+              mdconst::extract<ConstantInt>(node->getOperand(2))->getZExtValue()};
+   }
+   return {nullptr, nullptr, 0};
+}
+
+/// @brief Reports error as an error of compiling module, which fails the compilation instead of
+/// leaving module partly instrumented.
+
+void report_error(llvm::Module& module, const std::exception& error)
+{
+   module.getContext().emitError(module.getName() + ": " + error.what());
+}
+
+/// @brief Registers tables and the main thread with the Scheduler and marks module as
+/// instrumented.
+
+void register_with_scheduler(llvm::Module& module, const Functions& functions,
+                             const std::vector<Sites::table_t>& tables)
+{
+   if (!tables.empty())
+      Sites::emit_registration(module, functions, tables);
+   add_main_thread_registration(module, functions);
+   module.getOrInsertNamedMetadata(instrumented_metadata);
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+
+llvm::AnalysisKey LightWeightModuleAnalysis::Key;
+
+LightWeightModuleAnalysis::Result LightWeightModuleAnalysis::run(llvm::Module& module,
+                                                                 llvm::ModuleAnalysisManager&)
+{
+   try
+   {
+      // LightWeightModulePass declared the wrappers, so this only looks them up
+      return {initialize_functions(module)};
+   }
+   catch (const std::exception&)
+   {
+      // LightWeightModulePass reported the error
+      return {boost::none};
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+llvm::PreservedAnalyses LightWeightModulePass::run(llvm::Module& module,
+                                                   llvm::ModuleAnalysisManager& analyses)
+{
+   try
+   {
+      const auto functions = initialize_functions(module);
+      if (!functions)
+         return llvm::PreservedAnalyses::all();
+      for (auto& function : module)
+      {
+         if (function.isDeclaration() || functions->blacklisted(&function))
+            continue;
+         const auto table = prepare_function(module, *functions, function);
+         if (table.size > 0)
+            set_sites_metadata(function, table);
+      }
+   }
+   catch (const std::exception& e)
+   {
+      report_error(module, e);
+      return llvm::PreservedAnalyses::all();
+   }
+   // Cached for LightWeightFunctionPass, which can only get cached module analyses
+   analyses.getResult<LightWeightModuleAnalysis>(module);
+   auto preserved = llvm::PreservedAnalyses::none();
+   preserved.preserve<LightWeightModuleAnalysis>();
+   return preserved;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+llvm::PreservedAnalyses LightWeightFunctionPass::run(llvm::Function& function,
+                                                     llvm::FunctionAnalysisManager& analyses)
+{
+   using namespace llvm;
+   auto& module = *function.getParent();
+   const auto* prepared = analyses.getResult<ModuleAnalysisManagerFunctionProxy>(function)
+                             .getCachedResult<LightWeightModuleAnalysis>(module);
+   // Without LightWeightModulePass, or if it found the module instrumented or invalid
+   if (!prepared || !prepared->functions || function.isDeclaration() ||
+       prepared->functions->blacklisted(&function))
+      return PreservedAnalyses::all();
+
+   try
+   {
+      instrument_function(module, *prepared->functions, function, nullptr,
+                          sites_metadata_of(function));
+   }
+   catch (const std::exception& e)
+   {
+      report_error(module, e);
+      return PreservedAnalyses::all();
+   }
+   return PreservedAnalyses::none();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+llvm::PreservedAnalyses LightWeightRegistrationPass::run(llvm::Module& module,
+                                                         llvm::ModuleAnalysisManager&)
+{
+   using namespace llvm;
+   try
+   {
+      const auto functions = initialize_functions(module);
+      if (!functions)
+         return PreservedAnalyses::all();
+
+      std::vector<Sites::table_t> tables;
+      for (auto& function : module)
+      {
+         const auto table = sites_metadata_of(function);
+         if (table.size > 0)
+         {
+            tables.push_back(table);
+            function.setMetadata(sites_metadata, nullptr);
+         }
+      }
+      register_with_scheduler(module, *functions, tables);
+   }
+   catch (const std::exception& e)
+   {
+      report_error(module, e);
+      return PreservedAnalyses::all();
+   }
+   return PreservedAnalyses::none();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+llvm::PreservedAnalyses LightWeightWholeProgramPass::run(llvm::Module& module,
+                                                         llvm::ModuleAnalysisManager&)
+{
+   try
+   {
+      const auto functions = initialize_functions(module);
+      if (!functions)
+         return llvm::PreservedAnalyses::all();
+
+      ThreadEscape thread_escape;
+      thread_escape.initialize(module);
+
+      std::vector<Sites::table_t> tables;
+      for (auto& function : module)
+      {
+         if (function.isDeclaration() || functions->blacklisted(&function))
+            continue;
+         const auto table = instrument_function(module, *functions, function, &thread_escape);
+         if (table.size > 0)
+            tables.push_back(table);
+      }
+      register_with_scheduler(module, *functions, tables);
+   }
+   catch (const std::exception& e)
+   {
+      report_error(module, e);
+      return llvm::PreservedAnalyses::all();
+   }
+   return llvm::PreservedAnalyses::none();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void add_light_weight_passes(llvm::ModulePassManager& passes)
+{
+   passes.addPass(LightWeightModulePass());
+   passes.addPass(llvm::createModuleToFunctionPassAdaptor(LightWeightFunctionPass()));
+   passes.addPass(LightWeightRegistrationPass());
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace concurrency_passes
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Registers the passes with opt -load-pass-plugin (-passes=instrument-record-replay-lw
+/// or the individual passes) and, with clang -fpass-plugin, at the end of the optimization
+/// pipeline. Like opt -instrument-record-replay-lw on the output of clang -O<level>, this
+/// instruments the optimized IR. With ThinLTO, the end of the optimization pipeline is in the
+/// backends, so the linker has to load the plugin as well.
+/// With -record-replay-whole-program, LightWeightWholeProgramPass instead runs at the end of the
+/// full LTO link-time pipeline (LLVM 15 or later), on the merged module.
+
+extern "C" LLVM_ATTRIBUTE_WEAK llvm::PassPluginLibraryInfo llvmGetPassPluginInfo()
+{
+   using namespace concurrency_passes;
+   return {LLVM_PLUGIN_API_VERSION, "RecordReplayPass", LLVM_VERSION_STRING,
+           [](llvm::PassBuilder& builder) {
+              builder.registerAnalysisRegistrationCallback(
+                 [](llvm::ModuleAnalysisManager& analyses) {
+                    analyses.registerPass([] { return LightWeightModuleAnalysis(); });
+                 });
+              builder.registerPipelineParsingCallback(
+                 [](llvm::StringRef name, llvm::ModulePassManager& passes,
+                    llvm::ArrayRef<llvm::PassBuilder::PipelineElement>) {
+                    if (name == "instrument-record-replay-lw")
+                       add_light_weight_passes(passes);
+                    else if (name == "instrument-record-replay-whole-program")
+                       passes.addPass(LightWeightWholeProgramPass());
+                    else if (name == "record-replay-module")
+                       passes.addPass(LightWeightModulePass());
+                    else if (name == "record-replay-registration")
+                       passes.addPass(LightWeightRegistrationPass());
+                    else
+                       return false;
+                    return true;
+                 });
+              builder.registerPipelineParsingCallback(
+                 [](llvm::StringRef name, llvm::FunctionPassManager& passes,
+                    llvm::ArrayRef<llvm::PassBuilder::PipelineElement>) {
+                    if (name != "record-replay-function")
+                       return false;
+                    passes.addPass(LightWeightFunctionPass());
+                    return true;
+                 });
+              builder.registerOptimizerLastEPCallback([](llvm::ModulePassManager& passes, auto) {
+                 if (!whole_program_instrumentation())
+                    add_light_weight_passes(passes);
+              });
+#if LLVM_VERSION_MAJOR >= 15
+              builder.registerFullLinkTimeOptimizationLastEPCallback(
+                 [](llvm::ModulePassManager& passes, auto) {
+                    if (whole_program_instrumentation())
+                       passes.addPass(LightWeightWholeProgramPass());
+                 });
+#endif
+           }};
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "functions.hpp"
+
+#include <llvm/IR/PassManager.h>
+
+#include <boost/optional.hpp>
+
+//--------------------------------------------------------------------------------------------------
+/// @file RecordReplayPassPlugin.hpp
+/// @brief LightWeightPass for the new pass manager, loadable with clang -fpass-plugin.
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+namespace concurrency_passes {
+
+/// @brief The Functions of a module prepared by LightWeightModulePass, or none if the module was
+/// already instrumented or cannot be instrumented.
+/// @details Function passes can only get cached module analyses, so LightWeightModulePass
+/// computes it once the wrappers are declared, and LightWeightFunctionPass uses the cached
+/// result.
+
+class LightWeightModuleAnalysis : public llvm::AnalysisInfoMixin<LightWeightModuleAnalysis>
+{
+public:
+   struct Result
+   {
+      boost::optional<Functions> functions;
+
+      /// @brief The declared wrappers stay valid while the functions are instrumented, which
+      /// the module analysis manager requires of the results that function passes use.
+
+      bool invalidate(llvm::Module&, const llvm::PreservedAnalyses&,
+                      llvm::ModuleAnalysisManager::Invalidator&)
+      {
+         return false;
+      }
+   };
+
+   Result run(llvm::Module& module, llvm::ModuleAnalysisManager&);
+
+private:
+   friend llvm::AnalysisInfoMixin<LightWeightModuleAnalysis>;
+   static llvm::AnalysisKey Key;
+
+}; // end class LightWeightModuleAnalysis
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Module pre-pass making all module-level changes the instrumentation of the functions
+/// needs: it declares the wrappers of the scheduler library (Functions::initialize) and creates
+/// the global strings and the site tables of every function. The tables are attached to their
+/// function as !recrep.sites metadata.
+
+class LightWeightModulePass : public llvm::PassInfoMixin<LightWeightModulePass>
+{
+public:
+   llvm::PreservedAnalyses run(llvm::Module& module, llvm::ModuleAnalysisManager&);
+
+   /// @brief Also run on optnone functions, i.e. at -O0.
+
+   static bool isRequired() { return true; }
+
+}; // end class LightWeightModulePass
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Instruments the visible instructions of a function and its entry and exits, like
+/// LightWeightPass does for each function of a module.
+/// @details Only rewrites the instructions of the function, looking up the wrappers in the cached
+/// LightWeightModuleAnalysis and the globals LightWeightModulePass created. The prologues of the
+/// function's memory and lock instructions read the site tables in its !recrep.sites metadata, so
+/// that functions are instrumented independently of each other. Does nothing unless
+/// LightWeightModulePass ran before.
+
+class LightWeightFunctionPass : public llvm::PassInfoMixin<LightWeightFunctionPass>
+{
+public:
+   llvm::PreservedAnalyses run(llvm::Function& function, llvm::FunctionAnalysisManager&);
+
+   static bool isRequired() { return true; }
+
+}; // end class LightWeightFunctionPass
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Module post-pass registering the main thread and the site tables of the functions with
+/// the Scheduler, and marking the module as instrumented.
+
+class LightWeightRegistrationPass : public llvm::PassInfoMixin<LightWeightRegistrationPass>
+{
+public:
+   llvm::PreservedAnalyses run(llvm::Module& module, llvm::ModuleAnalysisManager&);
+
+   static bool isRequired() { return true; }
+
+}; // end class LightWeightRegistrationPass
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Instruments a whole program, i.e. the merged module at full LTO link time or the output
+/// of llvm-link, only instrumenting memory accesses that ThreadEscape finds may be shared.
+/// @details The thread-escape analysis needs the whole module, so this is a single module pass
+/// doing what the pre-pass, the function pass and the post-pass do.
+
+class LightWeightWholeProgramPass : public llvm::PassInfoMixin<LightWeightWholeProgramPass>
+{
+public:
+   llvm::PreservedAnalyses run(llvm::Module& module, llvm::ModuleAnalysisManager&);
+
+   static bool isRequired() { return true; }
+
+}; // end class LightWeightWholeProgramPass
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Adds the pre-pass, the function pass and the post-pass to passes.
+
+void add_light_weight_passes(llvm::ModulePassManager& passes);
+
+} // end namespace concurrency_passes
@@ -49,7 +49,7 @@ bool VisibleInstructionPass::runOnFunction(llvm::Module& module, llvm::Function&
    if (!isBlackListed(function))
    {
       instrumentFunction(module, function);
-      llvm_visible_instruction::creator creator;
+      llvm_visible_instruction::creator creator(threadEscape());
       for (auto inst_it = inst_begin(function); inst_it != inst_end(function); ++inst_it)
       {
          auto& instruction = *inst_it;
@@ -72,4 +72,11 @@ bool VisibleInstructionPass::isBlackListed(const llvm::Function& function) const
 
 //--------------------------------------------------------------------------------------------------
 
+const ThreadEscape* VisibleInstructionPass::threadEscape() const
+{
+   return nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+
 } // end namespace concurrency_passes
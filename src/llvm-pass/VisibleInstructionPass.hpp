@@ -21,6 +21,11 @@ class Module;
 
 namespace concurrency_passes {
 
+// Forward declarations
+class ThreadEscape;
+
+//--------------------------------------------------------------------------------------------------
+
 class VisibleInstructionPass : public llvm::ModulePass
 {
 public:
@@ -28,8 +33,11 @@ public:
 
    virtual void onStartOfPass(llvm::Module& module) = 0;
    virtual void instrumentFunction(llvm::Module& module, llvm::Function& function) = 0;
+   /// @param inst_it Points to the visible instruction, and may be moved to an instruction
+   /// replacing it.
+
    virtual void runOnVisibleInstruction(llvm::Module& module, llvm::Function& function,
-                                        llvm::inst_iterator inst_it,
+                                        llvm::inst_iterator& inst_it,
                                         const visible_instruction_t& visible_instruction) = 0;
    virtual void onEndOfPass(llvm::Module& module) = 0;
 
@@ -42,6 +50,11 @@ private:
 
    virtual bool isBlackListed(const llvm::Function& function) const;
 
+   /// @brief The analysis by which memory instructions accessing thread-local memory are not
+   /// visible, or nullptr if all memory instructions are.
+
+   virtual const ThreadEscape* threadEscape() const;
+
    /// @brief The number of visible instructions encountered during the pass.
    unsigned int m_nr_visible_instructions;
 
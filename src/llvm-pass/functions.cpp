@@ -3,6 +3,7 @@
 
 #include "instrumentation_utils.hpp"
 
+#include <llvm/Config/llvm-config.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Module.h>
 #include <llvm/Support/raw_ostream.h>
@@ -14,7 +15,43 @@ namespace concurrency_passes {
 
 //-----------------------------------------------------------------------------------------------
 
-Functions::Functions() = default;
+namespace {
+
+llvm::StructType* get_struct_type(const llvm::Module& module, const std::string& name)
+{
+#if LLVM_VERSION_MAJOR >= 12
+   return llvm::StructType::getTypeByName(module.getContext(), name);
+#else
+   return module.getTypeByName(name);
+#endif
+}
+
+/// @brief Returns the type of pthread_t: the type of the first parameter of pthread_join if
+/// module declares it, or else a pointer to struct _opaque_pthread_t on macOS, or else an
+/// integer as wide as a pointer, as the unsigned long of glibc.
+
+llvm::Type* get_pthread_type(const llvm::Module& module)
+{
+   for (const auto* name : {"pthread_join", "\01_pthread_join"})
+   {
+      const auto* pthread_join = module.getFunction(name);
+      if (pthread_join && pthread_join->arg_size() > 0)
+         return pthread_join->getFunctionType()->getParamType(0);
+   }
+   if (auto* type_opaque_pthread = get_struct_type(module, "struct._opaque_pthread_t"))
+      return type_opaque_pthread->getPointerTo();
+   return module.getDataLayout().getIntPtrType(module.getContext());
+}
+
+} // end namespace
+
+//-----------------------------------------------------------------------------------------------
+
+Functions::Functions()
+: m_instrumentation_site(nullptr)
+, m_thread_uncontrolled(nullptr)
+{
+}
 
 //-----------------------------------------------------------------------------------------------
 
@@ -39,20 +76,26 @@ void Functions::initialize(llvm::Module& module)
    Type* type_char_ptr = builder.getInt8PtrTy();
 
    // pthread_t
-   Type* type_opaque_pthread = module.getTypeByName("struct._opaque_pthread_t");
-   if (!type_opaque_pthread)
-   {
-      throw std::invalid_argument("Type opaque_pthread_t not found in module");
-   }
-
-   m_types.insert({"pthread_t", type_opaque_pthread->getPointerTo()});
+   m_types.insert({"pthread_t", get_pthread_type(module)});
    Type* type_pthread_id = m_types["pthread_t"]->getPointerTo();
 
-   // std::thread
-   Type* type_stdthread = module.getTypeByName("class.std::__1::thread");
-   if (type_stdthread)
+   // scheduler::instrumentation_site, created by an earlier initialize if this is not the first
+   m_instrumentation_site = get_struct_type(module, "struct.recrep_site");
+   if (!m_instrumentation_site)
+      m_instrumentation_site = StructType::create(
+         module.getContext(),
+         {builder.getInt64Ty(), builder.getInt8Ty(), builder.getInt8Ty(), builder.getInt32Ty(),
+          type_char_ptr, builder.getInt32Ty(), type_char_ptr, type_char_ptr},
+         "struct.recrep_site");
+   Type* type_site_ptr = m_instrumentation_site->getPointerTo();
+
+   // wrapper_thread_uncontrolled
+   m_thread_uncontrolled = module.getGlobalVariable("wrapper_thread_uncontrolled");
+   if (!m_thread_uncontrolled)
    {
-      m_types.insert({"std::thread", type_stdthread});
+      m_thread_uncontrolled = new GlobalVariable(
+         module, builder.getInt8Ty(), false, GlobalValue::ExternalLinkage, nullptr,
+         "wrapper_thread_uncontrolled", nullptr, GlobalValue::InitialExecTLSModel);
    }
 
    // Wrapper_register_main_thread
@@ -81,31 +124,48 @@ void Functions::initialize(llvm::Module& module)
       add_wrapper_prototype(module, "wrapper_post_pthread_join_instruction", type, attributes);
    }
 
-   // wrapper_post_stdthread_join_instruction
-   if (type_stdthread)
+   // wrapper_post_stdthread_join_instruction, taking the std::thread of libc++ or libstdc++
    {
       auto* type = FunctionType::get(
-         void_type, {type_stdthread->getPointerTo(), type_char_ptr, builder.getInt32Ty()}, false);
+         void_type, {void_ptr_type, type_char_ptr, builder.getInt32Ty()}, false);
       add_wrapper_prototype(module, "wrapper_post_stdthread_join_instruction", type, attributes);
    }
 
    // wrapper_post_lock_instruction
    {
-      auto* type = FunctionType::get(
-         void_type, {builder.getInt32Ty(), void_ptr_type, type_char_ptr, builder.getInt32Ty()},
-         false);
+      auto* type = FunctionType::get(void_type, {void_ptr_type, type_site_ptr}, false);
       add_wrapper_prototype(module, "wrapper_post_lock_instruction", type, attributes);
    }
 
-   // wrapper_post_memory_instruction
+   // wrapper_pthread_cond_wait
    {
-      auto* type = FunctionType::get(void_type,
-                                     {builder.getInt32Ty(), void_ptr_type, builder.getInt8Ty(),
-                                      type_char_ptr, builder.getInt32Ty()},
+      auto* type = FunctionType::get(builder.getInt32Ty(),
+                                     {void_ptr_type, void_ptr_type, type_char_ptr,
+                                      builder.getInt32Ty()},
                                      false);
+      add_wrapper_prototype(module, "wrapper_pthread_cond_wait", type, attributes);
+   }
+
+   // wrapper_stdcondvar_wait
+   {
+      auto* type = FunctionType::get(
+         void_type, {void_ptr_type, void_ptr_type, type_char_ptr, builder.getInt32Ty()}, false);
+      add_wrapper_prototype(module, "wrapper_stdcondvar_wait", type, attributes);
+   }
+
+   // wrapper_post_memory_instruction
+   {
+      auto* type = FunctionType::get(void_type, {void_ptr_type, type_site_ptr}, false);
       add_wrapper_prototype(module, "wrapper_post_memory_instruction", type, attributes);
    }
 
+   // wrapper_register_sites
+   {
+      auto* type = FunctionType::get(
+         void_type, {type_site_ptr, builder.getInt8PtrTy(), builder.getInt32Ty()}, false);
+      add_wrapper_prototype(module, "wrapper_register_sites", type, attributes);
+   }
+
    // wrapper_enter_function
    {
       auto* type = FunctionType::get(void_type, {type_char_ptr}, false);
@@ -127,7 +187,12 @@ void Functions::add_wrapper_prototype(llvm::Module& module, const std::string& n
                                       llvm::FunctionType* type, llvm::AttributeList& attributes)
 {
    using namespace llvm;
+#if LLVM_VERSION_MAJOR >= 9
+   Function* function =
+      cast<Function>(module.getOrInsertFunction(name, type, attributes).getCallee());
+#else
    Function* function = cast<Function>(module.getOrInsertFunction(name, type, attributes));
+#endif
    m_wrappers.insert(function_map_t::value_type(name, function));
    m_black_listed.insert(function->getName().str());
 }
@@ -169,6 +234,20 @@ llvm::Function* Functions::Wrapper_post_stdthread_join_instruction() const
 
 //-----------------------------------------------------------------------------------------------
 
+llvm::Function* Functions::Wrapper_pthread_cond_wait() const
+{
+   return m_wrappers.find("wrapper_pthread_cond_wait")->second;
+}
+
+//-----------------------------------------------------------------------------------------------
+
+llvm::Function* Functions::Wrapper_stdcondvar_wait() const
+{
+   return m_wrappers.find("wrapper_stdcondvar_wait")->second;
+}
+
+//-----------------------------------------------------------------------------------------------
+
 llvm::Function* Functions::Wrapper_register_main_thread() const
 {
    return m_wrappers.find("wrapper_register_main_thread")->second;
@@ -197,9 +276,17 @@ llvm::Function* Functions::Wrapper_exit_function() const
 
 //-----------------------------------------------------------------------------------------------
 
+llvm::Function* Functions::Wrapper_register_sites() const
+{
+   return m_wrappers.find("wrapper_register_sites")->second;
+}
+
+//-----------------------------------------------------------------------------------------------
+
 llvm::Function* Functions::Function_pthread_create() const
 {
-   return m_c_functions.find("pthread_create")->second;
+   const auto it = m_c_functions.find("pthread_create");
+   return it == m_c_functions.end() ? nullptr : it->second;
 }
 
 //-----------------------------------------------------------------------------------------------
@@ -211,33 +298,35 @@ llvm::Type* Functions::Type_pthread_t() const
 
 //-----------------------------------------------------------------------------------------------
 
-llvm::Type* Functions::Type_stdthread() const
+llvm::StructType* Functions::Type_instrumentation_site() const
 {
-   const auto it = m_types.find("std::thread");
-   if (it == m_types.end())
-      throw std::runtime_error("Type std::thread not found in this module");
-   return it->second;
+   return m_instrumentation_site;
+}
+
+//-----------------------------------------------------------------------------------------------
+
+llvm::GlobalVariable* Functions::Global_thread_uncontrolled() const
+{
+   return m_thread_uncontrolled;
 }
 
 //-----------------------------------------------------------------------------------------------
 
 bool Functions::blacklisted(const llvm::Function* function) const
 {
-   return m_c_functions.find(function->getName()) != m_c_functions.end() ||
-          m_black_listed.find(function->getName()) != m_black_listed.end();
+   const auto name = function->getName().str();
+   return m_c_functions.find(name) != m_c_functions.end() ||
+          m_black_listed.find(name) != m_black_listed.end();
 }
 
 //-----------------------------------------------------------------------------------------------
 
 void Functions::register_c_function(const llvm::Module& module, const std::string& name)
 {
-   llvm::Function* function = llvm::cast<llvm::Function>(module.getFunction(name));
-   if (function)
-   {
+   // A translation unit that does not spawn threads, or only through libstdc++'s std::thread,
+   // does not declare pthread_create
+   if (llvm::Function* function = module.getFunction(name))
       m_c_functions.insert(function_map_t::value_type(name, function));
-      return;
-   }
-   throw std::invalid_argument("C function " + name + " not found in module");
 }
 
 //-----------------------------------------------------------------------------------------------
@@ -18,7 +18,9 @@ namespace llvm {
 class AttributeSet;
 class Function;
 class FunctionType;
+class GlobalVariable;
 class Module;
+class StructType;
 class Type;
 } // end namespace llvm
 
@@ -33,6 +35,9 @@ public:
 
    Functions();
 
+   /// @brief Looks up the types of module and the wrappers of the scheduler library, declaring
+   /// the wrappers if module does not declare them yet.
+
    void initialize(llvm::Module& module);
 
    llvm::Function* Wrapper_post_lock_instruction() const;
@@ -40,15 +45,30 @@ public:
    llvm::Function* Wrapper_post_spawn_instruction() const;
    llvm::Function* Wrapper_post_pthread_join_instruction() const;
    llvm::Function* Wrapper_post_stdthread_join_instruction() const;
+   llvm::Function* Wrapper_pthread_cond_wait() const;
+   llvm::Function* Wrapper_stdcondvar_wait() const;
    llvm::Function* Wrapper_register_main_thread() const;
    llvm::Function* Wrapper_register_thread() const;
    llvm::Function* Wrapper_enter_function() const;
    llvm::Function* Wrapper_exit_function() const;
+   llvm::Function* Wrapper_register_sites() const;
+
+   /// @brief pthread_create, or nullptr if module does not declare it.
 
    llvm::Function* Function_pthread_create() const;
 
+   /// @brief pthread_t: a pointer to struct _opaque_pthread_t on macOS, an integer under glibc.
+
    llvm::Type* Type_pthread_t() const;
-   llvm::Type* Type_stdthread() const;
+
+   /// @brief The type of the site descriptors passed to the memory and lock wrappers
+   /// (scheduler::instrumentation_site).
+
+   llvm::StructType* Type_instrumentation_site() const;
+
+   /// @brief The thread-local flag wrapper_thread_uncontrolled of the scheduler library.
+
+   llvm::GlobalVariable* Global_thread_uncontrolled() const;
 
    bool blacklisted(const llvm::Function* F) const;
 
@@ -61,6 +81,9 @@ private:
    function_map_t m_wrappers;
    function_map_t m_c_functions;
 
+   llvm::StructType* m_instrumentation_site;
+   llvm::GlobalVariable* m_thread_uncontrolled;
+
    std::set<std::string> m_black_listed;
 
 }; // end class Functions
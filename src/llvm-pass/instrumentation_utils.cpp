@@ -27,6 +27,27 @@ llvm::Value* get_or_create_global_string_ptr(llvm::Module& module, llvm::Instruc
 
 //--------------------------------------------------------------------------------------------------
 
+llvm::Constant* get_or_create_global_string_constant(llvm::Module& module,
+                                                     const std::string& variable_name,
+                                                     const std::string& str)
+{
+   llvm::GlobalVariable* global_variable = module.getGlobalVariable(variable_name, true);
+   if (!global_variable)
+   {
+      auto* contents = llvm::ConstantDataArray::getString(module.getContext(), str);
+      global_variable =
+         new llvm::GlobalVariable(module, contents->getType(), true,
+                                  llvm::GlobalValue::PrivateLinkage, contents, variable_name);
+      global_variable->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+   }
+   llvm::Constant* zero = llvm::ConstantInt::get(llvm::Type::getInt32Ty(module.getContext()), 0);
+   return llvm::ConstantExpr::getInBoundsGetElementPtr(global_variable->getValueType(),
+                                                       global_variable,
+                                                       llvm::ArrayRef<llvm::Constant*>{zero, zero});
+}
+
+//--------------------------------------------------------------------------------------------------
+
 llvm::CallInst* add_call_begin(llvm::Function* F, llvm::Function* callee,
                                const llvm::ArrayRef<llvm::Value*>& args,
                                const std::string& call_name)
@@ -14,6 +14,7 @@
 
 namespace llvm {
 class CallInst;
+class Constant;
 class Function;
 class Instruction;
 class Module;
@@ -27,6 +28,13 @@ llvm::Value* get_or_create_global_string_ptr(llvm::Module& module, llvm::Instruc
                                              const std::string& variable_name,
                                              const std::string& str);
 
+/// @brief Returns a constant pointer to the first character of the global string variable_name,
+/// creating it with contents str if the module does not have it yet.
+
+llvm::Constant* get_or_create_global_string_constant(llvm::Module& module,
+                                                     const std::string& variable_name,
+                                                     const std::string& str);
+
 /// @brief Add a call to callee at the beginning of function F.
 
 llvm::CallInst* add_call_begin(llvm::Function* F, llvm::Function* callee,
@@ -0,0 +1,244 @@
+
+#include "instrumenter.hpp"
+
+#include "RecordReplayPass.hpp"
+
+#include <clang/Basic/CodeGenOptions.h>
+#include <clang/Basic/DiagnosticOptions.h>
+#include <clang/Basic/TargetOptions.h>
+#include <clang/CodeGen/CodeGenAction.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/CompilerInvocation.h>
+#include <clang/Frontend/Utils.h>
+
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/ADT/StringSwitch.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/TargetRegistry.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Target/TargetOptions.h>
+
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+
+namespace concurrency_passes {
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+void initialize_native_target()
+{
+   static std::once_flag initialized;
+   std::call_once(initialized, [] {
+      llvm::InitializeNativeTarget();
+      llvm::InitializeNativeTargetAsmPrinter();
+      llvm::InitializeNativeTargetAsmParser();
+   });
+}
+
+//--------------------------------------------------------------------------------------------------
+
+llvm::CodeGenOpt::Level codegen_level(const clang::CodeGenOptions& codegen_options)
+{
+   switch (codegen_options.OptimizationLevel)
+   {
+      case 0: return llvm::CodeGenOpt::None;
+      case 1: return llvm::CodeGenOpt::Less;
+      case 3: return llvm::CodeGenOpt::Aggressive;
+      default: return llvm::CodeGenOpt::Default;
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief The code model of -mcmodel, or none for the target's default (as in clang's
+/// BackendUtil).
+
+llvm::Optional<llvm::CodeModel::Model> code_model(const clang::CodeGenOptions& codegen_options)
+{
+   const auto model = llvm::StringSwitch<unsigned>(codegen_options.CodeModel)
+                         .Case("tiny", llvm::CodeModel::Tiny)
+                         .Case("small", llvm::CodeModel::Small)
+                         .Case("kernel", llvm::CodeModel::Kernel)
+                         .Case("medium", llvm::CodeModel::Medium)
+                         .Case("large", llvm::CodeModel::Large)
+                         .Default(~0u);
+   if (model == ~0u)
+      return llvm::None;
+   return static_cast<llvm::CodeModel::Model>(model);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief The subset of clang's TargetOptions setup (initTargetOptions in BackendUtil) that
+/// affects the object files of ordinary C and C++ programs.
+
+llvm::TargetOptions target_options(const clang::CompilerInvocation& invocation)
+{
+   const auto& codegen_options = invocation.getCodeGenOpts();
+   const auto& clang_target_options = invocation.getTargetOpts();
+   llvm::TargetOptions options;
+   options.FloatABIType = llvm::StringSwitch<llvm::FloatABI::ABIType>(codegen_options.FloatABI)
+                             .Case("soft", llvm::FloatABI::Soft)
+                             .Case("softfp", llvm::FloatABI::Soft)
+                             .Case("hard", llvm::FloatABI::Hard)
+                             .Default(llvm::FloatABI::Default);
+   options.UseInitArray = codegen_options.UseInitArray;
+   options.FunctionSections = codegen_options.FunctionSections;
+   options.DataSections = codegen_options.DataSections;
+   options.UniqueSectionNames = codegen_options.UniqueSectionNames;
+   options.EmulatedTLS = codegen_options.EmulatedTLS;
+   options.ExplicitEmulatedTLS = codegen_options.ExplicitEmulatedTLS;
+   options.MCOptions.ABIName = clang_target_options.ABI;
+   return options;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief The invocation of clang -g -pthread -c on source.
+
+std::shared_ptr<clang::CompilerInvocation> create_invocation(const boost::filesystem::path& source,
+                                                             const instrumenter_options& options)
+{
+   std::vector<std::string> arguments = {options.compiler.string(), "-g", "-pthread",
+                                         "-O" + options.optimization_level};
+   arguments.insert(arguments.end(), options.compiler_options.begin(),
+                    options.compiler_options.end());
+   arguments.insert(arguments.end(), {"-c", source.string()});
+   std::vector<const char*> argv;
+   for (const auto& argument : arguments)
+   {
+      argv.push_back(argument.c_str());
+   }
+
+   llvm::IntrusiveRefCntPtr<clang::DiagnosticOptions> diagnostic_options =
+      new clang::DiagnosticOptions();
+   llvm::IntrusiveRefCntPtr<clang::DiagnosticsEngine> diagnostics =
+      clang::CompilerInstance::createDiagnostics(diagnostic_options.get());
+
+   std::shared_ptr<clang::CompilerInvocation> invocation =
+      clang::createInvocationFromCommandLine(argv, diagnostics);
+   if (!invocation)
+   {
+      throw std::runtime_error("invalid compiler invocation for " + source.string());
+   }
+   return invocation;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Parses source into a module the way "clang -emit-llvm" with the given invocation would.
+/// @note Completes the target options of the invocation (e.g. the target features).
+
+std::unique_ptr<llvm::Module> compile_to_module(
+   const boost::filesystem::path& source,
+   const std::shared_ptr<clang::CompilerInvocation>& invocation, llvm::LLVMContext& context)
+{
+   clang::CompilerInstance compiler;
+   compiler.setInvocation(invocation);
+   compiler.createDiagnostics();
+   clang::EmitLLVMOnlyAction action(&context);
+   if (!compiler.ExecuteAction(action))
+   {
+      throw std::runtime_error("compiling " + source.string() + " failed");
+   }
+   return action.takeModule();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void dump_module(const llvm::Module& module, const boost::filesystem::path& object)
+{
+   auto dump = object;
+   dump.replace_extension(".txt");
+   std::error_code error;
+   llvm::raw_fd_ostream os(dump.string(), error, llvm::sys::fs::F_Text);
+   if (error)
+   {
+      throw std::runtime_error("writing " + dump.string() + ": " + error.message());
+   }
+   module.print(os, nullptr);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Emits the module as clang would with the given invocation, i.e. for the CPU, features,
+/// relocation and code model it compiled the module for.
+
+void emit_object(llvm::Module& module, const boost::filesystem::path& object,
+                 const clang::CompilerInvocation& invocation)
+{
+   initialize_native_target();
+   const auto& codegen_options = invocation.getCodeGenOpts();
+   const auto& clang_target_options = invocation.getTargetOpts();
+   const std::string& triple = clang_target_options.Triple;
+   std::string lookup_error;
+   const auto* target = llvm::TargetRegistry::lookupTarget(triple, lookup_error);
+   if (!target)
+   {
+      throw std::runtime_error(lookup_error);
+   }
+   std::unique_ptr<llvm::TargetMachine> machine(target->createTargetMachine(
+      triple, clang_target_options.CPU, llvm::join(clang_target_options.Features, ","),
+      target_options(invocation), codegen_options.RelocationModel, code_model(codegen_options),
+      codegen_level(codegen_options)));
+   // The module keeps the data layout clang compiled it for
+   if (module.getDataLayout() != machine->createDataLayout())
+   {
+      throw std::runtime_error("data layout of " + module.getModuleIdentifier() +
+                               " does not match target " + triple);
+   }
+
+   std::error_code error;
+   llvm::raw_fd_ostream os(object.string(), error, llvm::sys::fs::F_None);
+   if (error)
+   {
+      throw std::runtime_error("writing " + object.string() + ": " + error.message());
+   }
+   llvm::legacy::PassManager pass_manager;
+   if (machine->addPassesToEmitFile(pass_manager, os, llvm::TargetMachine::CGFT_ObjectFile))
+   {
+      throw std::runtime_error("target " + triple + " cannot emit object files");
+   }
+   pass_manager.run(module);
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+
+void compile_instrumented_object(const boost::filesystem::path& source,
+                                 const boost::filesystem::path& object,
+                                 const instrumenter_options& options)
+{
+   llvm::LLVMContext context;
+   const auto invocation = create_invocation(source, options);
+   auto module = compile_to_module(source, invocation, context);
+
+   llvm::legacy::PassManager pass_manager;
+   pass_manager.add(new LightWeightPass());
+   pass_manager.run(*module);
+   if (llvm::verifyModule(*module, &llvm::errs()))
+   {
+      throw std::runtime_error("instrumented module of " + source.string() + " is invalid");
+   }
+
+   if (options.dump_ir)
+   {
+      dump_module(*module, object);
+   }
+   emit_object(*module, object, *invocation);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace concurrency_passes
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <boost/filesystem/path.hpp>
+
+#include <string>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+/// @file instrumenter.hpp
+/// @brief In-process compilation of a program into an instrumented object file.
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+namespace concurrency_passes {
+
+struct instrumenter_options
+{
+   /// @brief The clang or clang++ executable whose driver interprets the arguments and whose
+   /// resource directory provides the builtin headers.
+   boost::filesystem::path compiler;
+
+   /// @brief The level passed to clang as -O<optimization_level>, also used for code generation.
+   std::string optimization_level = "0";
+
+   /// @brief Further clang arguments, e.g. -std=c++14.
+   std::vector<std::string> compiler_options;
+
+   /// @brief Whether to write the instrumented module as text next to the object file.
+   bool dump_ir = false;
+
+}; // end struct instrumenter_options
+
+/// @brief Compiles source with clang, runs LightWeightPass on the resulting module and emits an
+/// object file, all in-process on a single parsed module. With options.dump_ir, the instrumented
+/// module is also written to object with extension .txt.
+/// @throws std::runtime_error if a step fails, after its diagnostics were printed to stderr.
+
+void compile_instrumented_object(const boost::filesystem::path& source,
+                                 const boost::filesystem::path& object,
+                                 const instrumenter_options& options);
+
+} // end namespace concurrency_passes
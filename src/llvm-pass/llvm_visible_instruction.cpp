@@ -3,6 +3,9 @@
 
 #include "functions.hpp"
 #include "instrumentation_utils.hpp"
+#include "sites.hpp"
+#include "spin_loops.hpp"
+#include "thread_escape.hpp"
 
 #include "visible_instruction_io.hpp"
 
@@ -11,17 +14,80 @@
 #include <llvm/IR/DebugInfoMetadata.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/Support/raw_ostream.h>
+#include <llvm/Transforms/Utils/BasicBlockUtils.h>
 
 #include <assert.h>
+#include <unordered_map>
 
 
 namespace concurrency_passes {
 
 //--------------------------------------------------------------------------------------------------
 
-wrap::wrap(llvm::Module& module, Functions& functions, llvm::inst_iterator& instruction_it)
+namespace {
+
+/// @brief Returns the name of function without the "\01_" prefix of a macOS symbol alias, e.g.
+/// of "\01_sem_wait" for sem_wait.
+
+llvm::StringRef unaliased_name(const llvm::Function& function)
+{
+   const auto name = function.getName();
+   return name.startswith("\01_") ? name.drop_front(2) : name;
+}
+
+/// @brief Returns the function that instruction, a call or invoke, calls directly, or nullptr.
+
+const llvm::Function* called_function(const llvm::Instruction& instruction)
+{
+   if (const auto* call = llvm::dyn_cast<llvm::CallInst>(&instruction))
+      return call->getCalledFunction();
+   if (const auto* invoke = llvm::dyn_cast<llvm::InvokeInst>(&instruction))
+      return invoke->getCalledFunction();
+   return nullptr;
+}
+
+const std::string file_name_prefix = "_recrep_file_name_";
+
+/// @brief Adds the site of a memory instruction and, if it is a Load spinning in a loop, the
+/// Await site at the back edge of the loop.
+
+void add_memory_sites(llvm::Module& module, const Functions& functions, Sites& sites,
+                      const SpinLoops& spin_loops, llvm::Instruction& instruction,
+                      llvm::Value* operand, const memory_instruction& memory)
+{
+   sites.add(module, instruction, functions.Wrapper_post_memory_instruction(), operand, 0,
+             static_cast<unsigned int>(memory.operation()), memory.is_atomic(),
+             memory.meta_data());
+
+   if (memory.operation() == program_model::memory_operation::Load)
+   {
+      if (auto* back_edge = spin_loops.back_edge(instruction))
+      {
+         sites.add(module, *back_edge->getTerminator(), functions.Wrapper_post_memory_instruction(),
+                   operand, 0, static_cast<unsigned int>(program_model::memory_operation::Await),
+                   memory.is_atomic(), memory.meta_data());
+      }
+   }
+}
+
+void add_lock_site(llvm::Module& module, const Functions& functions, Sites& sites,
+                   llvm::Instruction& instruction, llvm::Value* operand,
+                   const lock_instruction& lock)
+{
+   sites.add(module, instruction, functions.Wrapper_post_lock_instruction(), operand, 1,
+             static_cast<unsigned int>(lock.operation()), false, lock.meta_data());
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+
+wrap::wrap(llvm::Module& module, const Functions& functions, Sites& sites,
+           const SpinLoops& spin_loops, llvm::inst_iterator& instruction_it)
 : m_module(module)
 , m_functions(functions)
+, m_sites(sites)
+, m_spin_loops(spin_loops)
 , m_instruction_it(instruction_it)
 {
 }
@@ -30,18 +96,21 @@ wrap::wrap(llvm::Module& module, Functions& functions, llvm::inst_iterator& inst
 
 void wrap::operator()(const memory_instruction& instruction)
 {
-   auto arguments = construct_arguments(instruction);
-   llvm::CallInst::Create(m_functions.Wrapper_post_memory_instruction(), arguments, "",
-                          &*m_instruction_it);
+   add_memory_sites(m_module, m_functions, m_sites, m_spin_loops, *m_instruction_it,
+                    construct_operand(instruction.operand()), instruction);
 }
 
 //--------------------------------------------------------------------------------------------------
 
 void wrap::operator()(const lock_instruction& instruction)
 {
-   auto arguments = construct_arguments(instruction);
-   llvm::CallInst::Create(m_functions.Wrapper_post_lock_instruction(), arguments, "",
-                          &*m_instruction_it);
+   if (instruction.operation() == program_model::lock_operation::CondWait)
+   {
+      replace_cond_wait(instruction);
+      return;
+   }
+   add_lock_site(m_module, m_functions, m_sites, *m_instruction_it,
+                 construct_operand(instruction.operand()), instruction);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -55,30 +124,26 @@ void wrap::operator()(const thread_management_instruction& instruction)
    {
       case program_model::thread_management_operation::Spawn:
       {
-         const auto arguments = construct_arguments(instruction);
+         // The operand is the pthread_t* of pthread_create or the std::thread* of libstdc++'s
+         // std::thread::_M_start_thread, whose only member is the pthread_t of the thread
+         auto arguments = construct_arguments(instruction);
+         llvm::IRBuilder<> builder(&*m_instruction_it);
+         arguments[0] = builder.CreatePointerCast(arguments[0],
+                                                  m_functions.Type_pthread_t()->getPointerTo());
          auto* tid = llvm::CallInst::Create(m_functions.Wrapper_post_spawn_instruction(), arguments,
                                             "", &*m_instruction_it);
-         ++m_instruction_it;
-         llvm::CallInst::Create(m_functions.Wrapper_register_thread(),
-                                arguments_t{instruction.operand(), tid}, "", &*m_instruction_it);
-         --m_instruction_it;
+         llvm::CallInst::Create(m_functions.Wrapper_register_thread(), arguments_t{arguments[0], tid},
+                                "", spawned_insertion_point());
          break;
       }
       case program_model::thread_management_operation::Join:
       {
-         const auto arguments = construct_arguments(instruction);
-         llvm::Function* wrapper;
-         if (instruction.operand()->getType() == m_functions.Type_pthread_t())
-         {
-            wrapper = m_functions.Wrapper_post_pthread_join_instruction();
-         }
-         else if (instruction.operand()->getType() == m_functions.Type_stdthread()->getPointerTo())
+         auto arguments = construct_arguments(instruction);
+         llvm::Function* wrapper = m_functions.Wrapper_post_pthread_join_instruction();
+         if (unaliased_name(*called_function(*m_instruction_it)) != "pthread_join")
          {
             wrapper = m_functions.Wrapper_post_stdthread_join_instruction();
-         }
-         else
-         {
-            throw std::invalid_argument("join instruction has invalid operand type");
+            arguments[0] = construct_operand(arguments[0]);
          }
          llvm::CallInst::Create(wrapper, arguments, "", &*m_instruction_it);
          break;
@@ -90,40 +155,58 @@ void wrap::operator()(const thread_management_instruction& instruction)
 
 //--------------------------------------------------------------------------------------------------
 
-auto wrap::construct_arguments(const memory_instruction& instruction) -> arguments_t
+auto wrap::construct_arguments(const thread_management_instruction& instruction) -> arguments_t
 {
    using namespace llvm;
-   Value* arg_operation = ConstantInt::get(
-      m_module.getContext(), APInt(32, static_cast<int>(instruction.operation()), false));
-   Value* arg_operand = construct_operand(instruction.operand());
-   Value* arg_is_atomic =
-      ConstantInt::get(m_module.getContext(), APInt(8, (instruction.is_atomic() ? 1 : 0), false));
    Value* arg_file_name = construct_file_name(instruction.meta_data().file_name);
    Value* arg_line_number = construct_line_number(instruction.meta_data().line_number);
-   return {arg_operation, arg_operand, arg_is_atomic, arg_file_name, arg_line_number};
+   return {instruction.operand(), arg_file_name, arg_line_number};
 }
 
 //--------------------------------------------------------------------------------------------------
 
-auto wrap::construct_arguments(const lock_instruction& instruction) -> arguments_t
+llvm::Instruction* wrap::spawned_insertion_point()
 {
    using namespace llvm;
-   Value* arg_operation = ConstantInt::get(
-      m_module.getContext(), APInt(32, static_cast<int>(instruction.operation()), false));
-   Value* arg_operand = construct_operand(instruction.operand());
-   Value* arg_file_name = construct_file_name(instruction.meta_data().file_name);
-   Value* arg_line_number = construct_line_number(instruction.meta_data().line_number);
-   return {arg_operation, arg_operand, arg_file_name, arg_line_number};
+   auto* invoke = dyn_cast<InvokeInst>(&*m_instruction_it);
+   if (!invoke)
+      return &*std::next(m_instruction_it);
+   // The pthread_t is only written when the invoke returns normally
+   auto* normal = invoke->getNormalDest();
+   if (!normal->getSinglePredecessor())
+      normal = SplitEdge(invoke->getParent(), normal);
+   return &*normal->getFirstInsertionPt();
 }
 
 //--------------------------------------------------------------------------------------------------
 
-auto wrap::construct_arguments(const thread_management_instruction& instruction) -> arguments_t
+void wrap::replace_cond_wait(const lock_instruction& instruction)
 {
    using namespace llvm;
-   Value* arg_file_name = construct_file_name(instruction.meta_data().file_name);
-   Value* arg_line_number = construct_line_number(instruction.meta_data().line_number);
-   return {instruction.operand(), arg_file_name, arg_line_number};
+   auto& original = *m_instruction_it;
+   // cond->wait(lock) returns void, pthread_cond_wait(cond, mutex) an int
+   auto* wrapper = original.getType()->isVoidTy() ? m_functions.Wrapper_stdcondvar_wait()
+                                                  : m_functions.Wrapper_pthread_cond_wait();
+   Value* mutex = isa<CallInst>(&original) ? cast<CallInst>(&original)->getArgOperand(1)
+                                           : cast<InvokeInst>(&original)->getArgOperand(1);
+   const arguments_t arguments{construct_operand(instruction.operand()), construct_operand(mutex),
+                               construct_file_name(instruction.meta_data().file_name),
+                               construct_line_number(instruction.meta_data().line_number)};
+
+   Instruction* replacement = nullptr;
+   if (auto* invoke = dyn_cast<InvokeInst>(&original))
+   {
+      replacement = InvokeInst::Create(wrapper, invoke->getNormalDest(), invoke->getUnwindDest(),
+                                       arguments, "", &original);
+   }
+   else
+   {
+      replacement = CallInst::Create(wrapper, arguments, "", &original);
+   }
+   replacement->setDebugLoc(original.getDebugLoc());
+   original.replaceAllUsesWith(replacement);
+   --m_instruction_it;
+   original.eraseFromParent();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -138,7 +221,7 @@ llvm::Value* wrap::construct_operand(const operand_t& operand)
 
 llvm::Value* wrap::construct_file_name(const std::string& file_name)
 {
-   std::string global_name = "_recrep_file_name_" + file_name;
+   std::string global_name = file_name_prefix + file_name;
    return instrumentation_utils::get_or_create_global_string_ptr(m_module, *m_instruction_it,
                                                                  global_name, file_name);
 }
@@ -152,6 +235,54 @@ llvm::Value* wrap::construct_line_number(unsigned int line_number)
 
 //--------------------------------------------------------------------------------------------------
 
+declare_globals::declare_globals(llvm::Module& module, const Functions& functions, Sites& sites,
+                                 const SpinLoops& spin_loops, llvm::Instruction& instruction)
+: m_module(module)
+, m_functions(functions)
+, m_sites(sites)
+, m_spin_loops(spin_loops)
+, m_instruction(instruction)
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void declare_globals::operator()(const memory_instruction& instruction)
+{
+   add_memory_sites(m_module, m_functions, m_sites, m_spin_loops, m_instruction,
+                    instruction.operand(), instruction);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void declare_globals::operator()(const lock_instruction& instruction)
+{
+   if (instruction.operation() == program_model::lock_operation::CondWait)
+      declare_file_name(instruction.meta_data().file_name);
+   else
+      add_lock_site(m_module, m_functions, m_sites, m_instruction, instruction.operand(),
+                    instruction);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void declare_globals::operator()(const thread_management_instruction& instruction)
+{
+   if (instruction.operation() == program_model::thread_management_operation::Spawn ||
+       instruction.operation() == program_model::thread_management_operation::Join)
+      declare_file_name(instruction.meta_data().file_name);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void declare_globals::declare_file_name(const std::string& file_name)
+{
+   instrumentation_utils::get_or_create_global_string_constant(
+      m_module, file_name_prefix + file_name, file_name);
+}
+
+//--------------------------------------------------------------------------------------------------
+
 
 namespace {
 
@@ -172,18 +303,6 @@ namespace llvm_visible_instruction {
 
 //--------------------------------------------------------------------------------------------------
 
-bool is_thread_local(const llvm::Value& operand)
-{
-   const llvm::Value* address_start = operand.stripInBoundsOffsets();
-   if (llvm::isa<llvm::GlobalVariable>(address_start))
-   {
-      return false;
-   }
-   return false;
-}
-
-//--------------------------------------------------------------------------------------------------
-
 boost::optional<program_model::meta_data_t> get_meta_data(llvm::Instruction& instruction)
 {
    if (llvm::DILocation* location = instruction.getDebugLoc())
@@ -201,17 +320,13 @@ creator::return_type create(llvm::Instruction& instruction,
                             const typename instruction_t::operation_t& operation,
                             llvm::Value* operand, args_t&&... args)
 {
-   if (!is_thread_local(*operand))
+   instruction_t visible_instruction(nullptr, operation, operand, std::forward<args_t>(args)...);
+   auto meta_data = get_meta_data(instruction);
+   if (meta_data)
    {
-      instruction_t visible_instruction(nullptr, operation, operand, std::forward<args_t>(args)...);
-      auto meta_data = get_meta_data(instruction);
-      if (meta_data)
-      {
-         visible_instruction.add_meta_data(*meta_data);
-      }
-      return creator::return_type(visible_instruction);
+      visible_instruction.add_meta_data(*meta_data);
    }
-   return creator::return_type();
+   return creator::return_type(visible_instruction);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -220,11 +335,100 @@ creator::return_type create(llvm::Instruction& instruction,
 
 using memory_operation = program_model::memory_operation;
 using lock_operation = program_model::lock_operation;
+using thread_management_operation = program_model::thread_management_operation;
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+/// @brief Returns the thread_management_operations of the functions spawning or joining the
+/// thread that is their first argument, by name. Under libc++, std::thread's constructor inlines
+/// to pthread_create, under libstdc++ it calls std::thread::_M_start_thread in the library.
+
+const std::unordered_map<std::string, thread_management_operation>& thread_functions()
+{
+   static const std::unordered_map<std::string, thread_management_operation> functions{
+      {"pthread_create", thread_management_operation::Spawn},
+      {"pthread_join", thread_management_operation::Join},
+      // std::thread (libstdc++)
+      {"_ZNSt6thread15_M_start_threadESt10unique_ptrINS_6_StateESt14default_deleteIS1_EEPFvvE",
+       thread_management_operation::Spawn},
+      {"_ZNSt6thread15_M_start_threadESt10unique_ptrINS_6_StateESt14default_deleteIS1_EE",
+       thread_management_operation::Spawn},
+      {"_ZNSt6thread4joinEv", thread_management_operation::Join},
+      // std::__1::thread (libc++)
+      {"_ZNSt3__16thread4joinEv", thread_management_operation::Join}};
+   return functions;
+}
+
+/// @brief Returns the lock_operations of the functions operating on the synchronization object
+/// that is their first argument, by name. A timed lock or wait either acquires the object or
+/// times out, like a try does. Timed waits on condition variables are not modeled. Under
+/// libstdc++, std::mutex and std::shared_mutex inline to the pthread functions, under libc++
+/// std::mutex calls into the library.
+
+const std::unordered_map<std::string, lock_operation>& lock_functions()
+{
+   static const std::unordered_map<std::string, lock_operation> functions{
+      {"pthread_mutex_lock", lock_operation::Lock},
+      {"pthread_mutex_trylock", lock_operation::TryLock},
+      {"pthread_mutex_timedlock", lock_operation::TryLock},
+      {"pthread_mutex_unlock", lock_operation::Unlock},
+      {"pthread_spin_lock", lock_operation::Lock},
+      {"pthread_spin_trylock", lock_operation::TryLock},
+      {"pthread_spin_unlock", lock_operation::Unlock},
+      {"pthread_rwlock_wrlock", lock_operation::Lock},
+      {"pthread_rwlock_trywrlock", lock_operation::TryLock},
+      {"pthread_rwlock_timedwrlock", lock_operation::TryLock},
+      {"pthread_rwlock_rdlock", lock_operation::ReadLock},
+      {"pthread_rwlock_tryrdlock", lock_operation::TryReadLock},
+      {"pthread_rwlock_timedrdlock", lock_operation::TryReadLock},
+      {"pthread_rwlock_unlock", lock_operation::Unlock},
+      {"sem_wait", lock_operation::SemWait},
+      {"sem_trywait", lock_operation::SemTryWait},
+      {"sem_timedwait", lock_operation::SemTryWait},
+      {"sem_post", lock_operation::SemPost},
+      {"pthread_cond_wait", lock_operation::CondWait},
+      {"pthread_cond_signal", lock_operation::CondSignal},
+      {"pthread_cond_broadcast", lock_operation::CondBroadcast},
+      // std::condition_variable
+      {"_ZNSt18condition_variable4waitERSt11unique_lockISt5mutexE", lock_operation::CondWait},
+      {"_ZNSt18condition_variable10notify_oneEv", lock_operation::CondSignal},
+      {"_ZNSt18condition_variable10notify_allEv", lock_operation::CondBroadcast},
+      // std::__1::mutex
+      {"_ZNSt3__15mutex4lockEv", lock_operation::Lock},
+      {"_ZNSt3__15mutex8try_lockEv", lock_operation::TryLock},
+      {"_ZNSt3__15mutex6unlockEv", lock_operation::Unlock},
+      // std::__1::shared_mutex
+      {"_ZNSt3__112shared_mutex4lockEv", lock_operation::Lock},
+      {"_ZNSt3__112shared_mutex8try_lockEv", lock_operation::TryLock},
+      {"_ZNSt3__112shared_mutex6unlockEv", lock_operation::Unlock},
+      {"_ZNSt3__112shared_mutex11lock_sharedEv", lock_operation::ReadLock},
+      {"_ZNSt3__112shared_mutex15try_lock_sharedEv", lock_operation::TryReadLock},
+      {"_ZNSt3__112shared_mutex13unlock_sharedEv", lock_operation::Unlock},
+      // std::__1::condition_variable
+      {"_ZNSt3__118condition_variable4waitERNS_11unique_lockINS_5mutexEEE",
+       lock_operation::CondWait},
+      {"_ZNSt3__118condition_variable10notify_oneEv", lock_operation::CondSignal},
+      {"_ZNSt3__118condition_variable10notify_allEv", lock_operation::CondBroadcast}};
+   return functions;
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+
+creator::creator(const ThreadEscape* thread_escape)
+: m_thread_escape(thread_escape)
+{
+}
 
 //--------------------------------------------------------------------------------------------------
 
 auto creator::visitLoadInst(llvm::LoadInst& instr) -> return_type
 {
+   if (is_thread_local(*instr.getPointerOperand()))
+      return return_type();
    return create<memory_instruction>(instr, memory_operation::Load, instr.getPointerOperand(),
                                      instr.isAtomic());
 }
@@ -233,6 +437,8 @@ auto creator::visitLoadInst(llvm::LoadInst& instr) -> return_type
 
 auto creator::visitStoreInst(llvm::StoreInst& instr) -> return_type
 {
+   if (is_thread_local(*instr.getPointerOperand()))
+      return return_type();
    return create<memory_instruction>(instr, memory_operation::Store, instr.getPointerOperand(),
                                      instr.isAtomic());
 }
@@ -242,6 +448,8 @@ auto creator::visitStoreInst(llvm::StoreInst& instr) -> return_type
 auto creator::visitAtomicRMWInst(llvm::AtomicRMWInst& instr) -> return_type
 {
    assert(instr.isAtomic());
+   if (is_thread_local(*instr.getPointerOperand()))
+      return return_type();
    return create<memory_instruction>(instr, memory_operation::ReadModifyWrite,
                                      instr.getPointerOperand(), true);
 }
@@ -250,14 +458,16 @@ auto creator::visitAtomicRMWInst(llvm::AtomicRMWInst& instr) -> return_type
 
 auto creator::visitCallInst(llvm::CallInst& instr) -> return_type
 {
-   return handle_call_and_invoke_instr(instr, instr.getCalledFunction(), instr.arg_operands());
+   return handle_call_and_invoke_instr(instr, instr.getCalledFunction(),
+                                       llvm::make_range(instr.arg_begin(), instr.arg_end()));
 }
 
 //--------------------------------------------------------------------------------------------------
 
 auto creator::visitInvokeInst(llvm::InvokeInst& instr) -> return_type
 {
-   return handle_call_and_invoke_instr(instr, instr.getCalledFunction(), instr.arg_operands());
+   return handle_call_and_invoke_instr(instr, instr.getCalledFunction(),
+                                       llvm::make_range(instr.arg_begin(), instr.arg_end()));
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -269,6 +479,13 @@ auto creator::visitInstruction(llvm::Instruction& instr) -> return_type
 
 //--------------------------------------------------------------------------------------------------
 
+bool creator::is_thread_local(const llvm::Value& address) const
+{
+   return m_thread_escape && !m_thread_escape->may_be_shared(address);
+}
+
+//--------------------------------------------------------------------------------------------------
+
 auto creator::handle_call_and_invoke_instr(
    llvm::Instruction& instr, const llvm::Function* callee,
    const llvm::iterator_range<llvm::User::const_op_iterator>& arg_operands) -> return_type
@@ -277,24 +494,17 @@ auto creator::handle_call_and_invoke_instr(
    if (callee)
    {
       using namespace program_model;
-      if (callee->getName() == "pthread_create")
-      {
-         return create<thread_management_instruction>(instr, thread_management_operation::Spawn,
-                                                      *arg_operands.begin());
-      }
-      else if (callee->getName() == "\01_pthread_join" ||
-               callee->getName() == "_ZNSt3__16thread4joinEv")
+      const auto name = unaliased_name(*callee).str();
+      const auto thread_function = thread_functions().find(name);
+      if (thread_function != thread_functions().end())
       {
-         return create<thread_management_instruction>(instr, thread_management_operation::Join,
+         return create<thread_management_instruction>(instr, thread_function->second,
                                                       *arg_operands.begin());
       }
-      else if (callee->getName() == "pthread_mutex_lock")
-      {
-         return create<lock_instruction>(instr, lock_operation::Lock, *arg_operands.begin());
-      }
-      else if (callee->getName() == "pthread_mutex_unlock")
+      const auto lock_function = lock_functions().find(name);
+      if (lock_function != lock_functions().end())
       {
-         return create<lock_instruction>(instr, lock_operation::Unlock, *arg_operands.begin());
+         return create<lock_instruction>(instr, lock_function->second, *arg_operands.begin());
       }
    }
    /// @todo Case of indirect function invokation
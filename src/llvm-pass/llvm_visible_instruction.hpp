@@ -29,6 +29,9 @@ namespace concurrency_passes {
 
 // Forward declarations
 class Functions;
+class Sites;
+class SpinLoops;
+class ThreadEscape;
 
 //--------------------------------------------------------------------------------------------------
 
@@ -57,35 +60,80 @@ struct wrap : public boost::static_visitor<void>
 {
    using arguments_t = std::vector<llvm::Value*>;
 
-   wrap(llvm::Module& module, Functions& functions, llvm::inst_iterator& instruction_it);
+   /// @param instruction_it Points to the instruction to wrap. A replaced instruction is erased,
+   /// and instruction_it then points to its replacement.
+
+   wrap(llvm::Module& module, const Functions& functions, Sites& sites,
+        const SpinLoops& spin_loops, llvm::inst_iterator& instruction_it);
 
    void operator()(const memory_instruction& instruction);
    void operator()(const lock_instruction& instruction);
    void operator()(const thread_management_instruction& instruction);
 
 private:
-   arguments_t construct_arguments(const memory_instruction& instruction);
-   arguments_t construct_arguments(const lock_instruction& instruction);
    arguments_t construct_arguments(const thread_management_instruction& instruction);
 
+   /// @brief Returns the instruction before which to register the thread spawned by the current
+   /// instruction, i.e. the next one or, for an invoke, the first of its normal destination.
+
+   llvm::Instruction* spawned_insertion_point();
+
+   /// @brief Replaces the call waiting on a condition variable by a call of the wrapper posting
+   /// the Unlock, CondWait and Lock it consists of.
+
+   void replace_cond_wait(const lock_instruction& instruction);
+
    llvm::Value* construct_operand(const operand_t& operand);
    llvm::Value* construct_file_name(const std::string& file_name);
    llvm::Value* construct_line_number(unsigned int line_number);
 
    llvm::Module& m_module;
-   Functions& m_functions;
+   const Functions& m_functions;
+   Sites& m_sites;
+   const SpinLoops& m_spin_loops;
    llvm::inst_iterator& m_instruction_it;
 
 }; // end struct construct_instruction
 
 //--------------------------------------------------------------------------------------------------
 
+/// @brief Adds the sites of an instruction to sites and creates the global strings that wrap
+/// refers to, but leaves the instruction as is. A module pass can so create the globals of a
+/// function, which a function pass then only looks up when it wraps the same instructions.
+
+struct declare_globals : public boost::static_visitor<void>
+{
+   declare_globals(llvm::Module& module, const Functions& functions, Sites& sites,
+                   const SpinLoops& spin_loops, llvm::Instruction& instruction);
+
+   void operator()(const memory_instruction& instruction);
+   void operator()(const lock_instruction& instruction);
+   void operator()(const thread_management_instruction& instruction);
+
+private:
+   void declare_file_name(const std::string& file_name);
+
+   llvm::Module& m_module;
+   const Functions& m_functions;
+   Sites& m_sites;
+   const SpinLoops& m_spin_loops;
+   llvm::Instruction& m_instruction;
+
+}; // end struct declare_globals
+
+//--------------------------------------------------------------------------------------------------
+
 
 namespace llvm_visible_instruction {
 struct creator : public llvm::InstVisitor<creator, boost::optional<visible_instruction_t>>
 {
    using return_type = boost::optional<visible_instruction_t>;
 
+   /// @param thread_escape If given, memory instructions accessing thread-local memory are not
+   /// visible.
+
+   explicit creator(const ThreadEscape* thread_escape = nullptr);
+
    // Potential Visible Instructions
    return_type visitLoadInst(llvm::LoadInst& instr);
    return_type visitStoreInst(llvm::StoreInst& instr);
@@ -97,10 +145,14 @@ struct creator : public llvm::InstVisitor<creator, boost::optional<visible_instr
    return_type visitInstruction(llvm::Instruction& instr);
 
 private:
+   bool is_thread_local(const llvm::Value& address) const;
+
    return_type handle_call_and_invoke_instr(
       llvm::Instruction& instr, const llvm::Function* callee,
       const llvm::iterator_range<llvm::User::const_op_iterator>& arg_operands);
 
+   const ThreadEscape* m_thread_escape;
+
 }; // end struct creator
 
 } // end namespace llvm_visible_instruction
@@ -0,0 +1,210 @@
+
+#include "sites.hpp"
+
+#include "functions.hpp"
+#include "instrumentation_utils.hpp"
+
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Transforms/Utils/BasicBlockUtils.h>
+#include <llvm/Transforms/Utils/ModuleUtils.h>
+
+#include <stdexcept>
+
+
+namespace concurrency_passes {
+
+//--------------------------------------------------------------------------------------------------
+
+Sites::Sites()
+: m_functions(nullptr)
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void Sites::initialize(const Functions& functions)
+{
+   m_functions = &functions;
+   m_sites.clear();
+   m_descriptors.clear();
+   m_occurrences.clear();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void Sites::add(llvm::Module& module, llvm::Instruction& instruction, llvm::Function* wrapper,
+                llvm::Value* operand, const unsigned int kind, const unsigned int operation,
+                const bool is_atomic, const program_model::meta_data_t& meta_data)
+{
+   using namespace llvm;
+   auto& context = module.getContext();
+   const std::string& file_name = meta_data.file_name;
+   const std::string function_name = instruction.getFunction()->getName().str();
+   const Value* variable = operand->stripPointerCasts()->stripInBoundsOffsets();
+   const std::string variable_name = variable->hasName() ? variable->getName().str() : "";
+
+   const auto string_constant = [&module](const std::string& prefix, const std::string& str) {
+      return instrumentation_utils::get_or_create_global_string_constant(module, prefix + str,
+                                                                         str);
+   };
+   m_descriptors.push_back(ConstantStruct::get(
+      m_functions->Type_instrumentation_site(),
+      {ConstantInt::get(Type::getInt64Ty(context),
+                        site_id(function_name, kind, operation, meta_data)),
+       ConstantInt::get(Type::getInt8Ty(context), kind),
+       ConstantInt::get(Type::getInt8Ty(context), is_atomic ? 1 : 0),
+       ConstantInt::get(Type::getInt32Ty(context), operation),
+       string_constant("_recrep_file_name_", file_name),
+       ConstantInt::get(Type::getInt32Ty(context), meta_data.line_number),
+       string_constant("_recrep_function_name_", function_name),
+       string_constant("_recrep_variable_name_", variable_name)}));
+   m_sites.push_back({&instruction, wrapper, operand});
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void Sites::emit(llvm::Module& module)
+{
+   const auto table = emit_tables(module);
+   if (table.size > 0)
+      emit_registration(module, *m_functions, {table});
+}
+
+//--------------------------------------------------------------------------------------------------
+
+Sites::table_t Sites::emit_tables(llvm::Module& module)
+{
+   const auto table = declare_tables(module);
+   emit_prologues(module, table);
+   return table;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+Sites::table_t Sites::declare_tables(llvm::Module& module)
+{
+   using namespace llvm;
+   if (m_sites.empty())
+      return {nullptr, nullptr, 0};
+
+   auto& context = module.getContext();
+   auto* sites_type = ArrayType::get(m_functions->Type_instrumentation_site(), m_sites.size());
+   auto* sites = new GlobalVariable(module, sites_type, true, GlobalValue::PrivateLinkage,
+                                    ConstantArray::get(sites_type, m_descriptors), "_recrep_sites");
+
+   // All sites start enabled
+   std::vector<uint8_t> enabled_bits(m_sites.size(), 1);
+   auto* enabled_type = ArrayType::get(Type::getInt8Ty(context), m_sites.size());
+   auto* enabled =
+      new GlobalVariable(module, enabled_type, false, GlobalValue::PrivateLinkage,
+                         ConstantDataArray::get(context, enabled_bits), "_recrep_site_enabled");
+
+   auto* zero = ConstantInt::get(Type::getInt32Ty(context), 0);
+   return {
+      ConstantExpr::getInBoundsGetElementPtr(sites_type, sites, ArrayRef<Constant*>{zero, zero}),
+      ConstantExpr::getInBoundsGetElementPtr(enabled_type, enabled,
+                                             ArrayRef<Constant*>{zero, zero}),
+      m_sites.size()};
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void Sites::emit_prologues(llvm::Module& module, const table_t& table)
+{
+   using namespace llvm;
+   if (table.size != m_sites.size())
+   {
+      throw std::invalid_argument("site table of size " + std::to_string(table.size) + " for " +
+                                  std::to_string(m_sites.size()) + " sites");
+   }
+   auto& context = module.getContext();
+   for (std::size_t index = 0; index < m_sites.size(); ++index)
+   {
+      auto* i = ConstantInt::get(Type::getInt32Ty(context), index);
+      emit_prologue(module, m_sites[index],
+                    ConstantExpr::getInBoundsGetElementPtr(m_functions->Type_instrumentation_site(),
+                                                           table.sites, i),
+                    ConstantExpr::getInBoundsGetElementPtr(Type::getInt8Ty(context),
+                                                           table.enabled, i));
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::size_t Sites::size() const
+{
+   return m_sites.size();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint64_t Sites::site_id(const std::string& function_name, const unsigned int kind,
+                        const unsigned int operation, const program_model::meta_data_t& meta_data)
+{
+   const std::string key = meta_data.file_name.str() + '\0' + function_name + '\0' +
+                           std::to_string(meta_data.line_number) + ':' + std::to_string(kind) +
+                           ':' + std::to_string(operation);
+   const auto occurrence = m_occurrences[key]++;
+
+   // FNV-1a, which unlike std::hash is the same across compilers and runs of the pass
+   uint64_t hash = 14695981039346656037ull;
+   for (const char c : key + '#' + std::to_string(occurrence))
+   {
+      hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+   }
+   return hash;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void Sites::emit_prologue(llvm::Module& module, const site_t& site, llvm::Constant* descriptor,
+                          llvm::Constant* enabled)
+{
+   using namespace llvm;
+   IRBuilder<> builder(site.instruction);
+   auto* thread_uncontrolled = m_functions->Global_thread_uncontrolled();
+   auto* controlled = builder.CreateICmpEQ(
+      builder.CreateLoad(builder.getInt8Ty(), thread_uncontrolled, "recrep_uncontrolled"),
+      builder.getInt8(0));
+   // The scheduler may update the bit from another thread (see set_site_filter)
+   auto* enabled_bit = builder.CreateLoad(builder.getInt8Ty(), enabled, "recrep_site_enabled");
+   enabled_bit->setAtomic(AtomicOrdering::Monotonic);
+#if LLVM_VERSION_MAJOR >= 10
+   enabled_bit->setAlignment(Align(1));
+#else
+   enabled_bit->setAlignment(1);
+#endif
+   auto* site_enabled = builder.CreateICmpNE(enabled_bit, builder.getInt8(0));
+
+   // The call is the slow path: keep the skipping path straight-line
+   auto* weights = MDBuilder(module.getContext()).createBranchWeights(1, 1000);
+   auto* post = SplitBlockAndInsertIfThen(builder.CreateAnd(controlled, site_enabled),
+                                          site.instruction, false, weights);
+   CallInst::Create(site.wrapper, {site.operand, descriptor}, "", post);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void Sites::emit_registration(llvm::Module& module, const Functions& functions,
+                              const std::vector<table_t>& tables)
+{
+   using namespace llvm;
+   auto& context = module.getContext();
+   auto* registration =
+      Function::Create(FunctionType::get(Type::getVoidTy(context), false),
+                       GlobalValue::InternalLinkage, "_recrep_register_sites", &module);
+   IRBuilder<> builder(BasicBlock::Create(context, "", registration));
+   for (const auto& table : tables)
+   {
+      builder.CreateCall(functions.Wrapper_register_sites(),
+                         {table.sites, table.enabled, builder.getInt32(table.size)});
+   }
+   builder.CreateRetVoid();
+   appendToGlobalCtors(module, registration, 65535);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace concurrency_passes
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "visible_instruction.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+/// @file sites.hpp
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+namespace llvm {
+class Constant;
+class Function;
+class Instruction;
+class Module;
+class Value;
+} // end namespace llvm
+
+
+namespace concurrency_passes {
+
+// Forward declarations
+class Functions;
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Collects the memory and lock instructions of a module that are to be posted to the
+/// Scheduler and emits, for each of them, an inlined prologue
+///
+///    if (!wrapper_thread_uncontrolled && _recrep_site_enabled[site])
+///       wrapper(operand, &_recrep_sites[site]);
+///
+/// in front of the instruction. _recrep_sites is a constant table of descriptors
+/// (scheduler::instrumentation_site) and _recrep_site_enabled a table of enable bits, which a
+/// module constructor registers with the Scheduler. The Scheduler sets the bits according to
+/// the site_filter in its settings, possibly while other threads run, so the prologue loads
+/// them atomically (monotonic).
+
+class Sites
+{
+public:
+   /// @brief The site tables of a module or of a function, as passed to wrapper_register_sites.
+
+   struct table_t
+   {
+      llvm::Constant* sites;
+      llvm::Constant* enabled;
+      std::size_t size;
+   };
+
+   Sites();
+
+   void initialize(const Functions& functions);
+
+   /// @brief Adds a site posting operand through wrapper in front of instruction. kind is the
+   /// index of the instruction's type in visible_instruction_t.
+   /// @details Emitting the prologue splits the basic block of instruction, so it is postponed to
+   /// emit, when the pass no longer iterates over the module's instructions.
+
+   void add(llvm::Module& module, llvm::Instruction& instruction, llvm::Function* wrapper,
+            llvm::Value* operand, unsigned int kind, unsigned int operation, bool is_atomic,
+            const program_model::meta_data_t& meta_data);
+
+   /// @brief Emits the site tables, the prologues and the registration of the tables.
+
+   void emit(llvm::Module& module);
+
+   /// @brief Emits the site tables and the prologues, but not the registration of the tables.
+   /// @return The emitted tables, or a table of size 0 if no sites were added.
+
+   table_t emit_tables(llvm::Module& module);
+
+   /// @brief Emits the site tables, but neither the prologues nor the registration of the
+   /// tables.
+   /// @return The emitted tables, or a table of size 0 if no sites were added.
+
+   table_t declare_tables(llvm::Module& module);
+
+   /// @brief Emits the prologues of the sites, reading the tables that declare_tables emitted
+   /// for the same sites.
+   /// @throws std::invalid_argument if table does not have a descriptor for every site.
+
+   void emit_prologues(llvm::Module& module, const table_t& table);
+
+   /// @brief Emits a module constructor registering tables with the Scheduler.
+
+   static void emit_registration(llvm::Module& module, const Functions& functions,
+                                 const std::vector<table_t>& tables);
+
+   std::size_t size() const;
+
+private:
+   struct site_t
+   {
+      llvm::Instruction* instruction;
+      llvm::Function* wrapper;
+      llvm::Value* operand;
+   };
+
+   /// @brief Returns the stable id of the site (see scheduler::instrumentation_site::id).
+
+   uint64_t site_id(const std::string& function_name, unsigned int kind, unsigned int operation,
+                    const program_model::meta_data_t& meta_data);
+
+   void emit_prologue(llvm::Module& module, const site_t& site, llvm::Constant* descriptor,
+                      llvm::Constant* enabled);
+
+   const Functions* m_functions;
+   std::vector<site_t> m_sites;
+   std::vector<llvm::Constant*> m_descriptors;
+
+   /// @brief The number of sites so far per function, file, line, kind and operation.
+   std::map<std::string, unsigned int> m_occurrences;
+
+}; // end class Sites
+
+} // end namespace concurrency_passes
@@ -0,0 +1,133 @@
+
+#include "spin_loops.hpp"
+
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
+
+#include <vector>
+
+
+namespace concurrency_passes {
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+/// @brief Returns whether instruction is a hint to the processor that the thread spins, e.g.
+/// _mm_pause().
+
+bool is_spin_hint(const llvm::Instruction& instruction)
+{
+   const auto* call = llvm::dyn_cast<llvm::CallInst>(&instruction);
+   const auto* callee = call ? call->getCalledFunction() : nullptr;
+   if (!callee)
+      return false;
+   const auto name = callee->getName();
+   return name == "llvm.x86.sse2.pause" || name == "llvm.aarch64.hint" || name == "llvm.arm.hint";
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Returns the load of block if it is the only instruction of block accessing memory or
+/// having side effects, and block has no phi nodes, or nullptr otherwise.
+
+llvm::LoadInst* spin_load(llvm::BasicBlock& block)
+{
+   using namespace llvm;
+   if (isa<PHINode>(block.front()))
+      return nullptr;
+
+   LoadInst* load = nullptr;
+   for (auto& instruction : block)
+   {
+      if (auto* candidate = dyn_cast<LoadInst>(&instruction))
+      {
+         if (load)
+            return nullptr;
+         load = candidate;
+      }
+      else if (!isa<DbgInfoIntrinsic>(&instruction) && !is_spin_hint(instruction) &&
+               (instruction.mayReadOrWriteMemory() || instruction.mayHaveSideEffects()))
+      {
+         return nullptr;
+      }
+   }
+   return load;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Returns whether block only branches back to header, which is its only predecessor.
+
+bool only_branches_back(const llvm::BasicBlock& block, const llvm::BasicBlock& header)
+{
+   const auto* branch = llvm::dyn_cast<llvm::BranchInst>(block.getTerminator());
+   return branch && branch->isUnconditional() && branch->getSuccessor(0) == &header &&
+          block.getSinglePredecessor() == &header && block.getFirstNonPHIOrDbg() == branch;
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+
+void SpinLoops::initialize(llvm::Function& function)
+{
+   using namespace llvm;
+   m_back_edges.clear();
+
+   struct self_loop_t
+   {
+      BranchInst* branch;
+      unsigned int successor;
+      LoadInst* load;
+   };
+
+   // Direct back edges, split once the blocks are no longer iterated over
+   std::vector<self_loop_t> self_loops;
+   for (auto& block : function)
+   {
+      auto* branch = dyn_cast<BranchInst>(block.getTerminator());
+      if (!branch || !branch->isConditional() ||
+          branch->getSuccessor(0) == branch->getSuccessor(1))
+         continue;
+      auto* load = spin_load(block);
+      if (!load)
+         continue;
+      for (unsigned int index = 0; index < 2; ++index)
+      {
+         auto* successor = branch->getSuccessor(index);
+         if (successor == &block)
+         {
+            self_loops.push_back({branch, index, load});
+         }
+         else if (only_branches_back(*successor, block))
+         {
+            m_back_edges[load] = successor;
+         }
+      }
+   }
+
+   for (const auto& self_loop : self_loops)
+   {
+      auto* block = self_loop.branch->getParent();
+      auto* back_edge = BasicBlock::Create(function.getContext(), "recrep_spin", &function,
+                                           block->getNextNode());
+      BranchInst::Create(block, back_edge)->setDebugLoc(self_loop.branch->getDebugLoc());
+      self_loop.branch->setSuccessor(self_loop.successor, back_edge);
+      m_back_edges[self_loop.load] = back_edge;
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+llvm::BasicBlock* SpinLoops::back_edge(const llvm::Instruction& load) const
+{
+   const auto back_edge = m_back_edges.find(&load);
+   return back_edge == m_back_edges.end() ? nullptr : back_edge->second;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace concurrency_passes
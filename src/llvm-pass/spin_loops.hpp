@@ -0,0 +1,47 @@
+#pragma once
+
+#include <map>
+
+//--------------------------------------------------------------------------------------------------
+/// @file spin_loops.hpp
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+namespace llvm {
+class BasicBlock;
+class Function;
+class Instruction;
+} // end namespace llvm
+
+
+namespace concurrency_passes {
+
+/// @brief Finds the loops of a function that spin on a single load, e.g. while (!flag);
+/// @details A spin loop is a block, without phi nodes, that loads from memory once, does not
+/// otherwise access memory or have side effects, and ends in a conditional branch back to
+/// itself, either directly or through a block that only branches back. Each iteration computes
+/// the same as the previous one unless another thread changed the loaded memory in between, so
+/// the pass posts an Await on the back edge, which the Scheduler only enables once another
+/// thread wrote the memory, instead of scheduling every iteration.
+
+class SpinLoops
+{
+public:
+   /// @brief Finds the spin loops of function, splitting a direct back edge into a block of its
+   /// own.
+
+   void initialize(llvm::Function& function);
+
+   /// @brief Returns the block on the back edge of the spin loop that spins on load, or nullptr if
+   /// load is not the load of a spin loop.
+
+   llvm::BasicBlock* back_edge(const llvm::Instruction& load) const;
+
+private:
+   std::map<const llvm::Instruction*, llvm::BasicBlock*> m_back_edges;
+
+}; // end class SpinLoops
+
+} // end namespace concurrency_passes
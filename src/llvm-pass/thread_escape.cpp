@@ -0,0 +1,246 @@
+
+#include "thread_escape.hpp"
+
+#include <llvm/Analysis/AliasAnalysis.h>
+#include <llvm/Analysis/CaptureTracking.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/CommandLine.h>
+
+#include <algorithm>
+#include <vector>
+
+
+namespace concurrency_passes {
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+llvm::cl::opt<bool> whole_program_option(
+   "record-replay-whole-program",
+   llvm::cl::desc("Instrument the whole program at LTO link time, only instrumenting accesses "
+                  "to memory that may be shared between threads"),
+   llvm::cl::init(false));
+
+//--------------------------------------------------------------------------------------------------
+
+const llvm::Value* underlying_object(const llvm::Value& address, const llvm::Module& module)
+{
+#if LLVM_VERSION_MAJOR >= 12
+   (void)module;
+   return llvm::getUnderlyingObject(&address);
+#else
+   return llvm::GetUnderlyingObject(&address, module.getDataLayout());
+#endif
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Collects the constants making up the initializers of llvm.global_ctors, llvm.used and
+/// llvm.compiler.used, whose references to functions do not take their address.
+
+void collect_listing_constants(const llvm::Module& module, std::set<const llvm::Value*>& constants)
+{
+   std::vector<const llvm::Constant*> worklist;
+   for (const char* name : {"llvm.global_ctors", "llvm.used", "llvm.compiler.used"})
+   {
+      if (const auto* list = module.getGlobalVariable(name))
+      {
+         if (list->hasInitializer())
+            worklist.push_back(list->getInitializer());
+      }
+   }
+   while (!worklist.empty())
+   {
+      const auto* constant = worklist.back();
+      worklist.pop_back();
+      if (llvm::isa<llvm::GlobalValue>(constant) || !constants.insert(constant).second)
+         continue;
+      for (const auto& operand : constant->operands())
+      {
+         if (const auto* operand_constant = llvm::dyn_cast<llvm::Constant>(operand))
+            worklist.push_back(operand_constant);
+      }
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool is_address_taken(const llvm::Function& function,
+                      const std::set<const llvm::Value*>& listing_constants)
+{
+   for (const auto& use : function.uses())
+   {
+      const auto* user = use.getUser();
+      // The callee is the last operand of calls and invokes
+      const bool is_call = llvm::isa<llvm::CallInst>(user) || llvm::isa<llvm::InvokeInst>(user);
+      if (is_call && use.getOperandNo() + 1 == user->getNumOperands())
+         continue;
+      if (listing_constants.count(user))
+         continue;
+      return true;
+   }
+   return false;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Adds the functions containing direct loads and stores of pointer to accessors.
+/// @return false if pointer escapes, i.e. is used other than by loads and stores through it and
+/// by casts and address computations whose result is only used that way.
+
+bool collect_accessors(const llvm::Value& pointer, std::set<const llvm::Function*>& accessors)
+{
+   using namespace llvm;
+   for (const auto* user : pointer.users())
+   {
+      if (const auto* instruction = dyn_cast<Instruction>(user))
+         accessors.insert(instruction->getFunction());
+
+      if (isa<LoadInst>(user))
+         continue;
+      if (const auto* store = dyn_cast<StoreInst>(user))
+      {
+         if (store->getPointerOperand() == &pointer)
+            continue;
+         return false;
+      }
+      if (const auto* rmw = dyn_cast<AtomicRMWInst>(user))
+      {
+         if (rmw->getPointerOperand() == &pointer)
+            continue;
+         return false;
+      }
+      if (const auto* cmpxchg = dyn_cast<AtomicCmpXchgInst>(user))
+      {
+         if (cmpxchg->getPointerOperand() == &pointer)
+            continue;
+         return false;
+      }
+      const auto* expression = dyn_cast<ConstantExpr>(user);
+      const bool is_address_computation =
+         isa<GetElementPtrInst>(user) || isa<BitCastInst>(user) || isa<AddrSpaceCastInst>(user) ||
+         (expression && (expression->getOpcode() == Instruction::GetElementPtr ||
+                         expression->getOpcode() == Instruction::BitCast ||
+                         expression->getOpcode() == Instruction::AddrSpaceCast));
+      if (!is_address_computation || !collect_accessors(*user, accessors))
+         return false;
+   }
+   return true;
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+
+bool whole_program_instrumentation()
+{
+   return whole_program_option;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ThreadEscape::ThreadEscape()
+: m_module(nullptr)
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ThreadEscape::initialize(llvm::Module& module)
+{
+   m_module = &module;
+   m_main_thread_only.clear();
+   m_may_be_shared.clear();
+
+   const auto* main = module.getFunction("main");
+   const auto threads = thread_functions(module);
+   if (!main || threads.count(main))
+      return;
+
+   for (const auto& global : module.globals())
+   {
+      // A declaration is defined, and may be accessed, outside of the module
+      if (global.isDeclaration())
+         continue;
+      std::set<const llvm::Function*> accessors;
+      if (collect_accessors(global, accessors) &&
+          std::none_of(accessors.begin(), accessors.end(),
+                       [&threads](const auto* function) { return threads.count(function); }))
+      {
+         m_main_thread_only.insert(&global);
+      }
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ThreadEscape::may_be_shared(const llvm::Value& address) const
+{
+   using namespace llvm;
+   const auto* object = underlying_object(address, *m_module);
+   const auto known = m_may_be_shared.find(object);
+   if (known != m_may_be_shared.end())
+      return known->second;
+
+   bool shared = true;
+   if (const auto* global = dyn_cast<GlobalVariable>(object))
+   {
+      shared = !global->isThreadLocal() && !global->isConstant() &&
+               m_main_thread_only.count(global) == 0;
+   }
+   else if (isa<AllocaInst>(object) || isNoAliasCall(object))
+   {
+      shared = PointerMayBeCaptured(object, true, true);
+   }
+   m_may_be_shared.emplace(object, shared);
+   return shared;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::set<const llvm::Function*> ThreadEscape::thread_functions(const llvm::Module& module)
+{
+   using namespace llvm;
+   std::set<const Value*> listing_constants;
+   collect_listing_constants(module, listing_constants);
+
+   std::set<const Function*> reached;
+   std::vector<const Function*> worklist;
+   for (const auto& function : module)
+   {
+      if (is_address_taken(function, listing_constants))
+      {
+         reached.insert(&function);
+         worklist.push_back(&function);
+      }
+   }
+   // Indirect calls only call functions whose address is taken, which are reached already
+   while (!worklist.empty())
+   {
+      const auto* function = worklist.back();
+      worklist.pop_back();
+      for (const auto& block : *function)
+      {
+         for (const auto& instruction : block)
+         {
+            const Function* callee = nullptr;
+            if (const auto* call = dyn_cast<CallInst>(&instruction))
+               callee = call->getCalledFunction();
+            else if (const auto* invoke = dyn_cast<InvokeInst>(&instruction))
+               callee = invoke->getCalledFunction();
+            if (callee && reached.insert(callee).second)
+               worklist.push_back(callee);
+         }
+      }
+   }
+   return reached;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace concurrency_passes
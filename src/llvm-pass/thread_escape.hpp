@@ -0,0 +1,68 @@
+#pragma once
+
+#include <map>
+#include <set>
+
+//--------------------------------------------------------------------------------------------------
+/// @file thread_escape.hpp
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+namespace llvm {
+class Function;
+class Module;
+class Value;
+} // end namespace llvm
+
+
+namespace concurrency_passes {
+
+/// @brief Whether the pass instruments a whole program, i.e. runs at (full) LTO link time on the
+/// merged module (option -record-replay-whole-program).
+
+bool whole_program_instrumentation();
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Thread-escape analysis of a whole program, telling which memory accesses may touch
+/// memory that another thread accesses as well.
+/// @details A memory object is thread-local if it is
+/// - a thread_local or a constant global variable;
+/// - a stack or heap allocation whose address is not captured, e.g. stored or passed to a
+///   function that may keep it;
+/// - a global variable whose address is only used for direct loads and stores, in functions that
+///   only run on the main thread.
+/// A function may run on a thread other than the main thread if it is reachable from a function
+/// whose address is taken, as the entry of a thread (pthread_create, std::thread) is passed as a
+/// function pointer. This assumes that the module is the whole program: code outside of it only
+/// calls into it through function pointers.
+
+class ThreadEscape
+{
+public:
+   ThreadEscape();
+
+   void initialize(llvm::Module& module);
+
+   /// @brief Returns false if the memory at address is thread-local.
+
+   bool may_be_shared(const llvm::Value& address) const;
+
+private:
+   /// @brief Returns the functions that may run on a thread other than the main thread.
+
+   static std::set<const llvm::Function*> thread_functions(const llvm::Module& module);
+
+   const llvm::Module* m_module;
+
+   /// @brief Global variables that only functions running on the main thread access.
+   std::set<const llvm::Value*> m_main_thread_only;
+
+   /// @brief Memory objects whose thread-locality was already determined.
+   mutable std::map<const llvm::Value*, bool> m_may_be_shared;
+
+}; // end class ThreadEscape
+
+} // end namespace concurrency_passes
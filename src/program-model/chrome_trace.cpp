@@ -0,0 +1,321 @@
+
+#include "chrome_trace.hpp"
+
+#include "visible_instruction_io.hpp"
+
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+
+
+namespace program_model {
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+constexpr int program_pid = 1;
+constexpr int locks_pid = 2;
+
+//--------------------------------------------------------------------------------------------------
+
+std::ostream& write_operand(std::ostream& os, const Object& object)
+{
+   return os << object;
+}
+
+std::ostream& write_operand(std::ostream& os, const Thread& thread)
+{
+   return os << thread.tid();
+}
+
+struct instruction_name : public boost::static_visitor<std::string>
+{
+   template <typename instruction_t>
+   std::string operator()(const instruction_t& instruction) const
+   {
+      std::stringstream stream;
+      write_operand(stream << instruction.operation() << " ", instruction.operand());
+      return stream.str();
+   }
+}; // end struct instruction_name
+
+//--------------------------------------------------------------------------------------------------
+
+std::string escape(const std::string& str)
+{
+   std::string escaped;
+   for (const char c : str)
+   {
+      if (c == '"' || c == '\\')
+         escaped += '\\';
+      if (static_cast<unsigned char>(c) >= 0x20)
+         escaped += c;
+   }
+   return escaped;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Writes the elements of the traceEvents array, separated by commas.
+
+class event_writer
+{
+public:
+   explicit event_writer(std::ostream& os)
+   : m_os(os)
+   , m_first(true)
+   {
+   }
+
+   void name_track(const int pid, const int tid, const std::string& name)
+   {
+      begin() << R"({"ph":"M","name":"thread_name","pid":)" << pid << R"(,"tid":)" << tid
+              << R"(,"args":{"name":")" << escape(name) << R"("}})";
+   }
+
+   void name_process(const int pid, const std::string& name)
+   {
+      begin() << R"({"ph":"M","name":"process_name","pid":)" << pid << R"(,"args":{"name":")"
+              << escape(name) << R"("}})";
+   }
+
+   /// @brief Writes a complete event, leaving its args object open.
+
+   std::ostream& slice(const int pid, const int tid, const std::string& category,
+                       const std::string& name, const uint64_t start, const uint64_t end)
+   {
+      begin() << R"({"ph":"X","pid":)" << pid << R"(,"tid":)" << tid << R"(,"cat":")" << category
+              << R"(","name":")" << escape(name) << R"(","ts":)";
+      write_time(start);
+      m_os << R"(,"dur":)";
+      write_time(end - start);
+      m_os << R"(,"args":{)";
+      return m_os;
+   }
+
+private:
+   std::ostream& m_os;
+   bool m_first;
+
+   std::ostream& begin()
+   {
+      m_os << (m_first ? "\n" : ",\n");
+      m_first = false;
+      return m_os;
+   }
+
+   /// @brief Writes the given nanoseconds as (fractional) microseconds.
+
+   void write_time(const uint64_t ns)
+   {
+      m_os << ns / 1000 << "." << std::setw(3) << std::setfill('0') << ns % 1000
+           << std::setfill(' ');
+   }
+
+}; // end class event_writer
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief An interval in which a thread does not execute.
+
+struct interval_t
+{
+   std::string category;
+   std::string name;
+   uint64_t start;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief An interval in which a lock is held, exclusively or by readers.
+
+struct hold_t
+{
+   bool shared;
+   /// @brief The threads holding the lock.
+   std::set<Thread::tid_t> holders;
+   /// @brief The threads that held the lock since start.
+   std::set<Thread::tid_t> held_by;
+   uint64_t start;
+
+   std::string category() const
+   {
+      return shared ? "shared lock" : "lock";
+   }
+
+   std::string name() const
+   {
+      std::stringstream name;
+      name << (shared ? "read by thread" : "held by thread") << (held_by.size() > 1 ? "s " : " ");
+      for (auto tid = held_by.begin(); tid != held_by.end(); ++tid)
+         name << (tid == held_by.begin() ? "" : ", ") << *tid;
+      return name.str();
+   }
+};
+
+/// @brief Returns whether operation acquires a lock in the given hold state. Lock and ReadLock
+/// are only scheduled when they acquire it, a TryLock acquires a lock that is not held and a
+/// TryReadLock one that is not held exclusively.
+
+bool acquires(const lock_operation operation, const hold_t* hold)
+{
+   switch (operation)
+   {
+      case lock_operation::Lock:
+      case lock_operation::ReadLock:
+         return true;
+      case lock_operation::TryLock:
+         return hold == nullptr;
+      case lock_operation::TryReadLock:
+         return hold == nullptr || hold->shared;
+      default:
+         return false;
+   }
+}
+
+/// @brief Returns whether operation is one on a mutex or readers-writer lock, rather than on a
+/// semaphore or condition variable, which have no track.
+
+bool is_lock_operation(const lock_operation operation)
+{
+   return operation == lock_operation::Unlock || acquires(operation, nullptr);
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+
+void write_chrome_trace(std::ostream& os, const Execution& E,
+                        const std::vector<uint64_t>& step_times)
+{
+   const bool timed = step_times.size() > E.size();
+   const auto start_of = [&step_times, timed](const Execution::index_t index) -> uint64_t {
+      return timed ? step_times[index - 1] : (index - 1) * 1000;
+   };
+
+   os << R"({"displayTimeUnit":"ns","traceEvents":[)";
+   event_writer writer(os);
+   writer.name_process(program_pid, "program");
+   writer.name_process(locks_pid, "locks");
+
+   std::set<Thread::tid_t> threads;
+   std::map<Thread::tid_t, interval_t> not_executing;
+   std::map<Object::ptr_t, int> locks;
+   std::map<Object::ptr_t, hold_t> lock_holds;
+
+   const auto close_not_executing = [&writer, &not_executing](const Thread::tid_t tid,
+                                                              const uint64_t time) {
+      const auto it = not_executing.find(tid);
+      if (it != not_executing.end())
+      {
+         writer.slice(program_pid, tid, it->second.category, it->second.name, it->second.start,
+                      time)
+            << "}}";
+         not_executing.erase(it);
+      }
+   };
+
+   for (Execution::index_t index = 1; index <= E.size(); ++index)
+   {
+      const auto& transition = E[index];
+      const auto& instruction = transition.instr();
+      const auto tid = boost::apply_visitor(get_tid(), instruction);
+      const auto start = start_of(index);
+      const auto end = start_of(index + 1);
+
+      // threads that do not execute in this step
+      for (auto next = transition.pre().next_cbegin(); next != transition.pre().next_cend();
+           ++next)
+      {
+         threads.insert(next->first);
+         if (next->first == tid)
+            continue;
+         const auto category = next->second.enabled ? "waiting" : "blocked";
+         const auto name = next->second.enabled
+                              ? std::string("waiting for scheduler")
+                              : "blocked on " + boost::apply_visitor(instruction_name(),
+                                                                     next->second.instr);
+         const auto it = not_executing.find(next->first);
+         if (it == not_executing.end() || it->second.name != name)
+         {
+            close_not_executing(next->first, start);
+            not_executing[next->first] = interval_t{category, name, start};
+         }
+      }
+      for (const auto& entry : std::map<Thread::tid_t, interval_t>(not_executing))
+      {
+         if (!transition.pre().has_next(entry.first) || entry.first == tid)
+            close_not_executing(entry.first, start);
+      }
+
+      // the executing thread
+      threads.insert(tid);
+      const auto meta_data = boost::apply_visitor(get_meta_data(), instruction);
+      writer.slice(program_pid, tid, "instruction",
+                   boost::apply_visitor(instruction_name(), instruction), start, end)
+         << R"("step":)" << index << R"(,"location":")" << escape(meta_data.file_name) << ":"
+         << meta_data.line_number << R"("}})";
+
+      // lock hold intervals
+      const auto* lock = boost::get<lock_instruction>(&instruction);
+      if (lock && is_lock_operation(lock->operation()))
+      {
+         const auto address = lock->operand().address();
+         const auto lane = locks.emplace(address, int(locks.size())).first->second;
+         const auto hold = lock_holds.find(address);
+         const auto* held = hold == lock_holds.end() ? nullptr : &hold->second;
+         const bool shared = lock->operation() == lock_operation::ReadLock ||
+                             lock->operation() == lock_operation::TryReadLock;
+         if (acquires(lock->operation(), held) && !held)
+         {
+            lock_holds[address] = hold_t{shared, {tid}, {tid}, start};
+         }
+         else if (acquires(lock->operation(), held) && held->shared && shared)
+         {
+            hold->second.holders.insert(tid);
+            hold->second.held_by.insert(tid);
+         }
+         else if (lock->operation() == lock_operation::Unlock && held)
+         {
+            // An exclusive hold ends with any Unlock, a shared one with the last reader's
+            hold->second.holders.erase(tid);
+            if (!held->shared || held->holders.empty())
+            {
+               writer.slice(locks_pid, lane, held->category(), held->name(), held->start, end)
+                  << "}}";
+               lock_holds.erase(hold);
+            }
+         }
+      }
+   }
+
+   const auto end = start_of(E.size() + 1);
+   for (const auto& entry : std::map<Thread::tid_t, interval_t>(not_executing))
+   {
+      close_not_executing(entry.first, end);
+   }
+   for (const auto& hold : lock_holds)
+   {
+      writer.slice(locks_pid, locks[hold.first], hold.second.category(), hold.second.name(),
+                   hold.second.start, end)
+         << "}}";
+   }
+   for (const auto tid : threads)
+   {
+      writer.name_track(program_pid, tid, "thread " + std::to_string(tid));
+   }
+   for (const auto& lock : locks)
+   {
+      std::stringstream name;
+      name << "lock " << Object(lock.first);
+      writer.name_track(locks_pid, lock.second, name.str());
+   }
+   os << "\n]}\n";
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace program_model
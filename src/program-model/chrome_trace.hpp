@@ -0,0 +1,34 @@
+#pragma once
+
+#include "execution.hpp"
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+/// @file chrome_trace.hpp
+/// @brief Export of an Execution to the Chrome Trace Event Format, as opened by Perfetto
+/// (ui.perfetto.dev) and chrome://tracing.
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+namespace program_model {
+
+/// @brief Writes E as a JSON trace with a track per thread and a track per lock.
+/// @details Each Transition becomes a slice on the track of the executing thread, named after its
+/// instruction and carrying its file:line. While a thread does not execute, its track shows the
+/// intervals in which its next instruction is disabled ("blocked") or enabled but not selected
+/// ("waiting"). The track of a mutex or readers-writer lock shows the intervals in which it is
+/// held, exclusively ("lock") or by readers ("shared lock"), including holds taken by a TryLock
+/// or TryReadLock that succeeded. Semaphores and condition variables have no track.
+/// @param step_times The start times, in nanoseconds, of the steps 1..E.size() followed by the
+/// end time of the last step, e.g. as recorded in record_times.txt. When fewer times are given,
+/// every step takes one microsecond.
+
+void write_chrome_trace(std::ostream& os, const Execution& E,
+                        const std::vector<uint64_t>& step_times = {});
+
+} // end namespace program_model
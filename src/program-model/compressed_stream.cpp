@@ -0,0 +1,590 @@
+
+#include "compressed_stream.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+
+namespace program_model {
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+// Parameters of LZ4's block format: matches are at least min_match bytes long and at most
+// max_offset bytes back, the last last_literals bytes of a block are literals and the last match
+// starts at least match_limit bytes before the end of the block.
+constexpr std::size_t min_match = 4;
+constexpr std::size_t max_offset = 65535;
+constexpr std::size_t last_literals = 5;
+constexpr std::size_t match_limit = 12;
+constexpr unsigned int hash_bits = 14;
+/// @brief The number of positions kept per hash.
+constexpr unsigned int ways = 4;
+
+// Fields of LZ4's frame format
+constexpr uint8_t version_flags = 0x40;
+constexpr uint8_t independent_blocks_flag = 0x20;
+constexpr uint8_t block_checksums_flag = 0x10;
+constexpr uint8_t content_size_flag = 0x08;
+constexpr uint8_t content_checksum_flag = 0x04;
+constexpr uint8_t dictionary_flag = 0x01;
+/// @brief The size of the descriptor without content size and dictionary id: the magic number,
+/// the flags, the block maximum size and a checksum.
+constexpr std::size_t min_descriptor_size = 7;
+constexpr uint32_t uncompressed_block_flag = 0x80000000u;
+/// @brief The block maximum size id of compressed_format::block_size.
+constexpr uint8_t block_size_id = 4;
+static_assert(compressed_format::block_size == 1u << (8 + 2 * block_size_id),
+              "block_size_id does not match block_size");
+
+// Primes of xxHash32
+constexpr uint32_t prime1 = 2654435761u;
+constexpr uint32_t prime2 = 2246822519u;
+constexpr uint32_t prime3 = 3266489917u;
+constexpr uint32_t prime4 = 668265263u;
+constexpr uint32_t prime5 = 374761393u;
+
+uint32_t read32(const char* data)
+{
+   uint32_t value;
+   std::memcpy(&value, data, sizeof(value));
+   return value;
+}
+
+/// @brief Reads a little-endian 32-bit value, as in the frame format.
+
+uint32_t read_le32(const char* data)
+{
+   const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+   return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | static_cast<uint32_t>(bytes[3]) << 24;
+}
+
+void write_le32(std::ostream& os, const uint32_t value)
+{
+   const char bytes[4] = {static_cast<char>(value), static_cast<char>(value >> 8),
+                          static_cast<char>(value >> 16), static_cast<char>(value >> 24)};
+   os.write(bytes, sizeof(bytes));
+}
+
+uint32_t rotate_left(const uint32_t value, const unsigned int bits)
+{
+   return (value << bits) | (value >> (32 - bits));
+}
+
+uint32_t xxhash(const char* data, const std::size_t size)
+{
+   compressed_format::xxhash32 hash;
+   hash.update(data, size);
+   return hash.digest();
+}
+
+uint32_t hash(const uint32_t sequence)
+{
+   return (sequence * 2654435761u) >> (32 - hash_bits);
+}
+
+/// @brief The largest size of a compressed block of size bytes.
+
+constexpr std::size_t compress_bound(const std::size_t size)
+{
+   return size + size / 255 + 16;
+}
+
+char* write_length(char* out, std::size_t length)
+{
+   for (; length >= 255; length -= 255)
+      *out++ = static_cast<char>(255);
+   *out++ = static_cast<char>(length);
+   return out;
+}
+
+/// @brief Writes a sequence of the literals [begin, end) followed by a match of match_length
+/// bytes at offset, or by nothing if match_length is 0, and returns the end of the sequence.
+
+char* write_sequence(char* out, const char* begin, const char* end, const std::size_t offset,
+                     const std::size_t match_length)
+{
+   const std::size_t nr_literals = end - begin;
+   const std::size_t match_code = match_length == 0 ? 0 : match_length - min_match;
+   char* token = out++;
+   *token = static_cast<char>((std::min<std::size_t>(nr_literals, 15) << 4) |
+                              std::min<std::size_t>(match_code, 15));
+   if (nr_literals >= 15)
+      out = write_length(out, nr_literals - 15);
+   out = std::copy(begin, end, out);
+   if (match_length == 0)
+      return out;
+   *out++ = static_cast<char>(offset & 0xff);
+   *out++ = static_cast<char>(offset >> 8);
+   if (match_code >= 15)
+      out = write_length(out, match_code - 15);
+   return out;
+}
+
+/// @brief Compresses the size bytes of data into out, which holds compress_bound(size) bytes,
+/// using table as the hash table, and returns the size of the compressed block.
+
+std::size_t compress(const char* data, const std::size_t size, char* out,
+                     std::vector<uint32_t>& table)
+{
+   // Positions in table are offset by 1, so that 0 is no position
+   std::fill(table.begin(), table.end(), 0);
+   char* out_begin = out;
+   std::size_t anchor = 0;
+   std::size_t position = 0;
+   while (size > match_limit && position < size - match_limit)
+   {
+      const auto sequence = read32(data + position);
+      auto* bucket = &table[hash(sequence) * ways];
+      // Take the longest match among the last positions with the same hash
+      std::size_t match = 0;
+      std::size_t length = 0;
+      for (unsigned int way = 0; way < ways && bucket[way] != 0; ++way)
+      {
+         const std::size_t candidate = bucket[way] - 1;
+         if (position - candidate > max_offset || read32(data + candidate) != sequence)
+            continue;
+         std::size_t candidate_length = min_match;
+         while (position + candidate_length < size - last_literals &&
+                data[candidate + candidate_length] == data[position + candidate_length])
+         {
+            ++candidate_length;
+         }
+         if (candidate_length > length)
+         {
+            match = candidate;
+            length = candidate_length;
+         }
+      }
+      std::copy_backward(bucket, bucket + ways - 1, bucket + ways);
+      bucket[0] = static_cast<uint32_t>(position + 1);
+      if (length == 0)
+      {
+         // Skip faster through data that does not compress
+         position += 1 + ((position - anchor) >> 6);
+         continue;
+      }
+      out = write_sequence(out, data + anchor, data + position, position - match, length);
+      position += length;
+      anchor = position;
+   }
+   out = write_sequence(out, data + anchor, data + size, 0, 0);
+   return out - out_begin;
+}
+
+[[noreturn]] void corrupt()
+{
+   throw std::runtime_error("corrupt compressed block");
+}
+
+std::size_t read_length(const char*& in, const char* end, std::size_t length)
+{
+   if (length != 15)
+      return length;
+   unsigned char byte;
+   do
+   {
+      if (in == end)
+         corrupt();
+      byte = static_cast<unsigned char>(*in++);
+      length += byte;
+   } while (byte == 255);
+   return length;
+}
+
+/// @brief Decompresses the block [in, end) into out, which holds capacity bytes, and returns the
+/// size of the decompressed block.
+/// @throws std::runtime_error if the block is corrupt or does not fit in capacity bytes.
+
+std::size_t decompress(const char* in, const char* end, char* out, const std::size_t capacity)
+{
+   std::size_t position = 0;
+   while (true)
+   {
+      if (in == end)
+         corrupt();
+      const auto token = static_cast<unsigned char>(*in++);
+      const auto nr_literals = read_length(in, end, token >> 4);
+      if (nr_literals > static_cast<std::size_t>(end - in) || nr_literals > capacity - position)
+         corrupt();
+      std::copy(in, in + nr_literals, out + position);
+      in += nr_literals;
+      position += nr_literals;
+      if (in == end)
+         return position;
+      if (end - in < 2)
+         corrupt();
+      const std::size_t offset = static_cast<unsigned char>(in[0]) |
+                                 static_cast<std::size_t>(static_cast<unsigned char>(in[1])) << 8;
+      in += 2;
+      const auto length = read_length(in, end, token & 15) + min_match;
+      if (offset == 0 || offset > position || length > capacity - position)
+         corrupt();
+      // The match may overlap the bytes it produces, so it is copied byte by byte
+      for (std::size_t i = 0; i < length; ++i)
+         out[position + i] = out[position - offset + i];
+      position += length;
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief The settings of a frame that matter for reading its blocks.
+
+struct frame_t
+{
+   std::size_t block_max_size;
+   bool block_checksums;
+   bool content_checksum;
+};
+
+/// @brief The size of the frame descriptor starting with data, of which the first
+/// min_descriptor_size bytes are given.
+
+std::size_t descriptor_size(const char* data)
+{
+   const auto flags = static_cast<uint8_t>(data[4]);
+   return min_descriptor_size + (flags & content_size_flag ? 8 : 0) +
+          (flags & dictionary_flag ? 4 : 0);
+}
+
+/// @brief Reads the frame descriptor data of descriptor_size(data) bytes.
+/// @throws std::runtime_error if it is corrupt or uses features that are not supported.
+
+frame_t read_descriptor(const char* data, const std::size_t size)
+{
+   const auto flags = static_cast<uint8_t>(data[4]);
+   const auto block_descriptor = static_cast<uint8_t>(data[5]);
+   if ((xxhash(data + 4, size - 5) >> 8 & 0xff) != static_cast<uint8_t>(data[size - 1]))
+      throw std::runtime_error("corrupt LZ4 frame descriptor");
+   if ((flags & 0xc2) != version_flags || (block_descriptor & 0x8f) != 0)
+      throw std::runtime_error("unsupported LZ4 frame version");
+   if (!(flags & independent_blocks_flag))
+      throw std::runtime_error("dependent LZ4 blocks are not supported");
+   if (flags & dictionary_flag)
+      throw std::runtime_error("LZ4 dictionaries are not supported");
+   const unsigned int id = block_descriptor >> 4;
+   const std::size_t block_max_size = std::size_t{1} << (8 + 2 * id);
+   if (id < 4 || block_max_size > compressed_format::max_block_size)
+      throw std::runtime_error("unsupported LZ4 block maximum size");
+   return {block_max_size, (flags & block_checksums_flag) != 0,
+           (flags & content_checksum_flag) != 0};
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+// compressed_format
+//--------------------------------------------------------------------------------------------------
+
+bool compressed_format::is_compressed(const char* data, const std::size_t size)
+{
+   return size >= min_descriptor_size && read_le32(data) == magic;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::vector<char> compressed_format::decompress(const char* data, const std::size_t size)
+{
+   if (!is_compressed(data, size))
+      throw std::runtime_error("not a compressed file");
+   std::size_t offset = descriptor_size(data);
+   if (size < offset)
+      throw std::runtime_error("compressed file is truncated");
+   const auto frame = read_descriptor(data, offset);
+   const std::size_t checksum_size = frame.block_checksums ? 4 : 0;
+   std::vector<char> decompressed;
+   xxhash32 checksum;
+   while (true)
+   {
+      if (size - offset < 4)
+         throw std::runtime_error("compressed file is truncated");
+      const auto block = read_le32(data + offset);
+      offset += 4;
+      if (block == 0)
+         break;
+      const std::size_t stored_size = block & ~uncompressed_block_flag;
+      if (stored_size > frame.block_max_size)
+         corrupt();
+      if (size - offset < stored_size + checksum_size)
+         throw std::runtime_error("compressed file is truncated");
+      const char* stored = data + offset;
+      if (frame.block_checksums && xxhash(stored, stored_size) != read_le32(stored + stored_size))
+         corrupt();
+      const auto begin = decompressed.size();
+      decompressed.resize(begin + frame.block_max_size);
+      char* out = decompressed.data() + begin;
+      std::size_t block_size = stored_size;
+      if (block & uncompressed_block_flag)
+         std::memcpy(out, stored, stored_size);
+      else
+         block_size = program_model::decompress(stored, stored + stored_size, out,
+                                                frame.block_max_size);
+      decompressed.resize(begin + block_size);
+      checksum.update(out, block_size);
+      offset += stored_size + checksum_size;
+   }
+   if (frame.content_checksum)
+   {
+      if (size - offset < 4)
+         throw std::runtime_error("compressed file is truncated");
+      if (checksum.digest() != read_le32(data + offset))
+         throw std::runtime_error("compressed file does not match its checksum");
+   }
+   return decompressed;
+}
+
+//--------------------------------------------------------------------------------------------------
+// xxhash32
+//--------------------------------------------------------------------------------------------------
+
+compressed_format::xxhash32::xxhash32()
+: m_lanes{prime1 + prime2, prime2, 0, 0 - prime1}
+, m_stripe()
+, m_stripe_size(0)
+, m_size(0)
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void compressed_format::xxhash32::update(const char* data, const std::size_t size)
+{
+   const auto round = [](const uint32_t lane, const char* input) {
+      return rotate_left(lane + read_le32(input) * prime2, 13) * prime1;
+   };
+   m_size += size;
+   const char* end = data + size;
+   if (m_stripe_size > 0)
+   {
+      const auto taken = std::min<std::size_t>(sizeof(m_stripe) - m_stripe_size, size);
+      std::memcpy(m_stripe + m_stripe_size, data, taken);
+      m_stripe_size += taken;
+      data += taken;
+      if (m_stripe_size < sizeof(m_stripe))
+         return;
+      for (unsigned int lane = 0; lane < 4; ++lane)
+         m_lanes[lane] = round(m_lanes[lane], reinterpret_cast<const char*>(m_stripe) + 4 * lane);
+      m_stripe_size = 0;
+   }
+   for (; end - data >= 16; data += 16)
+   {
+      for (unsigned int lane = 0; lane < 4; ++lane)
+         m_lanes[lane] = round(m_lanes[lane], data + 4 * lane);
+   }
+   std::memcpy(m_stripe, data, end - data);
+   m_stripe_size = end - data;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t compressed_format::xxhash32::digest() const
+{
+   uint32_t hash = m_size >= 16 ? rotate_left(m_lanes[0], 1) + rotate_left(m_lanes[1], 7) +
+                                     rotate_left(m_lanes[2], 12) + rotate_left(m_lanes[3], 18)
+                                : prime5;
+   hash += static_cast<uint32_t>(m_size);
+   const char* data = reinterpret_cast<const char*>(m_stripe);
+   std::size_t i = 0;
+   for (; i + 4 <= m_stripe_size; i += 4)
+      hash = rotate_left(hash + read_le32(data + i) * prime3, 17) * prime4;
+   for (; i < m_stripe_size; ++i)
+      hash = rotate_left(hash + m_stripe[i] * prime5, 11) * prime1;
+   hash ^= hash >> 15;
+   hash *= prime2;
+   hash ^= hash >> 13;
+   hash *= prime3;
+   hash ^= hash >> 16;
+   return hash;
+}
+
+//--------------------------------------------------------------------------------------------------
+// compressing_streambuf
+//--------------------------------------------------------------------------------------------------
+
+compressing_streambuf::compressing_streambuf(std::ostream& os)
+: m_os(os)
+, m_buffer(compressed_format::block_size)
+, m_compressed(compress_bound(compressed_format::block_size))
+, m_table(std::size_t{ways} << hash_bits)
+, m_checksum()
+, m_finished(false)
+{
+   setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+   char descriptor[min_descriptor_size];
+   for (unsigned int i = 0; i < 4; ++i)
+      descriptor[i] = static_cast<char>(compressed_format::magic >> (8 * i));
+   descriptor[4] =
+      static_cast<char>(version_flags | independent_blocks_flag | content_checksum_flag);
+   descriptor[5] = static_cast<char>(block_size_id << 4);
+   descriptor[6] = static_cast<char>(xxhash(descriptor + 4, 2) >> 8);
+   m_os.write(descriptor, sizeof(descriptor));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void compressing_streambuf::finish()
+{
+   if (m_finished)
+      return;
+   write_block();
+   write_le32(m_os, 0);
+   write_le32(m_os, m_checksum.digest());
+   m_os.flush();
+   m_finished = true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+auto compressing_streambuf::overflow(const int_type c) -> int_type
+{
+   if (m_finished)
+      return traits_type::eof();
+   write_block();
+   if (!traits_type::eq_int_type(c, traits_type::eof()))
+   {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+   }
+   return m_os ? traits_type::not_eof(c) : traits_type::eof();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @note Only compresses full blocks, as flushing a partial block would split the stream into
+/// smaller blocks, which compress worse.
+
+int compressing_streambuf::sync()
+{
+   return m_os ? 0 : -1;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void compressing_streambuf::write_block()
+{
+   const std::size_t size = pptr() - pbase();
+   if (size == 0)
+      return;
+   m_checksum.update(pbase(), size);
+   std::size_t stored_size = compress(pbase(), size, m_compressed.data(), m_table);
+   const char* stored = m_compressed.data();
+   uint32_t block = static_cast<uint32_t>(stored_size);
+   if (stored_size >= size)
+   {
+      stored_size = size;
+      stored = pbase();
+      block = static_cast<uint32_t>(size) | uncompressed_block_flag;
+   }
+   write_le32(m_os, block);
+   m_os.write(stored, stored_size);
+   setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+}
+
+//--------------------------------------------------------------------------------------------------
+// decompressing_streambuf
+//--------------------------------------------------------------------------------------------------
+
+decompressing_streambuf::decompressing_streambuf(std::istream& is)
+: m_is(is)
+, m_buffer()
+, m_compressed()
+, m_block_checksums(false)
+, m_content_checksum(false)
+, m_checksum()
+, m_finished(false)
+{
+   char descriptor[min_descriptor_size + 12];
+   if (!m_is.read(descriptor, min_descriptor_size) ||
+       !compressed_format::is_compressed(descriptor, min_descriptor_size))
+      throw std::runtime_error("not a compressed file");
+   const auto size = descriptor_size(descriptor);
+   if (!m_is.read(descriptor + min_descriptor_size, size - min_descriptor_size))
+      throw std::runtime_error("compressed file is truncated");
+   const auto frame = read_descriptor(descriptor, size);
+   m_block_checksums = frame.block_checksums;
+   m_content_checksum = frame.content_checksum;
+   m_buffer.resize(frame.block_max_size);
+   m_compressed.resize(frame.block_max_size);
+   setg(m_buffer.data(), m_buffer.data(), m_buffer.data());
+}
+
+//--------------------------------------------------------------------------------------------------
+
+auto decompressing_streambuf::underflow() -> int_type
+{
+   if (m_finished)
+      return traits_type::eof();
+   char field[4];
+   if (!m_is.read(field, sizeof(field)))
+      throw std::runtime_error("compressed file is truncated");
+   const auto block = read_le32(field);
+   if (block == 0)
+   {
+      if (m_content_checksum &&
+          (!m_is.read(field, sizeof(field)) || m_checksum.digest() != read_le32(field)))
+         throw std::runtime_error("compressed file does not match its checksum");
+      m_finished = true;
+      return traits_type::eof();
+   }
+   const std::size_t stored_size = block & ~uncompressed_block_flag;
+   if (stored_size > m_buffer.size())
+      corrupt();
+   const bool uncompressed = (block & uncompressed_block_flag) != 0;
+   char* stored = uncompressed ? m_buffer.data() : m_compressed.data();
+   if (!m_is.read(stored, stored_size))
+      throw std::runtime_error("compressed file is truncated");
+   if (m_block_checksums &&
+       (!m_is.read(field, sizeof(field)) || xxhash(stored, stored_size) != read_le32(field)))
+      corrupt();
+   const std::size_t size =
+      uncompressed ? stored_size
+                   : decompress(stored, stored + stored_size, m_buffer.data(), m_buffer.size());
+   m_checksum.update(m_buffer.data(), size);
+   if (size == 0)
+      return underflow();
+   setg(m_buffer.data(), m_buffer.data(), m_buffer.data() + size);
+   return traits_type::to_int_type(*gptr());
+}
+
+//--------------------------------------------------------------------------------------------------
+// compressed_ostream
+//--------------------------------------------------------------------------------------------------
+
+compressed_ostream::compressed_ostream(std::ostream& os)
+: std::ostream(nullptr)
+, m_streambuf(os)
+{
+   rdbuf(&m_streambuf);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+compressed_ostream::~compressed_ostream()
+{
+   m_streambuf.finish();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void compressed_ostream::close()
+{
+   m_streambuf.finish();
+}
+
+//--------------------------------------------------------------------------------------------------
+// decompressed_istream
+//--------------------------------------------------------------------------------------------------
+
+decompressed_istream::decompressed_istream(std::istream& is)
+: std::istream(nullptr)
+, m_streambuf(is)
+{
+   rdbuf(&m_streambuf);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace program_model
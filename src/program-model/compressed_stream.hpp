@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+/// @file compressed_stream.hpp
+/// @brief Streams that compress what is written to them, resp. decompress what is read from them,
+/// block by block, e.g. for compressed record files.
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+namespace program_model {
+namespace compressed_format {
+
+/// @brief A compressed file is an LZ4 frame, as read and written by the lz4 tool (see
+/// doc/lz4_Frame_format.md in the LZ4 sources): a frame descriptor, blocks and an end mark,
+/// followed by the xxHash32 of the uncompressed stream. A block holds at most the block maximum
+/// size of the descriptor of the uncompressed stream, compressed in LZ4's block format, or as is
+/// if that is not smaller (the high bit of its 4-byte size set).
+/// @details Files are written with independent blocks of at most block_size bytes. Reading
+/// accepts block maximum sizes up to max_block_size, a content size and block checksums, but not
+/// dependent blocks or dictionaries, which the lz4 tool only uses when asked to.
+
+constexpr uint32_t magic = 0x184D2204;
+constexpr uint32_t block_size = 1 << 16;
+constexpr uint32_t max_block_size = 1 << 22;
+
+/// @brief Whether the given data starts like a compressed file.
+
+bool is_compressed(const char* data, std::size_t size);
+
+/// @brief Decompresses a whole compressed file held in memory.
+/// @throws std::runtime_error if the data is not a valid compressed file.
+
+std::vector<char> decompress(const char* data, std::size_t size);
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Incremental xxHash32 with seed 0, the checksum of the LZ4 frame format.
+
+class xxhash32
+{
+public:
+   xxhash32();
+
+   void update(const char* data, std::size_t size);
+
+   uint32_t digest() const;
+
+private:
+   uint32_t m_lanes[4];
+   /// @brief The bytes following the last full stripe of 16 bytes.
+   unsigned char m_stripe[16];
+   std::size_t m_stripe_size;
+   uint64_t m_size;
+
+}; // end class xxhash32
+
+} // end namespace compressed_format
+
+//--------------------------------------------------------------------------------------------------
+
+class compressing_streambuf : public std::streambuf
+{
+public:
+   explicit compressing_streambuf(std::ostream& os);
+
+   /// @brief Compresses what is left in the buffer and ends the compressed file.
+
+   void finish();
+
+protected:
+   int_type overflow(int_type c) override;
+   int sync() override;
+
+private:
+   void write_block();
+
+   std::ostream& m_os;
+   std::vector<char> m_buffer;
+   std::vector<char> m_compressed;
+   /// @brief Positions of the last occurrences of 4-byte sequences in m_buffer, by hash.
+   std::vector<uint32_t> m_table;
+   /// @brief Of the uncompressed stream so far.
+   compressed_format::xxhash32 m_checksum;
+   bool m_finished;
+
+}; // end class compressing_streambuf
+
+//--------------------------------------------------------------------------------------------------
+
+class decompressing_streambuf : public std::streambuf
+{
+public:
+   /// @throws std::runtime_error if is does not start like a compressed file.
+
+   explicit decompressing_streambuf(std::istream& is);
+
+protected:
+   /// @throws std::runtime_error if a block is truncated or corrupt.
+
+   int_type underflow() override;
+
+private:
+   std::istream& m_is;
+   std::vector<char> m_buffer;
+   std::vector<char> m_compressed;
+   bool m_block_checksums;
+   bool m_content_checksum;
+   /// @brief Of the uncompressed stream so far.
+   compressed_format::xxhash32 m_checksum;
+   bool m_finished;
+
+}; // end class decompressing_streambuf
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief An std::ostream writing a compressed file to the given stream, which is complete when
+/// the compressed_ostream is closed or destroyed.
+
+class compressed_ostream : public std::ostream
+{
+public:
+   explicit compressed_ostream(std::ostream& os);
+   ~compressed_ostream() override;
+
+   void close();
+
+private:
+   compressing_streambuf m_streambuf;
+
+}; // end class compressed_ostream
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief An std::istream reading the uncompressed contents of a compressed file from the given
+/// stream, decompressing one block at a time. A truncated or corrupt block, or a checksum that
+/// does not match, sets badbit.
+
+class decompressed_istream : public std::istream
+{
+public:
+   /// @throws std::runtime_error if is does not start like a compressed file.
+
+   explicit decompressed_istream(std::istream& is);
+
+private:
+   decompressing_streambuf m_streambuf;
+
+}; // end class decompressed_istream
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace program_model
@@ -7,8 +7,16 @@
 #include "transition_io.hpp"
 #include "visible_instruction_io.hpp"
 
+#include "record_format.hpp"
+
 #include <utils_io.hpp>
 
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
 
 namespace program_model {
 
@@ -169,4 +177,205 @@ std::istream& operator>>(std::istream& is, Execution& E)
 
 //--------------------------------------------------------------------------------------------------
 
+namespace {
+
+/// @brief Writes the parts of an Execution to a record file, numbering the file names in the
+/// order in which they first appear.
+
+class binary_writer
+{
+public:
+   explicit binary_writer(std::ostream& os)
+   : m_os(os)
+   {
+   }
+
+   template <typename T>
+   void write(const T& data)
+   {
+      m_os.write(reinterpret_cast<const char*>(&data), sizeof(T));
+   }
+
+   void write_state(const State& state)
+   {
+      write(record_format::state_t{static_cast<uint32_t>(state.enabled().size()),
+                                   static_cast<uint32_t>(std::distance(state.next_cbegin(),
+                                                                       state.next_cend()))});
+      for (const auto tid : state.enabled())
+         write(static_cast<int32_t>(tid));
+      if (state.enabled().size() % 2 != 0)
+         write(int32_t{0});
+      // NextSet is unordered
+      std::vector<Thread::tid_t> tids;
+      for (auto next = state.next_cbegin(); next != state.next_cend(); ++next)
+         tids.push_back(next->first);
+      std::sort(tids.begin(), tids.end());
+      for (const auto tid : tids)
+      {
+         const auto& next = state.next(tid)->second;
+         write(record_format::next_t{tid, next.enabled, encode(next.instr)});
+      }
+   }
+
+   record_format::instruction_t encode(const visible_instruction_t& instruction)
+   {
+      record_format::instruction_t encoded{};
+      encoded.tid = boost::apply_visitor(program_model::get_tid(), instruction);
+      encoded.kind = static_cast<uint8_t>(instruction.which());
+      encoded.operation =
+         static_cast<uint8_t>(boost::apply_visitor(program_model::operation_as_int(), instruction));
+      const auto operand = boost::apply_visitor(program_model::get_operand(), instruction);
+      if (const auto* object = boost::get<Object>(&operand))
+         encoded.operand = reinterpret_cast<uintptr_t>(object->address());
+      else
+         encoded.operand = static_cast<uint64_t>(boost::get<Thread>(operand).tid());
+      if (const auto* memory_instr = boost::get<memory_instruction>(&instruction))
+         encoded.is_atomic = memory_instr->is_atomic();
+      const auto& meta_data = boost::apply_visitor(program_model::get_meta_data(), instruction);
+      encoded.file_name = string_index(meta_data.file_name);
+      encoded.line_number = meta_data.line_number;
+      return encoded;
+   }
+
+   /// @brief Writes the string table at the given offset and returns the offset of its end.
+
+   uint64_t write_strings(uint64_t offset)
+   {
+      write(record_format::string_table{m_strings.size()});
+      offset += sizeof(record_format::string_table) +
+                m_strings.size() * sizeof(record_format::string_t);
+      for (const auto* str : m_strings)
+      {
+         write(record_format::string_t{offset, str->size()});
+         offset += str->size();
+      }
+      for (const auto* str : m_strings)
+         m_os.write(str->data(), str->size());
+      return offset;
+   }
+
+   /// @brief Pads the file from the given offset to a multiple of 8 bytes and returns the offset
+   /// of the end of the padding.
+
+   uint64_t pad(const uint64_t offset)
+   {
+      const uint64_t padded = (offset + 7) / 8 * 8;
+      m_os.write(padding, padded - offset);
+      return padded;
+   }
+
+   using steps_t = std::map<uint64_t, std::vector<uint32_t>>;
+
+   /// @brief Writes the index of the given steps of threads and objects at the given offset,
+   /// followed by the index_trailer.
+
+   void write_index(const uint64_t offset, const steps_t& threads, const steps_t& objects)
+   {
+      write(record_format::index_header{threads.size(), objects.size()});
+      uint64_t steps = offset + sizeof(record_format::index_header) +
+                       (threads.size() + objects.size()) * sizeof(record_format::index_entry_t);
+      for (const auto* keys : {&threads, &objects})
+      {
+         for (const auto& key : *keys)
+         {
+            write(record_format::index_entry_t{key.first, steps, key.second.size()});
+            steps += (key.second.size() * sizeof(uint32_t) + 7) / 8 * 8;
+         }
+      }
+      for (const auto* keys : {&threads, &objects})
+      {
+         for (const auto& key : *keys)
+         {
+            const auto size = key.second.size() * sizeof(uint32_t);
+            m_os.write(reinterpret_cast<const char*>(key.second.data()), size);
+            pad(size);
+         }
+      }
+      record_format::index_trailer trailer{offset, {}};
+      std::memcpy(trailer.magic, record_format::index_magic, sizeof(record_format::index_magic));
+      write(trailer);
+   }
+
+private:
+   uint32_t string_index(const interned_string& str)
+   {
+      const auto index = m_string_indices.emplace(&str.str(), m_strings.size());
+      if (index.second)
+         m_strings.push_back(&str.str());
+      return index.first->second;
+   }
+
+   std::ostream& m_os;
+   /// @brief Interned strings are unique, so they are numbered by address.
+   std::unordered_map<const std::string*, uint32_t> m_string_indices;
+   std::vector<const std::string*> m_strings;
+
+   static constexpr char padding[8] = {};
+
+}; // end class binary_writer
+
+constexpr char binary_writer::padding[8];
+
+//--------------------------------------------------------------------------------------------------
+
+uint64_t state_size(const State& state)
+{
+   return record_format::state_size(state.enabled().size(),
+                                    std::distance(state.next_cbegin(), state.next_cend()));
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+
+void write_binary(std::ostream& os, const Execution& E)
+{
+   using namespace record_format;
+
+   // Lay the states out first, to know where the post states of the transitions are
+   const uint64_t transitions = sizeof(file_header);
+   const uint64_t s0 = transitions + E.size() * sizeof(transition_t);
+   std::unordered_map<const State*, uint64_t> state_offsets{{&E.s0(), s0}};
+   std::vector<const State*> states{&E.s0()};
+   uint64_t offset = s0 + state_size(E.s0());
+   for (const auto& transition : E)
+   {
+      if (state_offsets.emplace(&transition.post(), offset).second)
+      {
+         states.push_back(&transition.post());
+         offset += state_size(transition.post());
+      }
+   }
+
+   binary_writer writer(os);
+   file_header header{};
+   std::memcpy(header.magic, magic, sizeof(magic));
+   header.version = version;
+   header.status = static_cast<uint32_t>(E.status());
+   header.nr_transitions = E.size();
+   header.transitions = transitions;
+   header.s0 = s0;
+   header.strings = offset;
+   writer.write(header);
+   binary_writer::steps_t threads;
+   binary_writer::steps_t objects;
+   uint32_t step = 0;
+   for (const auto& transition : E)
+   {
+      const auto instruction = writer.encode(transition.instr());
+      writer.write(transition_t{instruction, state_offsets[&transition.post()]});
+      threads[static_cast<uint64_t>(instruction.tid)].push_back(++step);
+      if (!boost::get<thread_management_instruction>(&transition.instr()))
+         objects[instruction.operand].push_back(step);
+   }
+   for (const auto* state : states)
+   {
+      writer.write_state(*state);
+   }
+   const auto index = writer.pad(writer.write_strings(offset));
+   writer.write_index(index, threads, objects);
+}
+
+//--------------------------------------------------------------------------------------------------
+
 } // end namespace program_model
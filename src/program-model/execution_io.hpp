@@ -26,4 +26,10 @@ std::ostream& operator<<(std::ostream& os, const Execution& E);
 
 std::istream& operator>>(std::istream& is, Execution& E);
 
+/// @brief Writes E in the binary format of record.bin (see record_format.hpp), which
+/// mapped_execution reads in place, with an index of the steps of each thread and object.
+/// @pre E.initialized()
+
+void write_binary(std::ostream& os, const Execution& E);
+
 } // end namespace program_model
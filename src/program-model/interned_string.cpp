@@ -0,0 +1,122 @@
+
+#include "interned_string.hpp"
+
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+
+namespace program_model {
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+const std::string* intern(const std::string& str)
+{
+   static std::mutex mutex;
+   static std::unordered_set<std::string> strings;
+   std::lock_guard<std::mutex> lock(mutex);
+   return &*strings.insert(str).first;
+}
+
+const std::string* empty_string()
+{
+   static const std::string* empty = intern("");
+   return empty;
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+
+interned_string::interned_string()
+: m_str(empty_string())
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+
+interned_string::interned_string(const std::string& str)
+: m_str(intern(str))
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+
+interned_string::interned_string(const char* str)
+: m_str(intern(str))
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+
+interned_string::interned_string(const std::string* str)
+: m_str(str)
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+
+interned_string interned_string::from_static(const char* str)
+{
+   thread_local std::unordered_map<const char*, const std::string*> cache;
+   auto it = cache.find(str);
+   if (it == cache.end())
+   {
+      it = cache.emplace(str, intern(str)).first;
+   }
+   return interned_string(it->second);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+const std::string& interned_string::str() const
+{
+   return *m_str;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+interned_string::operator const std::string&() const
+{
+   return *m_str;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool interned_string::operator==(const interned_string& other) const
+{
+   return m_str == other.m_str;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool interned_string::operator!=(const interned_string& other) const
+{
+   return m_str != other.m_str;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::ostream& operator<<(std::ostream& os, const interned_string& str)
+{
+   return os << str.str();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::istream& operator>>(std::istream& is, interned_string& str)
+{
+   std::string read;
+   if (is >> read)
+   {
+      str = interned_string(read);
+   }
+   return is;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace program_model
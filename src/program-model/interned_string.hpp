@@ -0,0 +1,56 @@
+#pragma once
+
+#include <iosfwd>
+#include <string>
+
+//--------------------------------------------------------------------------------------------------
+/// @file interned_string.hpp
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+namespace program_model {
+
+/// @brief Handle to a string in a process-wide table of strings that are never freed.
+/// @details Copying and comparing an interned_string compares and copies a pointer, so that
+/// instructions carrying file names can be passed around without allocating.
+
+class interned_string
+{
+public:
+   /// @brief Constructs the empty string.
+
+   interned_string();
+
+   /// @brief Interns str, looking it up in the table under a lock.
+
+   interned_string(const std::string& str);
+   interned_string(const char* str);
+
+   /// @brief Interns str, caching the result per thread by the address of str. After the first
+   /// lookup by a thread, this neither locks nor allocates.
+   /// @pre str has static storage duration, e.g. it is a string literal or a global emitted by
+   /// the instrumentation.
+
+   static interned_string from_static(const char* str);
+
+   const std::string& str() const;
+   operator const std::string&() const;
+
+   bool operator==(const interned_string& other) const;
+   bool operator!=(const interned_string& other) const;
+
+private:
+   explicit interned_string(const std::string* str);
+
+   const std::string* m_str;
+
+}; // end class interned_string
+
+//--------------------------------------------------------------------------------------------------
+
+std::ostream& operator<<(std::ostream& os, const interned_string& str);
+std::istream& operator>>(std::istream& is, interned_string& str);
+
+} // end namespace program_model
@@ -0,0 +1,515 @@
+
+#include "mapped_execution.hpp"
+
+#include "compressed_stream.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace program_model {
+namespace {
+
+/// @brief Whether operation is an operation of the instruction type with the given index in
+/// visible_instruction_t.
+
+bool is_valid_operation(const uint8_t kind, const uint8_t operation)
+{
+   switch (kind)
+   {
+      case 0:
+         switch (static_cast<memory_operation>(operation))
+         {
+            case memory_operation::Load:
+            case memory_operation::Store:
+            case memory_operation::Await:
+            case memory_operation::ReadModifyWrite: return true;
+         }
+         return false;
+      case 1:
+         switch (static_cast<lock_operation>(operation))
+         {
+            case lock_operation::Lock:
+            case lock_operation::Unlock:
+            case lock_operation::TryLock:
+            case lock_operation::ReadLock:
+            case lock_operation::TryReadLock:
+            case lock_operation::SemWait:
+            case lock_operation::SemTryWait:
+            case lock_operation::SemPost:
+            case lock_operation::CondWait:
+            case lock_operation::CondSignal:
+            case lock_operation::CondBroadcast: return true;
+         }
+         return false;
+      case 2:
+         switch (static_cast<thread_management_operation>(operation))
+         {
+            case thread_management_operation::Spawn:
+            case thread_management_operation::Join: return true;
+         }
+         return false;
+      default: return false;
+   }
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+// state_view
+//--------------------------------------------------------------------------------------------------
+
+state_view::state_view(const mapped_execution& execution, const record_format::state_t& state)
+: m_execution(&execution)
+, m_state(&state)
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::size_t state_view::nr_enabled() const
+{
+   return m_state->nr_enabled;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+const int32_t* state_view::enabled_begin() const
+{
+   return reinterpret_cast<const int32_t*>(m_state + 1);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+const int32_t* state_view::enabled_end() const
+{
+   return enabled_begin() + m_state->nr_enabled;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool state_view::is_enabled(const Thread::tid_t& tid) const
+{
+   return std::binary_search(enabled_begin(), enabled_end(), tid);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+const record_format::next_t* state_view::next_begin() const
+{
+   return reinterpret_cast<const record_format::next_t*>(
+      reinterpret_cast<const char*>(m_state) +
+      record_format::state_size(m_state->nr_enabled, 0));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+boost::optional<next_t> state_view::next(const Thread::tid_t& tid) const
+{
+   const auto* end = next_begin() + m_state->nr_next;
+   const auto* next = std::lower_bound(
+      next_begin(), end, tid,
+      [](const record_format::next_t& next, const Thread::tid_t& tid) { return next.tid < tid; });
+   if (next == end || next->tid != tid)
+      return boost::none;
+   return next_t{m_execution->decode(next->instruction), next->enabled != 0};
+}
+
+//--------------------------------------------------------------------------------------------------
+
+State::SharedPtr state_view::decode() const
+{
+   Tids enabled(enabled_begin(), enabled_end());
+   NextSet next;
+   for (auto it = next_begin(); it != next_begin() + m_state->nr_next; ++it)
+   {
+      next.emplace(it->tid, next_t{m_execution->decode(it->instruction), it->enabled != 0});
+   }
+   return std::make_shared<State>(enabled, next);
+}
+
+//--------------------------------------------------------------------------------------------------
+// transition_view
+//--------------------------------------------------------------------------------------------------
+
+transition_view::transition_view(const mapped_execution& execution,
+                                 const Execution::index_t index)
+: m_execution(&execution)
+, m_index(index)
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+
+Execution::index_t transition_view::index() const
+{
+   return m_index;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+Thread::tid_t transition_view::tid() const
+{
+   return encoded_instr().tid;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+const record_format::instruction_t& transition_view::encoded_instr() const
+{
+   return m_execution->transition(m_index).instruction;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+visible_instruction_t transition_view::instr() const
+{
+   return m_execution->decode(encoded_instr());
+}
+
+//--------------------------------------------------------------------------------------------------
+
+state_view transition_view::pre() const
+{
+   return m_index == 1 ? m_execution->s0() : transition_view(*m_execution, m_index - 1).post();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+state_view transition_view::post() const
+{
+   return m_execution->state(m_execution->transition(m_index).post);
+}
+
+//--------------------------------------------------------------------------------------------------
+// mapped_execution::iterator
+//--------------------------------------------------------------------------------------------------
+
+mapped_execution::iterator::iterator(const mapped_execution& execution,
+                                     const Execution::index_t index)
+: m_execution(&execution)
+, m_index(index)
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+
+transition_view mapped_execution::iterator::operator*() const
+{
+   return transition_view(*m_execution, m_index);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+auto mapped_execution::iterator::operator++() -> iterator&
+{
+   ++m_index;
+   return *this;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool mapped_execution::iterator::operator==(const iterator& other) const
+{
+   return m_execution == other.m_execution && m_index == other.m_index;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool mapped_execution::iterator::operator!=(const iterator& other) const
+{
+   return !(*this == other);
+}
+
+//--------------------------------------------------------------------------------------------------
+// mapped_execution
+//--------------------------------------------------------------------------------------------------
+
+mapped_execution::mapped_execution(const std::string& file_name)
+: m_data(nullptr)
+, m_size(0)
+, m_header(nullptr)
+, m_index(nullptr)
+{
+   const int fd = ::open(file_name.c_str(), O_RDONLY);
+   if (fd < 0)
+      throw std::runtime_error("cannot open " + file_name);
+   struct stat status;
+   if (::fstat(fd, &status) != 0 ||
+       static_cast<std::size_t>(status.st_size) < sizeof(record_format::file_header))
+   {
+      ::close(fd);
+      throw std::runtime_error(file_name + " is not a record file");
+   }
+   m_size = status.st_size;
+   void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   ::close(fd);
+   if (data == MAP_FAILED)
+      throw std::runtime_error("cannot map " + file_name);
+   m_data = static_cast<const char*>(data);
+
+   try
+   {
+      if (compressed_format::is_compressed(m_data, m_size))
+      {
+         auto decompressed = compressed_format::decompress(m_data, m_size);
+         if (decompressed.size() < sizeof(record_format::file_header))
+            throw std::runtime_error(file_name + " is not a record file");
+         ::munmap(data, m_size);
+         m_decompressed = std::move(decompressed);
+         m_data = m_decompressed.data();
+         m_size = m_decompressed.size();
+      }
+      m_header = &at<record_format::file_header>(0);
+      if (std::memcmp(m_header->magic, record_format::magic, sizeof(record_format::magic)) != 0)
+         throw std::runtime_error(file_name + " is not a record file");
+      if (m_header->version != record_format::version)
+         throw std::runtime_error("unsupported record version " +
+                                  std::to_string(m_header->version));
+      at<record_format::transition_t>(m_header->transitions, m_header->nr_transitions);
+      const auto& strings = at<record_format::string_table>(m_header->strings);
+      const auto* string_begin =
+         &at<record_format::string_t>(m_header->strings + sizeof(strings), strings.nr_strings);
+      m_strings.reserve(strings.nr_strings);
+      for (const auto* str = string_begin; str != string_begin + strings.nr_strings; ++str)
+      {
+         m_strings.emplace_back(std::string(&at<char>(str->offset, str->length), str->length));
+      }
+      const auto& trailer =
+         at<record_format::index_trailer>(m_size - sizeof(record_format::index_trailer));
+      if (std::memcmp(trailer.magic, record_format::index_magic,
+                      sizeof(record_format::index_magic)) == 0)
+      {
+         m_index = &at<record_format::index_header>(trailer.index);
+         at<record_format::index_entry_t>(trailer.index + sizeof(*m_index),
+                                          m_index->nr_threads + m_index->nr_objects);
+      }
+      if (m_header->status > static_cast<uint32_t>(Execution::Status::ERROR))
+         throw std::runtime_error("invalid status in record file");
+   }
+   catch (...)
+   {
+      if (m_decompressed.empty())
+         ::munmap(const_cast<char*>(m_data), m_size);
+      throw;
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+mapped_execution::~mapped_execution()
+{
+   if (m_decompressed.empty())
+      ::munmap(const_cast<char*>(m_data), m_size);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::size_t mapped_execution::size() const
+{
+   return m_header->nr_transitions;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool mapped_execution::empty() const
+{
+   return size() == 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+Execution::Status mapped_execution::status() const
+{
+   return static_cast<Execution::Status>(m_header->status);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+state_view mapped_execution::s0() const
+{
+   return state(m_header->s0);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+transition_view mapped_execution::operator[](const Execution::index_t index) const
+{
+   return transition_view(*this, index);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+auto mapped_execution::begin() const -> iterator
+{
+   return iterator(*this, 1);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+auto mapped_execution::end() const -> iterator
+{
+   return iterator(*this, size() + 1);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+state_view mapped_execution::state_after(const Execution::index_t step) const
+{
+   return step == 0 ? s0() : state(transition(step).post);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool mapped_execution::has_index() const
+{
+   return m_index != nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+step_range mapped_execution::thread_steps(const Thread::tid_t tid) const
+{
+   if (!m_index)
+      throw std::runtime_error("record file has no index");
+   const auto* entries = reinterpret_cast<const record_format::index_entry_t*>(m_index + 1);
+   return steps(entries, m_index->nr_threads, static_cast<uint64_t>(tid));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+step_range mapped_execution::object_steps(const Object& object) const
+{
+   if (!m_index)
+      throw std::runtime_error("record file has no index");
+   const auto* entries = reinterpret_cast<const record_format::index_entry_t*>(m_index + 1);
+   return steps(entries + m_index->nr_threads, m_index->nr_objects,
+                reinterpret_cast<uintptr_t>(object.address()));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+boost::string_ref mapped_execution::string(const uint32_t index) const
+{
+   return m_strings.at(index).str();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+Execution mapped_execution::to_execution() const
+{
+   // Transitions sharing a state in the file share the decoded State
+   std::unordered_map<uint64_t, State::SharedPtr> states;
+   Execution execution(s0().decode());
+   for (const auto& transition : *this)
+   {
+      const auto offset = this->transition(transition.index()).post;
+      auto& post = states[offset];
+      if (!post)
+         post = transition.post().decode();
+      execution.push_back(transition.instr(), post);
+   }
+   execution.set_status(status());
+   return execution;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @throws std::runtime_error if the file is too short to hold count T's at offset, or offset is
+/// not aligned for T (m_data is, being mapped or allocated).
+
+template <typename T>
+const T& mapped_execution::at(const uint64_t offset, const uint64_t count) const
+{
+   if (offset > m_size || count > (m_size - offset) / sizeof(T))
+      throw std::runtime_error("record file is truncated");
+   if (offset % alignof(T) != 0)
+      throw std::runtime_error("record file has a misaligned offset " + std::to_string(offset));
+   return *reinterpret_cast<const T*>(m_data + offset);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void mapped_execution::validate(const record_format::instruction_t& instruction) const
+{
+   if (instruction.file_name >= m_strings.size())
+      throw std::runtime_error("invalid string index " + std::to_string(instruction.file_name) +
+                               " in record file");
+   if (!is_valid_operation(instruction.kind, instruction.operation))
+      throw std::runtime_error("invalid instruction in record file");
+}
+
+//--------------------------------------------------------------------------------------------------
+
+auto mapped_execution::transition(const Execution::index_t index) const
+   -> const record_format::transition_t&
+{
+   if (index < 1 || index > size())
+      throw std::out_of_range("transition " + std::to_string(index));
+   const auto* transitions =
+      reinterpret_cast<const record_format::transition_t*>(m_data + m_header->transitions);
+   return transitions[index - 1];
+}
+
+//--------------------------------------------------------------------------------------------------
+
+state_view mapped_execution::state(const uint64_t offset) const
+{
+   const auto& state = at<record_format::state_t>(offset);
+   at<char>(offset, record_format::state_size(state.nr_enabled, state.nr_next));
+   return state_view(*this, state);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+step_range mapped_execution::steps(const record_format::index_entry_t* entries,
+                                   const uint64_t nr_entries, const uint64_t key) const
+{
+   const auto* end = entries + nr_entries;
+   const auto* entry =
+      std::lower_bound(entries, end, key, [](const record_format::index_entry_t& entry,
+                                             const uint64_t key) { return entry.key < key; });
+   if (entry == end || entry->key != key)
+      return step_range();
+   const auto* steps = &at<uint32_t>(entry->steps, entry->nr_steps);
+   return step_range(steps, steps + entry->nr_steps);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+auto mapped_execution::decode(const record_format::instruction_t& instruction) const
+   -> visible_instruction_t
+{
+   validate(instruction);
+   const meta_data_t meta_data{m_strings[instruction.file_name], instruction.line_number};
+   const Object object(reinterpret_cast<Object::ptr_t>(instruction.operand));
+   switch (instruction.kind)
+   {
+      case 0:
+         return memory_instruction(instruction.tid,
+                                   static_cast<memory_operation>(instruction.operation), object,
+                                   instruction.is_atomic != 0, meta_data);
+      case 1:
+         return lock_instruction(instruction.tid,
+                                 static_cast<lock_operation>(instruction.operation), object,
+                                 meta_data);
+      case 2:
+         return thread_management_instruction(
+            instruction.tid, static_cast<thread_management_operation>(instruction.operation),
+            Thread(static_cast<Thread::tid_t>(instruction.operand)), meta_data);
+      default:
+         throw std::runtime_error("invalid instruction in record file");
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace program_model
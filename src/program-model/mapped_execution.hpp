@@ -0,0 +1,229 @@
+#pragma once
+
+#include "execution.hpp"
+#include "record_format.hpp"
+
+#include <boost/optional.hpp>
+#include <boost/range/iterator_range.hpp>
+#include <boost/utility/string_ref.hpp>
+
+#include <iterator>
+#include <string>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+/// @file mapped_execution.hpp
+/// @brief Read-only access to a record.bin (see record_format.hpp) mapped into memory.
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+namespace program_model {
+
+class mapped_execution;
+
+/// @brief Steps of an execution, numbered from 1, in increasing order.
+
+using step_range = boost::iterator_range<const uint32_t*>;
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief View of a state in a mapped record file, decoding its parts on access.
+
+class state_view
+{
+public:
+   std::size_t nr_enabled() const;
+
+   /// @brief The tids of the enabled threads, in increasing order.
+
+   const int32_t* enabled_begin() const;
+   const int32_t* enabled_end() const;
+
+   bool is_enabled(const Thread::tid_t& tid) const;
+
+   /// @brief The next instruction of tid and whether it is enabled, or none if tid has none.
+
+   boost::optional<next_t> next(const Thread::tid_t& tid) const;
+
+   /// @brief Decodes the whole state.
+
+   State::SharedPtr decode() const;
+
+private:
+   state_view(const mapped_execution& execution, const record_format::state_t& state);
+
+   const record_format::next_t* next_begin() const;
+
+   const mapped_execution* m_execution;
+   const record_format::state_t* m_state;
+
+   friend class mapped_execution;
+
+}; // end class state_view
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief View of a transition in a mapped record file.
+
+class transition_view
+{
+public:
+   /// @note Indexing starts at 1, as in Execution.
+
+   Execution::index_t index() const;
+
+   Thread::tid_t tid() const;
+
+   /// @brief The instruction as it is laid out in the file.
+
+   const record_format::instruction_t& encoded_instr() const;
+
+   /// @brief Decodes the instruction.
+
+   visible_instruction_t instr() const;
+
+   state_view pre() const;
+   state_view post() const;
+
+private:
+   transition_view(const mapped_execution& execution, Execution::index_t index);
+
+   const mapped_execution* m_execution;
+   Execution::index_t m_index;
+
+   friend class mapped_execution;
+
+}; // end class transition_view
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief A record file mapped into memory, whose transitions and states are views over the
+/// mapping that only decode what is accessed. Opening a record file does not read it, unless it
+/// is compressed (see compressed_stream.hpp): a compressed file is inflated as a whole into a
+/// vector on the heap when it is opened, which takes as much memory as the uncompressed file, and
+/// the views point into that vector instead of a mapping.
+/// @details Record files are written by write_binary (see execution_io.hpp), e.g. by the
+/// Scheduler under trace_format=binary.
+
+class mapped_execution
+{
+public:
+   class iterator
+   {
+   public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = transition_view;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const transition_view*;
+      using reference = transition_view;
+
+      transition_view operator*() const;
+      iterator& operator++();
+      bool operator==(const iterator& other) const;
+      bool operator!=(const iterator& other) const;
+
+   private:
+      iterator(const mapped_execution& execution, Execution::index_t index);
+
+      const mapped_execution* m_execution;
+      Execution::index_t m_index;
+
+      friend class mapped_execution;
+
+   }; // end class iterator
+
+   /// @brief Maps the given record file and checks its header, its string table and that its
+   /// transitions and index lie within the file, which takes time independent of the number of
+   /// transitions. States and instructions are checked when they are accessed: accessing a
+   /// corrupt one throws std::runtime_error.
+   /// @throws std::runtime_error if it cannot be mapped or is not a valid record file.
+
+   explicit mapped_execution(const std::string& file_name);
+
+   ~mapped_execution();
+
+   mapped_execution(const mapped_execution&) = delete;
+   mapped_execution& operator=(const mapped_execution&) = delete;
+
+   std::size_t size() const;
+   bool empty() const;
+
+   Execution::Status status() const;
+
+   state_view s0() const;
+
+   /// @note Indexing starts at 1, as in Execution.
+
+   transition_view operator[](Execution::index_t index) const;
+
+   iterator begin() const;
+   iterator end() const;
+
+   /// @brief The state after the given step, or s0 for step 0.
+
+   state_view state_after(Execution::index_t step) const;
+
+   /// @brief Whether the file has an index of the steps of each thread and object, which all
+   /// files written by write_binary have.
+
+   bool has_index() const;
+
+   /// @brief The steps of the thread with the given tid, looked up in the index.
+   /// @throws std::runtime_error if the file has no index.
+
+   step_range thread_steps(Thread::tid_t tid) const;
+
+   /// @brief The steps of memory and lock instructions operating on the given object, looked up
+   /// in the index.
+   /// @throws std::runtime_error if the file has no index.
+
+   step_range object_steps(const Object& object) const;
+
+   /// @brief The string with the given index in the string table, as interned when the file was
+   /// mapped.
+   /// @throws std::out_of_range if the string table has no string with that index.
+
+   boost::string_ref string(uint32_t index) const;
+
+   /// @brief Decodes the whole execution.
+
+   Execution to_execution() const;
+
+private:
+   const char* m_data;
+   std::size_t m_size;
+   const record_format::file_header* m_header;
+   /// @brief nullptr if the file has no index.
+   const record_format::index_header* m_index;
+   /// @brief The decompressed file if it is compressed, in which case m_data points into it.
+   std::vector<char> m_decompressed;
+
+   /// @brief The strings of the string table, interned when the file is mapped.
+   std::vector<interned_string> m_strings;
+
+   template <typename T>
+   const T& at(uint64_t offset, uint64_t count = 1) const;
+
+   /// @throws std::runtime_error if instruction has an invalid string index or operation.
+
+   void validate(const record_format::instruction_t& instruction) const;
+
+   /// @throws std::out_of_range if the execution has no transition with the given index.
+
+   const record_format::transition_t& transition(Execution::index_t index) const;
+
+   /// @throws std::runtime_error if the state at offset does not lie within the file.
+
+   state_view state(uint64_t offset) const;
+   step_range steps(const record_format::index_entry_t* entries, uint64_t nr_entries,
+                    uint64_t key) const;
+   visible_instruction_t decode(const record_format::instruction_t& instruction) const;
+
+   friend class state_view;
+   friend class transition_view;
+
+}; // end class mapped_execution
+
+} // end namespace program_model
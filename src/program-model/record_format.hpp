@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------------------
+/// @file record_format.hpp
+/// @brief The layout of record.bin, the binary format of an Execution, shared by the writer
+/// (write_binary in execution_io.hpp) and the reader (mapped_execution.hpp).
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+namespace program_model {
+namespace record_format {
+
+/// @brief A record file is a file_header, followed by the transitions, the states, the string
+/// table and the index, in native byte order, and ends in an index_trailer. Every structure
+/// starts at a multiple of 8 bytes, so that the file can be mapped and read in place.
+
+struct file_header
+{
+   char magic[8];
+   uint32_t version;
+   /// @brief Execution::Status
+   uint32_t status;
+   uint64_t nr_transitions;
+   /// @brief Offsets in the file of the first transition_t, the state_t of the initial state and
+   /// the string_table.
+   uint64_t transitions;
+   uint64_t s0;
+   uint64_t strings;
+};
+
+constexpr char magic[8] = {'R', 'R', 'R', 'E', 'C', 'O', 'R', 'D'};
+constexpr uint32_t version = 1;
+
+//--------------------------------------------------------------------------------------------------
+
+struct instruction_t
+{
+   int32_t tid;
+   /// @brief The index of the instruction's type in visible_instruction_t.
+   uint8_t kind;
+   uint8_t operation;
+   uint8_t is_atomic;
+   uint8_t reserved;
+   /// @brief The address of the Object, or the tid of the Thread, operated on.
+   uint64_t operand;
+   /// @brief Index in the string table.
+   uint32_t file_name;
+   uint32_t line_number;
+};
+
+static_assert(sizeof(instruction_t) == 24, "instruction_t is written as is");
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief The transitions are numbered from 1 in the order in which they appear. The pre state of
+/// a transition is the post state of the previous one, or the initial state.
+
+struct transition_t
+{
+   instruction_t instruction;
+   /// @brief Offset in the file of the state_t after the transition. Transitions sharing a State
+   /// share its state_t.
+   uint64_t post;
+};
+
+static_assert(sizeof(transition_t) == 32, "transition_t is written as is");
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief A state_t is followed by the nr_enabled tids of its enabled threads in increasing order,
+/// padded to a multiple of 8 bytes, and by nr_next next_t in increasing order of tid.
+
+struct state_t
+{
+   uint32_t nr_enabled;
+   uint32_t nr_next;
+};
+
+struct next_t
+{
+   int32_t tid;
+   uint32_t enabled;
+   instruction_t instruction;
+};
+
+static_assert(sizeof(next_t) == 32, "next_t is written as is");
+
+/// @brief The size in the file of a state with the given number of enabled threads and next
+/// instructions.
+
+constexpr uint64_t state_size(const uint64_t nr_enabled, const uint64_t nr_next)
+{
+   return sizeof(state_t) + (sizeof(int32_t) * nr_enabled + 7) / 8 * 8 + sizeof(next_t) * nr_next;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief The string table is a string_table followed by nr_strings string_t and the characters
+/// of the strings, which are not null terminated.
+
+struct string_table
+{
+   uint64_t nr_strings;
+};
+
+struct string_t
+{
+   /// @brief Offset in the file of the first character.
+   uint64_t offset;
+   uint64_t length;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief The index is an index_header followed by nr_threads and nr_objects index_entry_t, each
+/// in increasing order of key, and the lists of steps they refer to.
+
+struct index_header
+{
+   uint64_t nr_threads;
+   uint64_t nr_objects;
+};
+
+/// @brief The steps (numbered from 1) of a thread, or the steps operating on an object, in
+/// increasing order.
+
+struct index_entry_t
+{
+   /// @brief The tid of the thread, or the address of the object.
+   uint64_t key;
+   /// @brief Offset in the file of the first of nr_steps uint32_t steps, padded to a multiple of
+   /// 8 bytes.
+   uint64_t steps;
+   uint64_t nr_steps;
+};
+
+struct index_trailer
+{
+   /// @brief Offset in the file of the index_header.
+   uint64_t index;
+   char magic[8];
+};
+
+constexpr char index_magic[8] = {'R', 'R', 'I', 'N', 'D', 'E', 'X', '\0'};
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace record_format
+} // end namespace program_model
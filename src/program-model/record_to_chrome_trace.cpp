@@ -0,0 +1,86 @@
+
+#include "chrome_trace.hpp"
+#include "compressed_stream.hpp"
+#include "execution_io.hpp"
+#include "mapped_execution.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+//--------------------------------------------------------------------------------------------------
+/// @file record_to_chrome_trace.cpp
+/// @brief Converts a record.txt or record.bin, possibly compressed (record.txt.lz4 or
+/// record.bin.lz4), timed by the record_times.txt next to it if given,
+/// into a Chrome Trace Event JSON file (see chrome_trace.hpp).
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+namespace {
+
+bool has_suffix(const std::string& file_name, const std::string& suffix)
+{
+   return file_name.size() > suffix.size() &&
+          file_name.compare(file_name.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+
+int main(int argc, const char* argv[])
+{
+   if (argc < 3 || argc > 4)
+   {
+      std::cerr << "usage: " << argv[0]
+                << " <record.txt|record.bin>[.lz4] [<record_times.txt>] <trace.json>\n";
+      return 1;
+   }
+   program_model::Execution E;
+   const std::string record_file = argv[1];
+   const bool compressed = has_suffix(record_file, ".lz4");
+   try
+   {
+      if (has_suffix(record_file, compressed ? ".bin.lz4" : ".bin"))
+      {
+         // mapped_execution decompresses a compressed record.bin itself
+         E = program_model::mapped_execution(record_file).to_execution();
+      }
+      else if (compressed)
+      {
+         std::ifstream record(record_file, std::ios::binary);
+         program_model::decompressed_istream decompressed(record);
+         decompressed >> E;
+      }
+      else
+      {
+         std::ifstream record(record_file);
+         record >> E;
+      }
+   }
+   catch (const std::runtime_error& e)
+   {
+      std::cerr << e.what() << "\n";
+      return 1;
+   }
+   if (!E.initialized())
+   {
+      std::cerr << "cannot read an execution from " << argv[1] << "\n";
+      return 1;
+   }
+   std::vector<uint64_t> step_times;
+   if (argc == 4)
+   {
+      std::ifstream record_times(argv[2]);
+      uint64_t time;
+      while (record_times >> time)
+      {
+         step_times.push_back(time);
+      }
+   }
+   std::ofstream trace(argv[argc - 1]);
+   program_model::write_chrome_trace(trace, E, step_times);
+   return trace ? 0 : 1;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "interned_string.hpp"
 #include "object.hpp"
 #include "thread.hpp"
 
@@ -16,7 +17,7 @@ namespace program_model {
 
 struct meta_data_t
 {
-   std::string file_name;
+   interned_string file_name;
    unsigned int line_number;
 
 }; // end struct meta_data_t
@@ -75,10 +76,15 @@ private:
 //--------------------------------------------------------------------------------------------------
 
 
+/// @brief Operations on memory. Await does not access memory: it waits, after a Load, until
+/// another thread changes the memory by a Store or ReadModifyWrite, on the back edge of a loop
+/// spinning on the Load.
+
 enum class memory_operation
 {
    Load = 0,
    Store = 1,
+   Await = 4,
    ReadModifyWrite = 5
 };
 
@@ -122,10 +128,30 @@ private:
 //--------------------------------------------------------------------------------------------------
 
 
+/// @brief Operations on a synchronization object: a mutex, spinlock, readers-writer lock or
+/// semaphore or condition variable.
+/// @details Lock acquires the object exclusively, blocking while it is held. TryLock acquires it
+/// exclusively only if it is free and never blocks. ReadLock and TryReadLock do the same shared,
+/// only excluding an exclusive holder. Unlock releases the exclusive holder or, if there is none,
+/// one shared holder. SemWait decrements a semaphore, blocking while its value is 0, SemTryWait
+/// decrements it only if its value is positive and SemPost increments it. CondWait blocks until a
+/// CondSignal wakes it or a CondBroadcast wakes all CondWaits on the condition variable (the
+/// release and re-acquisition of the mutex are an Unlock and a Lock of their own). Acquiring
+/// operations have odd values, releasing ones even values.
+
 enum class lock_operation
 {
    Lock = 3,
-   Unlock = 2
+   Unlock = 2,
+   TryLock = 9,
+   ReadLock = 11,
+   TryReadLock = 13,
+   SemWait = 15,
+   SemTryWait = 17,
+   SemPost = 8,
+   CondWait = 19,
+   CondSignal = 10,
+   CondBroadcast = 12
 };
 
 //--------------------------------------------------------------------------------------------------
@@ -33,6 +33,9 @@ std::ostream& operator<<(std::ostream& os, const memory_operation& operation)
       case memory_operation::Store:
          os << "Store";
          break;
+      case memory_operation::Await:
+         os << "Await";
+         break;
       case memory_operation::ReadModifyWrite:
          os << "RMW";
          break;
@@ -50,6 +53,8 @@ std::istream& operator>>(std::istream& is, memory_operation& operation)
       operation = memory_operation::Load;
    else if (str == "Store")
       operation = memory_operation::Store;
+   else if (str == "Await")
+      operation = memory_operation::Await;
    else if (str == "RMW")
       operation = memory_operation::ReadModifyWrite;
    else
@@ -70,6 +75,33 @@ std::ostream& operator<<(std::ostream& os, const lock_operation& operation)
       case lock_operation::Unlock:
          os << "Unlock";
          break;
+      case lock_operation::TryLock:
+         os << "TryLock";
+         break;
+      case lock_operation::ReadLock:
+         os << "ReadLock";
+         break;
+      case lock_operation::TryReadLock:
+         os << "TryReadLock";
+         break;
+      case lock_operation::SemWait:
+         os << "SemWait";
+         break;
+      case lock_operation::SemTryWait:
+         os << "SemTryWait";
+         break;
+      case lock_operation::SemPost:
+         os << "SemPost";
+         break;
+      case lock_operation::CondWait:
+         os << "CondWait";
+         break;
+      case lock_operation::CondSignal:
+         os << "CondSignal";
+         break;
+      case lock_operation::CondBroadcast:
+         os << "CondBroadcast";
+         break;
    }
    return os;
 }
@@ -84,6 +116,24 @@ std::istream& operator>>(std::istream& is, lock_operation& operation)
       operation = lock_operation::Lock;
    else if (str == "Unlock")
       operation = lock_operation::Unlock;
+   else if (str == "TryLock")
+      operation = lock_operation::TryLock;
+   else if (str == "ReadLock")
+      operation = lock_operation::ReadLock;
+   else if (str == "TryReadLock")
+      operation = lock_operation::TryReadLock;
+   else if (str == "SemWait")
+      operation = lock_operation::SemWait;
+   else if (str == "SemTryWait")
+      operation = lock_operation::SemTryWait;
+   else if (str == "SemPost")
+      operation = lock_operation::SemPost;
+   else if (str == "CondWait")
+      operation = lock_operation::CondWait;
+   else if (str == "CondSignal")
+      operation = lock_operation::CondSignal;
+   else if (str == "CondBroadcast")
+      operation = lock_operation::CondBroadcast;
    else
       is.setstate(std::ios::failbit);
    return is;
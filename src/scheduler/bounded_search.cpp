@@ -0,0 +1,84 @@
+
+#include "bounded_search.hpp"
+
+#include "scheduler_settings.hpp"
+
+#include <execution_io.hpp>
+
+#include <boost/filesystem/path.hpp>
+
+#include <fstream>
+#include <stack>
+
+
+namespace scheduler {
+
+//--------------------------------------------------------------------------------------------------
+
+unsigned int explore_bounded(const program_t& program, const bounding::bound_t bound_type,
+                             const unsigned int bound, const execution_callback_t& on_execution,
+                             const boost::optional<timeout_t>& timeout,
+                             const boost::filesystem::path& output_dir)
+{
+   const SchedulerSettings settings(bounding::to_string(bound_type));
+   const auto run = [&](const schedule_t& prefix) {
+      run_under_schedule(program, prefix, settings, timeout, output_dir);
+      program_model::Execution execution;
+      std::ifstream record((output_dir / "record.txt").string());
+      record >> execution;
+      return execution;
+   };
+   return explore_bounded(run, bound_type, bound, on_execution);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+unsigned int explore_bounded(const run_t& run, const bounding::bound_t bound_type,
+                             const unsigned int bound, const execution_callback_t& on_execution)
+{
+   using tid_t = program_model::Thread::tid_t;
+
+   unsigned int nr_executions = 0;
+   // Prefixes are only pushed while their cost is within the bound
+   std::stack<schedule_t> prefixes;
+   prefixes.push({});
+   while (!prefixes.empty())
+   {
+      const auto prefix = prefixes.top();
+      prefixes.pop();
+
+      const auto execution = run(prefix);
+      ++nr_executions;
+      on_execution(execution);
+
+      const auto executed = schedule(execution);
+      unsigned int cost = 0;
+      boost::optional<tid_t> current;
+      for (std::size_t i = 0; i < executed.size(); ++i)
+      {
+         const auto& enabled = execution[i + 1].pre().enabled();
+         // Alternatives within the prefix are explored from the execution the prefix derives from
+         if (i >= prefix.size())
+         {
+            for (const auto tid : enabled)
+            {
+               const auto alternative_cost =
+                  cost + bounding::cost(bound_type, enabled, current, tid);
+               if (tid != executed[i] && alternative_cost <= bound)
+               {
+                  schedule_t alternative(executed.begin(), executed.begin() + i);
+                  alternative.push_back(tid);
+                  prefixes.push(alternative);
+               }
+            }
+         }
+         cost += bounding::cost(bound_type, enabled, current, executed[i]);
+         current = executed[i];
+      }
+   }
+   return nr_executions;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace scheduler
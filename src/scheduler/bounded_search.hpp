@@ -0,0 +1,48 @@
+#pragma once
+
+#include "replay.hpp"
+
+#include <strategies/bounding.hpp>
+
+#include <execution.hpp>
+
+#include <functional>
+
+//--------------------------------------------------------------------------------------------------
+/// @file bounded_search.hpp
+/// @brief Systematic exploration of all schedules of a program up to a preemption or delay
+/// bound.
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+namespace scheduler {
+
+using execution_callback_t = std::function<void(const program_model::Execution&)>;
+
+/// @brief Runs a schedule prefix and returns the recorded execution.
+using run_t = std::function<program_model::Execution(const schedule_t&)>;
+
+/// @brief Runs the instrumented program under every schedule with at most bound preemptions,
+/// resp. delays (see bounding::cost), and calls on_execution on each recorded execution.
+/// @details Every run follows a schedule prefix, after which the PreemptionBounded, resp.
+/// DelayBounded, strategy completes the execution at no cost. From each recorded execution new
+/// prefixes are derived by choosing another enabled thread at one of the steps following the
+/// prefix, as long as the total cost stays within bound. Every schedule within the bound is
+/// hence run exactly once.
+/// @returns The number of explored executions.
+
+unsigned int explore_bounded(const program_t& program, const bounding::bound_t bound_type,
+                             const unsigned int bound, const execution_callback_t& on_execution,
+                             const boost::optional<timeout_t>& timeout = boost::none,
+                             const boost::filesystem::path& output_dir = "./record_replay_output");
+
+/// @brief As above, exploring the executions run returns.
+/// @details run has to complete each prefix as the PreemptionBounded, resp. DelayBounded, strategy
+/// does, e.g. by running a program under that strategy.
+
+unsigned int explore_bounded(const run_t& run, const bounding::bound_t bound_type,
+                             const unsigned int bound, const execution_callback_t& on_execution);
+
+} // end namespace scheduler
@@ -0,0 +1,172 @@
+
+#include "checkpoint.hpp"
+
+#include <error.hpp>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+namespace scheduler {
+
+//--------------------------------------------------------------------------------------------------
+
+const std::string checkpoint::branch_command = "branch";
+const std::string checkpoint::quit_command = "quit";
+
+//--------------------------------------------------------------------------------------------------
+
+checkpoint::checkpoint(const boost::filesystem::path& directory)
+: m_directory(directory)
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool checkpoint::take()
+{
+#if defined(__linux__) && defined(__GLIBC__)
+   // The fifos are created before the fork, so that they exist once the original process exits
+   if (!make_fifos())
+   {
+      return false;
+   }
+   const pid_t pid = fork();
+   if (pid < 0)
+   {
+      ERROR("checkpoint::take", "fork failed");
+      return false;
+   }
+   if (pid > 0)
+   {
+      return false;
+   }
+   return serve();
+#else
+   // Re-creating threads relies on how glibc handles the threads that vanish in a fork
+   ERROR("checkpoint::take", "checkpoints are only supported on Linux with glibc");
+   return false;
+#endif
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool checkpoint::make_fifos() const
+{
+   boost::system::error_code error;
+   boost::filesystem::create_directories(m_directory, error);
+   if (error)
+   {
+      ERROR("checkpoint::take", "cannot create " + m_directory.string() + ": " + error.message());
+      return false;
+   }
+   for (const auto& fifo : {request_fifo(m_directory), response_fifo(m_directory)})
+   {
+      if (mkfifo(fifo.c_str(), 0600) == 0)
+         continue;
+      const int error_number = errno;
+      if (error_number == EEXIST &&
+          boost::filesystem::status(fifo).type() == boost::filesystem::fifo_file)
+         continue;
+      ERROR("checkpoint::take",
+            "cannot create fifo " + fifo.string() + ": " + std::strerror(error_number));
+      return false;
+   }
+   return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+boost::filesystem::path checkpoint::request_fifo(const boost::filesystem::path& directory)
+{
+   return directory / "request";
+}
+
+//--------------------------------------------------------------------------------------------------
+
+boost::filesystem::path checkpoint::response_fifo(const boost::filesystem::path& directory)
+{
+   return directory / "response";
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool checkpoint::serve()
+{
+   // The template outlives the original process. Detach it from the session and from the output
+   // of the original process, so that whoever waits for the latter is not kept waiting.
+   setsid();
+   const int null_fd = open("/dev/null", O_WRONLY);
+   dup2(null_fd, STDOUT_FILENO);
+   dup2(null_fd, STDERR_FILENO);
+
+   while (true)
+   {
+      std::string command;
+      {
+         std::ifstream request(request_fifo(m_directory).string());
+         request >> command;
+      }
+      if (command == quit_command)
+      {
+         // Opening the response fifo waits for release_checkpoint, which may then take a new
+         // checkpoint in the same directory once it reads the acknowledgement
+         std::ofstream response(response_fifo(m_directory).string());
+         boost::filesystem::remove(request_fifo(m_directory));
+         boost::filesystem::remove(response_fifo(m_directory));
+         response << 0 << std::endl;
+         _exit(0);
+      }
+      else if (command == branch_command)
+      {
+         const pid_t branch = fork();
+         if (branch == 0)
+         {
+            return true;
+         }
+         int status = -1;
+         if (branch > 0)
+         {
+            int wait_status = 0;
+            waitpid(branch, &wait_status, 0);
+            status = WIFEXITED(wait_status) ? WEXITSTATUS(wait_status)
+                                            : 128 + WTERMSIG(wait_status);
+         }
+         std::ofstream response(response_fifo(m_directory).string());
+         response << status << std::endl;
+      }
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+#if defined(__linux__) && defined(__GLIBC__)
+
+void exit_restored_thread()
+{
+   while (true)
+   {
+      syscall(SYS_exit, 0);
+   }
+}
+
+#else
+
+void exit_restored_thread()
+{
+   pthread_exit(nullptr);
+}
+
+#endif
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace scheduler
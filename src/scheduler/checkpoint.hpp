@@ -0,0 +1,77 @@
+#pragma once
+
+#include <boost/filesystem/path.hpp>
+
+#include <string>
+
+//--------------------------------------------------------------------------------------------------
+/// @file checkpoint.hpp
+/// @brief Fork-based checkpointing of an instrumented program at a scheduling point.
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+namespace scheduler {
+
+/// @details A checkpoint is a suspended copy of the instrumented program, forked by the Scheduler
+/// thread at a scheduling point, i.e. when all unfinished threads are parked in
+/// controllable_thread::post_task. Only the forking thread survives a fork, so the forked copy
+/// (the template) is single-threaded and serves branch requests sent over a pair of fifos in
+/// the checkpoint directory. For every request it forks a branch process in which the Scheduler
+/// re-creates the parked threads (see controllable_thread::restore) and continues the execution
+/// under the schedule in schedules/schedule.txt. The template reports the exit status of each
+/// branch back over the response fifo.
+/// @note This relies on glibc's handling of the threads that vanish in a fork: it marks them as
+/// exited, so that joining the pthread_t of an original thread in a branch does not block (the
+/// Scheduler only lets the Join through once the joined thread finished), and moves their stacks
+/// into its stack cache. The stacks stay in use by the re-created threads, so
+/// - glibc must not unmap them when the cache exceeds its size (joining an original thread
+///   queues its stack once more), which run_under_schedule prevents by lifting the limit (the
+///   glibc.pthread.stack_cache_size tunable) for programs taking a checkpoint;
+/// - a thread that the program creates in a branch may be handed one of them, which the
+///   Scheduler detects from its pthread_t (see Scheduler::register_thread) and aborts on.
+
+class checkpoint
+{
+public:
+   explicit checkpoint(const boost::filesystem::path& directory);
+
+   /// @brief Creates the fifos and forks the template process. The template removes the fifos
+   /// before it acknowledges a quit_command.
+   /// @returns false in the original process, also if the checkpoint could not be taken, and
+   /// true in a branch process. The template itself never returns.
+
+   bool take();
+
+   static boost::filesystem::path request_fifo(const boost::filesystem::path& directory);
+   static boost::filesystem::path response_fifo(const boost::filesystem::path& directory);
+
+   static const std::string branch_command;
+   static const std::string quit_command;
+
+private:
+   boost::filesystem::path m_directory;
+
+   /// @brief Creates the directory and the fifos, unless they exist.
+   /// @returns false if they could not be created.
+
+   bool make_fifos() const;
+
+   /// @brief Loop of the template process.
+   /// @returns true in a newly forked branch process.
+
+   bool serve();
+
+}; // end class checkpoint
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Terminates a re-created thread without unwinding into the (original) frames below
+/// its start routine.
+
+[[noreturn]] void exit_restored_thread();
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace scheduler
@@ -1,9 +1,14 @@
 
 #include "controllable_thread.hpp"
 
+#include "checkpoint.hpp"
+
 #include <thread_io.hpp>
 
-#include <debug.hpp>
+#include "trace.hpp"
+
+#include <assert.h>
+#include <sys/mman.h>
 
 
 namespace scheduler {
@@ -15,20 +20,47 @@ controllable_thread::controllable_thread(const program_model::Thread::tid_t tid,
 : m_tid(tid)
 , m_pid(pid)
 , m_owner_id(owner_id)
-, m_control_handle(tid)
+, m_control_handle(std::make_unique<utils::threads::BinarySem>(tid))
+, m_parked_context()
+, m_granted_at(0)
+, m_parked(false)
+, m_restoring(false)
+, m_restored(false)
 {
 }
 
 //--------------------------------------------------------------------------------------------------
 
-void controllable_thread::post_task()
+boost::optional<std::chrono::nanoseconds> controllable_thread::post_task(const bool save_context)
 {
    if (pthread_self() != m_pid)
       throw permission_denied();
 
-   DEBUGF_SYNC("[thread" << m_tid << "]", "wait_for_turn", "", std::endl);
-   m_control_handle.wait();
-   DEBUGF_SYNC("[thread" << m_tid << "]", "take_turn", "", std::endl);
+   RECORD_REPLAY_TRACE(wait_for_turn, m_tid, 0);
+   // A thread re-created by restore resumes here, on the stack of the original thread. Saving
+   // the context costs a system call on glibc, so it is only done while a checkpoint may be taken
+   if (save_context)
+      getcontext(&m_parked_context);
+   if (m_restoring.exchange(false))
+   {
+      m_pid = pthread_self();
+      m_restored = true;
+   }
+   m_parked.store(true);
+   m_control_handle->wait();
+   m_parked.store(false);
+   // Consumed, so that a turn without a grant is not measured from an earlier grant
+   const auto granted_at_count = m_granted_at.exchange(0, std::memory_order_relaxed);
+   if (granted_at_count == 0)
+   {
+      RECORD_REPLAY_TRACE(take_turn, m_tid, 0);
+      return boost::none;
+   }
+   const auto granted_at = std::chrono::steady_clock::time_point(
+      std::chrono::steady_clock::duration(granted_at_count));
+   const std::chrono::nanoseconds latency = std::chrono::steady_clock::now() - granted_at;
+   RECORD_REPLAY_TRACE(take_turn, m_tid, latency.count());
+   return latency;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -38,8 +70,8 @@ void controllable_thread::enter_function(const std::string& function_name)
    if (pthread_self() != m_pid)
       throw permission_denied();
 
-   DEBUGF_SYNC("[thread" << m_tid << "]", "enter_function", function_name, "\n");
    m_call_stack.push(function_name);
+   RECORD_REPLAY_TRACE(enter_function, m_tid, m_call_stack.size());
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -49,7 +81,7 @@ void controllable_thread::exit_function(const std::string& function_name)
    if (pthread_self() != m_pid)
       throw permission_denied();
 
-   DEBUGF_SYNC("[thread" << m_tid << "]", "exit_function", function_name, "\n");
+   RECORD_REPLAY_TRACE(exit_function, m_tid, m_call_stack.size());
    if (m_call_stack.empty() || m_call_stack.top() != function_name)
       throw std::invalid_argument("invalid call stack");
 
@@ -66,7 +98,79 @@ void controllable_thread::grant_execution_right()
    if (std::this_thread::get_id() != m_owner_id)
       throw permission_denied();
 
-   m_control_handle.post(true, utils::threads::BinarySem::BroadcastMode::NOTIFY_ONE);
+   m_granted_at.store(std::chrono::steady_clock::now().time_since_epoch().count(),
+                      std::memory_order_relaxed);
+   m_control_handle->post(true, utils::threads::BinarySem::BroadcastMode::NOTIFY_ONE);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool controllable_thread::parked() const
+{
+   return m_parked.load();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool controllable_thread::restored() const
+{
+   return m_restored;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+pthread_t controllable_thread::restore()
+{
+   if (std::this_thread::get_id() != m_owner_id)
+      throw permission_denied();
+
+   /// @pre parked()
+   assert(parked());
+   // The state of the semaphore was copied while the original thread was waiting on it and
+   // cannot be safely destroyed
+   m_control_handle.release();
+   m_control_handle = std::make_unique<utils::threads::BinarySem>(m_tid);
+   m_parked.store(false);
+   m_restoring.store(true);
+
+   // After the fork glibc keeps the stacks of the vanished threads in its stack cache, from which
+   // it would hand out one to a thread created with a default stack, whose start frames and
+   // descriptor would then overwrite the top of a parked thread's stack. The new thread only runs
+   // restore_routine on its own stack, which is never unmapped, as it ends in
+   // exit_restored_thread without glibc knowing.
+   pthread_attr_t attributes;
+   pthread_attr_init(&attributes);
+   std::size_t stack_size = 0;
+   pthread_attr_getstacksize(&attributes, &stack_size);
+   void* stack = mmap(nullptr, stack_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+   if (stack == MAP_FAILED)
+   {
+      pthread_attr_destroy(&attributes);
+      throw std::runtime_error("controllable_thread::restore: cannot map a stack");
+   }
+   pthread_attr_setstack(&attributes, stack, stack_size);
+   pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+   pthread_t pid;
+   const int result = pthread_create(&pid, &attributes, restore_routine, this);
+   pthread_attr_destroy(&attributes);
+   if (result != 0)
+   {
+      munmap(stack, stack_size);
+      throw std::runtime_error("controllable_thread::restore");
+   }
+
+   while (!parked())
+      std::this_thread::yield();
+   return pid;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void* controllable_thread::restore_routine(void* thread)
+{
+   setcontext(&static_cast<controllable_thread*>(thread)->m_parked_context);
+   return nullptr;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -4,9 +4,15 @@
 
 #include <threads/binary_sem.hpp>
 
+#include <boost/optional.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include <pthread.h>
 #include <stack>
 #include <string>
+#include <ucontext.h>
 
 //--------------------------------------------------------------------------------------------------
 /// @file controllable_thread.hpp
@@ -24,7 +30,12 @@ public:
                        const std::thread::id owner_id);
 
    /// @brief Should only be called by the thread to be controlled
-   void post_task();
+   /// @param save_context Whether to save the context of the thread, which restore needs if a
+   /// checkpoint is taken while the thread is parked.
+   /// @returns The time between the owner granting the execution right and this thread taking
+   /// its turn, or none if the turn was not granted by grant_execution_right (e.g. the first
+   /// turn of a restored thread).
+   boost::optional<std::chrono::nanoseconds> post_task(bool save_context);
 
    /// @brief Should only be called by the thread to be controlled
    void enter_function(const std::string& function_name);
@@ -35,6 +46,19 @@ public:
    /// @brief Should only be called by the owning thread
    void grant_execution_right();
 
+   /// @brief Whether the thread is waiting for its turn in post_task.
+   bool parked() const;
+
+   /// @brief Whether the thread was re-created by restore.
+   bool restored() const;
+
+   /// @brief Should only be called by the owning thread, in a process forked while this thread
+   /// was parked in post_task. Creates a new pthread, on a freshly mapped stack, that continues
+   /// the execution of this thread from where it was parked, on the stack of this thread.
+   /// @returns The pthread id of the new thread, which differs from that of any thread whose
+   /// stack is still mapped.
+   pthread_t restore();
+
    struct permission_denied : public std::runtime_error
    {
       permission_denied();
@@ -54,7 +78,19 @@ private:
    /// @brief The id of the thread that is controlling this thread
    std::thread::id m_owner_id;
 
-   utils::threads::BinarySem m_control_handle;
+   std::unique_ptr<utils::threads::BinarySem> m_control_handle;
+
+   /// @brief The context of this thread when it was last parked in post_task.
+   ucontext_t m_parked_context;
+
+   /// @brief The time at which grant_execution_right was last called.
+   std::atomic<std::chrono::steady_clock::rep> m_granted_at;
+
+   std::atomic<bool> m_parked;
+   std::atomic<bool> m_restoring;
+   bool m_restored;
+
+   static void* restore_routine(void* thread);
 
    using call_stack_t = std::stack<std::string>;
    call_stack_t m_call_stack;
@@ -0,0 +1,223 @@
+
+#include "instrumentation_sites.hpp"
+
+#include <visible_instruction_io.hpp>
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+
+namespace scheduler {
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+struct registry_t
+{
+   std::mutex mutex;
+   std::vector<site_table> tables;
+   site_filter filter;
+};
+
+registry_t& registry()
+{
+   static registry_t registry;
+   return registry;
+}
+
+void apply(const site_filter& filter, const site_table& table)
+{
+   // Instrumented threads load the bits concurrently (with monotonic ordering, see Sites)
+   for (uint32_t index = 0; index < table.size; ++index)
+   {
+      __atomic_store_n(&table.enabled[index], filter.enabled(table.sites[index]) ? 1 : 0,
+                       __ATOMIC_RELAXED);
+   }
+}
+
+std::string base_name(const std::string& file_name)
+{
+   const auto separator = file_name.find_last_of('/');
+   return separator == std::string::npos ? file_name : file_name.substr(separator + 1);
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+
+std::ostream& operator<<(std::ostream& os, const instrumentation_site& site)
+{
+   os << std::hex << std::setw(16) << std::setfill('0') << site.id << std::dec
+      << std::setfill(' ') << " " << site.file_name << ":" << site.line_number << " "
+      << site.function_name << " " << (*site.variable_name ? site.variable_name : "-") << " ";
+   if (site.kind == 0)
+      os << static_cast<program_model::memory_operation>(site.operation);
+   else
+      os << static_cast<program_model::lock_operation>(site.operation);
+   return os;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+site_filter::site_filter() = default;
+
+//--------------------------------------------------------------------------------------------------
+
+site_filter site_filter::read_from_file(const boost::filesystem::path& filename)
+{
+   std::ifstream ifs(filename.string());
+   if (!ifs)
+   {
+      throw std::invalid_argument("cannot read site filter " + filename.string());
+   }
+   site_filter filter;
+   std::string line;
+   while (std::getline(ifs, line))
+   {
+      line = line.substr(0, line.find('#'));
+      if (line.find_first_not_of(" \t") != std::string::npos)
+         filter.add_rule(line);
+   }
+   return filter;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void site_filter::add_rule(const std::string& rule)
+{
+   std::istringstream tokens(rule);
+   std::string action;
+   std::string selector;
+   std::string rest;
+   if (!(tokens >> action >> selector) || (tokens >> rest) ||
+       (action != "enable" && action != "disable"))
+   {
+      throw std::invalid_argument("invalid site rule " + rule);
+   }
+
+   rule_t parsed{action == "enable", selector_t::All, "", 0};
+   if (selector != "all")
+   {
+      const auto separator = selector.find('=');
+      const auto key = selector.substr(0, separator);
+      parsed.pattern = separator == std::string::npos ? "" : selector.substr(separator + 1);
+      if (parsed.pattern.empty())
+         throw std::invalid_argument("invalid site rule " + rule);
+
+      if (key == "id")
+      {
+         parsed.selector = selector_t::Id;
+         try
+         {
+            std::size_t end = 0;
+            parsed.id = std::stoull(parsed.pattern, &end, 16);
+            if (end != parsed.pattern.size())
+               throw std::invalid_argument(parsed.pattern);
+         }
+         catch (const std::logic_error&)
+         {
+            throw std::invalid_argument("invalid site rule " + rule);
+         }
+      }
+      else if (key == "file")
+         parsed.selector = selector_t::File;
+      else if (key == "function")
+         parsed.selector = selector_t::Function;
+      else if (key == "variable")
+         parsed.selector = selector_t::Variable;
+      else
+         throw std::invalid_argument("invalid site rule " + rule);
+   }
+   m_rules.push_back(parsed);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool site_filter::enabled(const instrumentation_site& site) const
+{
+   // Skipping a lock operation would leave the Scheduler's view of the lock inconsistent
+   if (site.kind != 0)
+      return true;
+   bool enabled = true;
+   for (const auto& rule : m_rules)
+   {
+      if (matches(rule, site))
+         enabled = rule.enable;
+   }
+   return enabled;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool site_filter::matches(const rule_t& rule, const instrumentation_site& site)
+{
+   switch (rule.selector)
+   {
+      case selector_t::All:
+         return true;
+      case selector_t::Id:
+         return rule.id == site.id;
+      case selector_t::File:
+         return rule.pattern == site.file_name || rule.pattern == base_name(site.file_name);
+      case selector_t::Function:
+         return rule.pattern == site.function_name;
+      case selector_t::Variable:
+         return rule.pattern == site.variable_name;
+   }
+   return false;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void register_site_table(const site_table& table)
+{
+   auto& sites = registry();
+   std::lock_guard<std::mutex> lock(sites.mutex);
+   apply(sites.filter, table);
+   sites.tables.push_back(table);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void set_site_filter(const site_filter& filter)
+{
+   auto& sites = registry();
+   std::lock_guard<std::mutex> lock(sites.mutex);
+   sites.filter = filter;
+   for (const auto& table : sites.tables)
+   {
+      apply(filter, table);
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::vector<site_table> site_tables()
+{
+   auto& sites = registry();
+   std::lock_guard<std::mutex> lock(sites.mutex);
+   return sites.tables;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void write_sites(std::ostream& os)
+{
+   for (const auto& table : site_tables())
+   {
+      for (uint32_t index = 0; index < table.size; ++index)
+      {
+         const bool enabled = __atomic_load_n(&table.enabled[index], __ATOMIC_RELAXED);
+         os << table.sites[index] << (enabled ? " enabled" : " disabled") << "\n";
+      }
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace scheduler
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <boost/filesystem/path.hpp>
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+/// @file instrumentation_sites.hpp
+/// @brief Descriptors of the visible instructions instrumented by LightWeightPass and the
+/// filter that enables or disables them at run time.
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+namespace scheduler {
+
+/// @brief Constant descriptor of an instrumented memory or lock instruction, emitted by
+/// LightWeightPass in a per-module table. The instrumented program passes a pointer to it
+/// instead of the operation, atomicity, file name and line number.
+/// @note The layout has to match the struct.recrep_site type the pass emits (see
+/// llvm-pass/functions.cpp).
+
+struct instrumentation_site
+{
+   /// @brief Hash of the file, function, line, operation and the index of the site among the
+   /// sites with the same of these in the function. It changes when the site moves to another
+   /// line, also if the function itself is unchanged.
+   uint64_t id;
+
+   /// @brief 0 for a memory and 1 for a lock instruction, as in visible_instruction_t.
+   uint8_t kind;
+   uint8_t is_atomic;
+   uint32_t operation;
+   const char* file_name;
+   uint32_t line_number;
+   const char* function_name;
+
+   /// @brief The name of the global or local variable operated on, or "" if it is unknown.
+   const char* variable_name;
+
+}; // end struct instrumentation_site
+
+/// @brief Writes "<id> <file>:<line> <function> <variable> <operation>", with id in hex.
+
+std::ostream& operator<<(std::ostream&, const instrumentation_site&);
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief The sites of an instrumented module together with their enable bits. The inlined
+/// prologue in front of a site skips the call into the scheduler if its bit is 0. The bits are
+/// accessed with relaxed atomics on both sides.
+
+struct site_table
+{
+   const instrumentation_site* sites;
+   uint8_t* enabled;
+   uint32_t size;
+
+}; // end struct site_table
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Sequence of rules deciding which sites are enabled, read from a file with one rule
+///
+///    (enable|disable) (all|id=<hex id>|file=<name>|function=<name>|variable=<name>)
+///
+/// per line. Text following a # is ignored. A site is enabled unless the last rule matching it
+/// disables it; file=<name> matches both the full file name and its last component. For example
+/// "disable all" followed by "enable file=queue.cpp" focuses on the sites in queue.cpp.
+/// @note The rules only apply to memory sites. Lock sites are always enabled, as the Scheduler
+/// has to see every operation on a lock to know which threads it blocks.
+
+class site_filter
+{
+public:
+   /// @brief Constructs the filter enabling all sites.
+
+   site_filter();
+
+   /// @throws std::invalid_argument if the file cannot be read or contains an invalid rule.
+
+   static site_filter read_from_file(const boost::filesystem::path& filename);
+
+   /// @throws std::invalid_argument if rule is invalid.
+
+   void add_rule(const std::string& rule);
+
+   /// @returns true for a lock site, whatever the rules.
+
+   bool enabled(const instrumentation_site& site) const;
+
+private:
+   enum class selector_t
+   {
+      All,
+      Id,
+      File,
+      Function,
+      Variable
+   };
+
+   struct rule_t
+   {
+      bool enable;
+      selector_t selector;
+      std::string pattern;
+      uint64_t id;
+   };
+
+   static bool matches(const rule_t& rule, const instrumentation_site& site);
+
+   std::vector<rule_t> m_rules;
+
+}; // end class site_filter
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Registers the site table of an instrumented module and sets its enable bits according
+/// to the current filter.
+/// @details Called from the module's constructor, before main.
+
+void register_site_table(const site_table& table);
+
+/// @brief Makes filter the current filter and applies it to the site tables registered so far.
+/// @note The bits are written while the program may be running, a thread may thus see the
+/// change only at a later site.
+
+void set_site_filter(const site_filter& filter);
+
+/// @brief The site tables registered so far.
+
+std::vector<site_table> site_tables();
+
+/// @brief Writes all registered sites, one per line, each followed by " enabled" or
+/// " disabled".
+
+void write_sites(std::ostream& os);
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace scheduler
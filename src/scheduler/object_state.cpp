@@ -1,20 +1,40 @@
 
 #include "object_state.hpp"
 
+#include "trace.hpp"
+
 #include <visible_instruction_io.hpp>
 
-#include <debug.hpp>
 #include <utils_io.hpp>
 
 #include <algorithm>
 #include <assert.h>
 #include <exception>
+#include <semaphore.h>
 
 
 namespace scheduler {
 
 //--------------------------------------------------------------------------------------------------
 
+namespace {
+
+boost::optional<int> semaphore_value(const program_model::Object& object)
+{
+   int value = 0;
+   if (sem_getvalue(static_cast<sem_t*>(object.address()), &value) == 0)
+   {
+      // Some implementations return minus the number of waiters for a locked semaphore
+      return std::max(value, 0);
+   }
+   // E.g. macOS does not implement unnamed semaphores
+   return boost::none;
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+
 get_data_races::get_data_races(const object_state& object)
 : m_object(object)
 {
@@ -33,6 +53,9 @@ std::vector<data_race_t> get_data_races::operator()(
       return data_race_t{*mem_instr, instruction};
    };
    const auto operation = instruction.operation();
+   // An Await does not access the memory
+   if (operation == memory_operation::Await)
+      return data_races;
    if (operation == memory_operation::Store || operation == memory_operation::ReadModifyWrite)
    {
       std::transform(m_object.begin(0), m_object.end(0), std::back_inserter(data_races),
@@ -40,11 +63,12 @@ std::vector<data_race_t> get_data_races::operator()(
    }
    std::transform(m_object.begin(1), m_object.end(1), std::back_inserter(data_races),
                   convert_to_race);
-   // filter the ones with two atomic operations out
+   // filter the ones with two atomic operations and the ones with an Await out
    data_races.erase(std::remove_if(data_races.begin(), data_races.end(),
                                    [](const auto& data_race) {
-                                      return data_race.first.is_atomic() &&
-                                             data_race.second.is_atomic();
+                                      return (data_race.first.is_atomic() &&
+                                              data_race.second.is_atomic()) ||
+                                             data_race.first.operation() == memory_operation::Await;
                                    }),
                     data_races.end());
    return data_races;
@@ -56,7 +80,9 @@ std::vector<data_race_t> get_data_races::operator()(
 object_state::object_state(const object_t& object)
 : m_object(object)
 , m_waiting{{{}, {}}}
-, m_current(0)
+, m_held(false)
+, m_nr_readers(0)
+, m_is_semaphore(false)
 {
 }
 
@@ -65,46 +91,47 @@ object_state::object_state(const object_t& object)
 bool object_state::request(const instruction_t& instr)
 {
    using namespace program_model;
-   DEBUGF_SYNC("object", "request", boost::apply_visitor(instruction_to_short_string(), instr),
-               "\n");
    const auto op_type = boost::apply_visitor(operation_as_int(), instr) % 2;
    auto& waitset = m_waiting[op_type];
    const auto tid = boost::apply_visitor(program_model::get_tid(), instr);
    if (waitset.find(tid) == waitset.end())
    {
       waitset.insert({tid, instr});
-      DEBUG_SYNC(*this << "\n");
-      try
-      {
-         const auto& lock_instr = boost::get<lock_instruction>(instr);
-         if (lock_instr.operation() == lock_operation::Lock && m_current == 1)
-         {
-            return false;
-         }
-      }
-      catch (const boost::bad_get&)
+      RECORD_REPLAY_TRACE(object_request, m_object.address(), tid);
+      const auto* lock_instr = boost::get<lock_instruction>(&instr);
+      if (lock_instr && !m_is_semaphore &&
+          (lock_instr->operation() == lock_operation::SemWait ||
+           lock_instr->operation() == lock_operation::SemTryWait ||
+           lock_instr->operation() == lock_operation::SemPost))
       {
+         // All operations on the semaphore are visible, so it still has its initial value
+         m_is_semaphore = true;
+         m_semaphore_value = semaphore_value(m_object);
       }
-      return true;
+      return enabled(instr);
    }
    throw std::logic_error("requesting thread already has instruction waiting");
 }
 
 //--------------------------------------------------------------------------------------------------
 
-void object_state::perform(const thread_t::tid_t& tid)
+bool object_state::perform(const thread_t::tid_t& tid)
 {
-   DEBUGF_SYNC("object", "perform", tid, "\n");
+   using namespace program_model;
    for (unsigned int i = 0; i < 2; ++i)
    {
       auto& waitset = m_waiting[i];
       const auto it = waitset.find(tid);
       if (it != waitset.end())
       {
-         m_current = i;
+         bool changed = true;
+         if (const auto* lock_instr = boost::get<lock_instruction>(&it->second))
+            perform(*lock_instr);
+         else if (const auto* mem_instr = boost::get<memory_instruction>(&it->second))
+            changed = perform(*mem_instr);
          waitset.erase(it);
-         DEBUG_SYNC(*this << "\n");
-         return;
+         RECORD_REPLAY_TRACE(object_perform, m_object.address(), tid);
+         return changed;
       }
    }
    throw std::invalid_argument("requesting thread has no instruction waiting");
@@ -112,6 +139,155 @@ void object_state::perform(const thread_t::tid_t& tid)
 
 //--------------------------------------------------------------------------------------------------
 
+void object_state::perform(const program_model::lock_instruction& instr)
+{
+   using namespace program_model;
+   switch (instr.operation())
+   {
+      case lock_operation::Lock:
+         m_held = true;
+         break;
+      case lock_operation::TryLock:
+         // The instructions on the object are serialized, so the outcome is known
+         if (!m_held && m_nr_readers == 0)
+            m_held = true;
+         break;
+      case lock_operation::ReadLock:
+         ++m_nr_readers;
+         break;
+      case lock_operation::TryReadLock:
+         if (!m_held)
+            ++m_nr_readers;
+         break;
+      case lock_operation::Unlock:
+         if (m_held)
+            m_held = false;
+         else if (m_nr_readers > 0)
+            --m_nr_readers;
+         break;
+      case lock_operation::SemWait:
+      case lock_operation::SemTryWait:
+         if (m_semaphore_value && *m_semaphore_value > 0)
+            --*m_semaphore_value;
+         break;
+      case lock_operation::SemPost:
+         if (m_semaphore_value)
+            ++*m_semaphore_value;
+         break;
+      case lock_operation::CondWait:
+         m_woken.erase(std::remove(m_woken.begin(), m_woken.end(), instr.tid()), m_woken.end());
+         break;
+      case lock_operation::CondSignal:
+      case lock_operation::CondBroadcast:
+         wake<lock_instruction>(m_waiting[static_cast<int>(lock_operation::CondWait) % 2],
+                                lock_operation::CondWait,
+                                instr.operation() == lock_operation::CondBroadcast);
+         break;
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool object_state::perform(const program_model::memory_instruction& instr)
+{
+   using namespace program_model;
+   switch (instr.operation())
+   {
+      case memory_operation::Store:
+      case memory_operation::ReadModifyWrite:
+         return wake<memory_instruction>(m_waiting[static_cast<int>(memory_operation::Await) % 2],
+                                         memory_operation::Await, true);
+      case memory_operation::Await:
+         m_woken.erase(std::remove(m_woken.begin(), m_woken.end(), instr.tid()), m_woken.end());
+         return false;
+      default:
+         return false;
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+template <typename instruction_t, typename operation_t>
+bool object_state::wake(const waitset_t& waitset, const operation_t operation, const bool all)
+{
+   // The waitset is unordered: wake the smallest tid, so that a signal is deterministic
+   boost::optional<thread_t::tid_t> first;
+   bool woken = false;
+   for (const auto& request : waitset)
+   {
+      const auto* waiting = boost::get<instruction_t>(&request.second);
+      if (!waiting || waiting->operation() != operation || is_woken(request.first))
+         continue;
+      if (all)
+      {
+         m_woken.push_back(request.first);
+         woken = true;
+      }
+      else if (!first || request.first < *first)
+      {
+         first = request.first;
+      }
+   }
+   if (first)
+   {
+      m_woken.push_back(*first);
+      woken = true;
+   }
+   return woken;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool object_state::is_woken(const thread_t::tid_t& tid) const
+{
+   return std::find(m_woken.begin(), m_woken.end(), tid) != m_woken.end();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool object_state::enabled(const instruction_t& instr) const
+{
+   using namespace program_model;
+   if (const auto* lock_instr = boost::get<lock_instruction>(&instr))
+   {
+      switch (lock_instr->operation())
+      {
+         case lock_operation::Lock:
+            return !m_held && m_nr_readers == 0;
+         case lock_operation::ReadLock:
+            return !m_held;
+         case lock_operation::SemWait:
+            return !m_semaphore_value || *m_semaphore_value > 0;
+         case lock_operation::CondWait:
+            return is_woken(lock_instr->tid());
+         default:
+            return true;
+      }
+   }
+   if (const auto* mem_instr = boost::get<memory_instruction>(&instr))
+   {
+      return mem_instr->operation() != memory_operation::Await || is_woken(mem_instr->tid());
+   }
+   return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void object_state::wake_await(const thread_t::tid_t& tid)
+{
+   if (!is_woken(tid))
+      m_woken.push_back(tid);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+const program_model::Object& object_state::object() const
+{
+   return m_object;
+}
+
+//--------------------------------------------------------------------------------------------------
+
 auto object_state::begin(std::size_t index) const -> waitset_t::const_iterator
 {
    return m_waiting[index].begin();
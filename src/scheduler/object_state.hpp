@@ -1,10 +1,13 @@
 #pragma once
 
 #include "concurrency_error.hpp"
+#include "recycling_allocator.hpp"
 
 #include <thread.hpp>
 #include <visible_instruction.hpp>
 
+#include <boost/optional.hpp>
+
 #include <array>
 #include <unordered_map>
 #include <vector>
@@ -24,24 +27,73 @@ public:
    using thread_t = program_model::Thread;
    using object_t = program_model::Object;
    using instruction_t = program_model::visible_instruction_t;
-   using waitset_t = std::unordered_map<thread_t::tid_t, instruction_t>;
+   using waitset_t = recycling_unordered_map<thread_t::tid_t, instruction_t>;
 
    /// @brief Constructor.
 
    explicit object_state(const object_t& object);
 
+   /// @brief Adds instr to the instructions waiting for the object.
+   /// @return Whether instr is enabled.
+
    bool request(const instruction_t& instr);
-   void perform(const thread_t::tid_t& tid);
+
+   /// @brief Performs the instruction of tid waiting for the object, updating the state of the
+   /// object as a lock, semaphore or condition variable if it is a lock_instruction.
+   /// @return Whether the enabledness of the other instructions waiting for the object may have
+   /// changed.
+
+   bool perform(const thread_t::tid_t& tid);
+
+   /// @brief Returns whether instr can be performed on the object without blocking, i.e. whether
+   /// it is not a Lock of a held lock, a ReadLock of an exclusively held lock, a SemWait on a
+   /// semaphore of value 0, or a CondWait or Await that was not woken yet.
+
+   bool enabled(const instruction_t& instr) const;
+
+   /// @brief Wakes the Await of tid on the object, as a write to the object would.
+
+   void wake_await(const thread_t::tid_t& tid);
 
    waitset_t::const_iterator begin(std::size_t index) const;
    waitset_t::const_iterator end(std::size_t index) const;
 
+   const object_t& object() const;
+
    std::string str() const;
 
 private:
    object_t m_object;
    std::array<waitset_t, 2> m_waiting;
-   unsigned int m_current;
+
+   /// @brief Whether the object, as a lock, is held exclusively.
+   bool m_held;
+
+   /// @brief The number of shared holders of the object, as a readers-writer lock.
+   unsigned int m_nr_readers;
+
+   /// @brief Whether the object was requested as a semaphore.
+   bool m_is_semaphore;
+
+   /// @brief The value of the object as a semaphore, read from the semaphore when it is first
+   /// requested as one, or none if it cannot be read.
+   boost::optional<int> m_semaphore_value;
+
+   /// @brief The threads whose CondWait on the object, as a condition variable, was woken by a
+   /// CondSignal or CondBroadcast, or whose Await was woken by a write to the object.
+   std::vector<thread_t::tid_t> m_woken;
+
+   void perform(const program_model::lock_instruction& instr);
+   bool perform(const program_model::memory_instruction& instr);
+
+   /// @brief Wakes the first (by tid) or all of the instructions of the given waitset with the
+   /// given operation that were not woken yet.
+   /// @return Whether an instruction was woken.
+
+   template <typename instruction_t, typename operation_t>
+   bool wake(const waitset_t& waitset, operation_t operation, bool all);
+
+   bool is_woken(const thread_t::tid_t& tid) const;
 
    friend std::ostream& operator<<(std::ostream&, const object_state&);
 
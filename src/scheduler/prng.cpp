@@ -0,0 +1,73 @@
+
+#include "prng.hpp"
+
+#include <assert.h>
+
+
+namespace scheduler {
+
+namespace {
+
+uint64_t rotl(const uint64_t x, const int k)
+{
+   return (x << k) | (x >> (64 - k));
+}
+
+uint64_t splitmix64(uint64_t& x)
+{
+   uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+   z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+   z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+   return z ^ (z >> 31);
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+
+prng::prng(uint64_t seed)
+{
+   for (auto& word : m_state)
+   {
+      word = splitmix64(seed);
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+prng::result_type prng::operator()()
+{
+   const uint64_t result = rotl(m_state[1] * 5, 7) * 9;
+   const uint64_t t = m_state[1] << 17;
+   m_state[2] ^= m_state[0];
+   m_state[3] ^= m_state[1];
+   m_state[1] ^= m_state[2];
+   m_state[0] ^= m_state[3];
+   m_state[2] ^= t;
+   m_state[3] = rotl(m_state[3], 45);
+   return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint64_t prng::below(uint64_t bound)
+{
+   /// @pre 0 < bound < 2^32
+   assert(bound > 0 && bound <= std::numeric_limits<uint32_t>::max());
+   uint64_t product = ((*this)() >> 32) * bound;
+   uint32_t low = static_cast<uint32_t>(product);
+   if (low < bound)
+   {
+      const uint32_t threshold = static_cast<uint32_t>(-static_cast<uint32_t>(bound)) % bound;
+      while (low < threshold)
+      {
+         product = ((*this)() >> 32) * bound;
+         low = static_cast<uint32_t>(product);
+      }
+   }
+   return product >> 32;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace scheduler
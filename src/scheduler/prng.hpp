@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+//--------------------------------------------------------------------------------------------------
+/// @file prng.hpp
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+namespace scheduler {
+
+/// @brief Seedable pseudo random number generator for the randomized strategies (xoshiro256**,
+/// Blackman and Vigna).
+/// @details Satisfies UniformRandomBitGenerator, so that it can be used with the distributions
+/// in <random>. The sequence of draws is fully determined by the seed, which is expanded into
+/// the 256 bit state with splitmix64.
+
+class prng
+{
+public:
+   using result_type = uint64_t;
+
+   explicit prng(uint64_t seed);
+
+   static constexpr result_type min()
+   {
+      return 0;
+   }
+
+   static constexpr result_type max()
+   {
+      return std::numeric_limits<result_type>::max();
+   }
+
+   result_type operator()();
+
+   /// @brief Returns a uniformly distributed number in [0, bound).
+   /// @details Uses Lemire's multiply-and-reject method, which avoids the modulo bias of
+   /// rand() % bound and, in the common case, a division.
+   /// @pre 0 < bound < 2^32
+
+   uint64_t below(uint64_t bound);
+
+private:
+   uint64_t m_state[4];
+
+}; // end class prng
+
+} // end namespace scheduler
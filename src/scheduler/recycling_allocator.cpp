@@ -0,0 +1,74 @@
+
+#include "recycling_allocator.hpp"
+
+#include <new>
+
+
+namespace scheduler {
+
+//--------------------------------------------------------------------------------------------------
+
+constexpr std::size_t block_recycler::granularity;
+constexpr std::size_t block_recycler::max_size;
+
+//--------------------------------------------------------------------------------------------------
+
+block_recycler::block_recycler()
+: m_free()
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+
+block_recycler::~block_recycler()
+{
+   for (auto* block : m_free)
+   {
+      while (block)
+      {
+         auto* next = block->next;
+         ::operator delete(block);
+         block = next;
+      }
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void* block_recycler::allocate(const std::size_t size)
+{
+   if (size > max_size)
+      return ::operator new(size);
+   auto& free = m_free[size_class(size)];
+   if (free)
+   {
+      auto* block = free;
+      free = block->next;
+      return block;
+   }
+   return ::operator new((size_class(size) + 1) * granularity);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void block_recycler::deallocate(void* const block, const std::size_t size)
+{
+   if (size > max_size)
+   {
+      ::operator delete(block);
+      return;
+   }
+   auto& free = m_free[size_class(size)];
+   free = new (block) free_block{free};
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::size_t block_recycler::size_class(const std::size_t size)
+{
+   return (size - 1) / granularity;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace scheduler
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
+//--------------------------------------------------------------------------------------------------
+/// @file recycling_allocator.hpp
+/// @brief Allocator keeping the nodes of a container for reuse.
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+namespace scheduler {
+
+/// @brief Keeps deallocated blocks in free lists per size class (multiples of 16 bytes up to
+/// max_size) instead of returning them to the heap.
+/// @note Not thread-safe: a block_recycler is used by a single container, under the lock that
+/// protects the container.
+
+class block_recycler
+{
+public:
+   static constexpr std::size_t granularity = 16;
+   static constexpr std::size_t max_size = 512;
+
+   block_recycler();
+   block_recycler(const block_recycler&) = delete;
+   block_recycler& operator=(const block_recycler&) = delete;
+   ~block_recycler();
+
+   void* allocate(std::size_t size);
+   void deallocate(void* block, std::size_t size);
+
+private:
+   struct free_block
+   {
+      free_block* next;
+   };
+
+   std::array<free_block*, max_size / granularity> m_free;
+
+   static std::size_t size_class(std::size_t size);
+
+}; // end class block_recycler
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Allocator with which a node-based container, whose size oscillates as elements are
+/// inserted and erased, stops allocating once it has reached its peak size. Copies and rebinds
+/// of an allocator share its block_recycler.
+
+template <typename T>
+class recycling_allocator
+{
+public:
+   using value_type = T;
+
+   recycling_allocator()
+   : m_recycler(std::make_shared<block_recycler>())
+   {
+   }
+
+   template <typename U>
+   recycling_allocator(const recycling_allocator<U>& other)
+   : m_recycler(other.m_recycler)
+   {
+   }
+
+   T* allocate(const std::size_t n)
+   {
+      if (n == 1)
+         return static_cast<T*>(m_recycler->allocate(sizeof(T)));
+      return std::allocator<T>().allocate(n);
+   }
+
+   void deallocate(T* const p, const std::size_t n)
+   {
+      if (n == 1)
+         m_recycler->deallocate(p, sizeof(T));
+      else
+         std::allocator<T>().deallocate(p, n);
+   }
+
+   template <typename U>
+   bool operator==(const recycling_allocator<U>& other) const
+   {
+      return m_recycler == other.m_recycler;
+   }
+
+   template <typename U>
+   bool operator!=(const recycling_allocator<U>& other) const
+   {
+      return m_recycler != other.m_recycler;
+   }
+
+private:
+   std::shared_ptr<block_recycler> m_recycler;
+
+   template <typename U>
+   friend class recycling_allocator;
+
+}; // end class recycling_allocator
+
+template <typename Key, typename T>
+using recycling_unordered_map = std::unordered_map<Key, T, std::hash<Key>, std::equal_to<Key>,
+                                                   recycling_allocator<std::pair<const Key, T>>>;
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace scheduler
@@ -1,33 +1,112 @@
 
 #include "replay.hpp"
 
+#include "checkpoint.hpp"
 #include "scheduler_settings.hpp"
 
 #include <container_output.hpp>
 #include <fork.hpp>
 
+#if defined(RECORD_REPLAY_IN_PROCESS_INSTRUMENTATION)
+#include <instrumenter.hpp>
+#endif
+
 #include <boost/filesystem.hpp>
 #include <boost/preprocessor/stringize.hpp>
-
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
 
 
 namespace scheduler {
 
 //--------------------------------------------------------------------------------------------------
 
+namespace {
+
+const boost::filesystem::path checkpoint_dir = "schedules/checkpoint";
+
+/// @brief Opening a missing fifo with an std::ofstream would create a regular file instead.
+/// @throws std::runtime_error if there are no checkpoint fifos.
+
+void require_checkpoint()
+{
+   for (const auto& fifo :
+        {checkpoint::request_fifo(checkpoint_dir), checkpoint::response_fifo(checkpoint_dir)})
+   {
+      if (boost::filesystem::status(fifo).type() != boost::filesystem::fifo_file)
+         throw std::runtime_error("no checkpoint: " + fifo.string() + " is not a fifo");
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Lifts the limit of glibc's stack cache for the programs run from now on, so that glibc
+/// does not unmap the stacks of the threads that vanish when a checkpoint is taken, on which the
+/// re-created threads run (see checkpoint).
+
+void keep_cached_stacks()
+{
+   const std::string tunable = "glibc.pthread.stack_cache_size";
+   const char* tunables = std::getenv("GLIBC_TUNABLES");
+   std::string value = tunables ? tunables : "";
+   if (value.find(tunable) != std::string::npos)
+      return;
+   // 1 TiB
+   value += (value.empty() ? "" : ":") + tunable + "=1099511627776";
+   setenv("GLIBC_TUNABLES", value.c_str(), 1);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void move_records(const boost::filesystem::path& output_dir)
+{
+   if (!boost::filesystem::exists(output_dir))
+      boost::filesystem::create_directories(output_dir);
+
+   // The Scheduler writes its records to the output_dir of the settings it reads
+   const auto records_dir =
+      SchedulerSettings::read_from_file("schedules/settings.txt").output_dir();
+   if (!boost::filesystem::exists(records_dir) ||
+       boost::filesystem::equivalent(records_dir, output_dir))
+      return;
+
+   // The records of the execution are absent under trace_format=none, record.txt and
+   // record_short.txt under trace_format=binary, and record.bin under trace_format=text.
+   // record.txt and record.bin are suffixed .lz4 under trace_codec=lz4. trace_events.bin is
+   // absent under trace_level=0
+   for (const auto* record : {"record.txt", "record.txt.lz4", "record_short.txt", "record.bin",
+                              "record.bin.lz4", "record_times.txt", "record_settings.txt",
+                              "stats.json", "sites.txt", "trace_events.bin"})
+   {
+      if (boost::filesystem::exists(records_dir / record))
+         boost::filesystem::rename(records_dir / record, output_dir / record);
+   }
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+
 void run_under_schedule(const program_t& program, const schedule_t& schedule,
                         const boost::optional<timeout_t>& timeout,
                         const boost::filesystem::path& output_dir)
 {
    write_schedules(schedule);
    utils::sys::fork_process(program.string(), timeout);
-
-   if (!boost::filesystem::exists(output_dir))
-      boost::filesystem::create_directories(output_dir);
-
-   boost::filesystem::rename("./record.txt", output_dir / "record.txt");
-   boost::filesystem::rename("./record_short.txt", output_dir / "record_short.txt");
+   move_records(output_dir);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -38,61 +117,194 @@ void run_under_schedule(const program_t& program, const schedule_t& schedule,
                         const boost::filesystem::path& output_dir)
 {
    write_settings(settings);
+   if (settings.checkpoint())
+      keep_cached_stacks();
    run_under_schedule(program, schedule, timeout, output_dir);
 }
 
 //--------------------------------------------------------------------------------------------------
 
+int run_from_checkpoint(const schedule_t& schedule, const boost::filesystem::path& output_dir)
+{
+   require_checkpoint();
+   write_schedules(schedule);
+   {
+      std::ofstream request(checkpoint::request_fifo(checkpoint_dir).string());
+      request << checkpoint::branch_command << std::endl;
+   }
+   int status = -1;
+   {
+      std::ifstream response(checkpoint::response_fifo(checkpoint_dir).string());
+      response >> status;
+   }
+   move_records(output_dir);
+   return status;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void release_checkpoint()
+{
+   require_checkpoint();
+   {
+      std::ofstream request(checkpoint::request_fifo(checkpoint_dir).string());
+      request << checkpoint::quit_command << std::endl;
+   }
+   // The acknowledgement comes once the fifos are removed
+   int status = -1;
+   std::ifstream response(checkpoint::response_fifo(checkpoint_dir).string());
+   response >> status;
+}
+
+//--------------------------------------------------------------------------------------------------
+
 namespace detail {
 
 const static boost::filesystem::path llvm_bin = BOOST_PP_STRINGIZE(LLVM_BIN);
 const static boost::filesystem::path record_replay_build_dir =
    BOOST_PP_STRINGIZE(RECORD_REPLAY_BUILD_DIR);
 
+#ifdef __APPLE__
+const static std::string shared_library_extension = ".dylib";
+#else
+const static std::string shared_library_extension = ".so";
+#endif
+
+//--------------------------------------------------------------------------------------------------
+
+boost::filesystem::path pass_module()
+{
+   return record_replay_build_dir / "src/llvm-pass" /
+          ("LLVMRecordReplayPass" + shared_library_extension);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @throws std::runtime_error if command does not exit with status 0.
+
+void run_command(const std::string& command)
+{
+   const int status = system(command.c_str());
+   if (status != 0)
+      throw std::runtime_error("exit status " + std::to_string(status) + " of " + command);
+}
+
 //--------------------------------------------------------------------------------------------------
 
 std::string get_compiler(const program_t& program)
 {
-   std::string compiler;
-   if (program.extension() == ".c")
+   const auto extension = program.extension();
+   if (extension == ".c")
       return "clang";
-   else if (program.extension() == ".cpp")
+   else if (extension == ".cpp" || extension == ".cc" || extension == ".cxx")
       return "clang++";
    throw std::invalid_argument("Input program must be a .c or a .cpp program");
 }
 
 //--------------------------------------------------------------------------------------------------
 
+/// @brief Splits a command line into arguments at unquoted whitespace, removing the quotes and
+/// backslash escapes like a POSIX shell would.
+
+std::vector<std::string> split_command_line(const std::string& command_line)
+{
+   std::vector<std::string> arguments;
+   std::string argument;
+   bool in_argument = false;
+   char quote = 0;
+   for (std::size_t i = 0; i < command_line.size(); ++i)
+   {
+      const char c = command_line[i];
+      if (quote == '\'' && c != '\'')
+         argument += c;
+      else if (c == '\\' && i + 1 < command_line.size() && quote != '\'')
+         argument += command_line[++i];
+      else if (c == '"' || c == '\'')
+      {
+         if (!quote)
+            quote = c;
+         else if (quote == c)
+            quote = 0;
+         else
+            argument += c;
+      }
+      else if (!quote && std::isspace(static_cast<unsigned char>(c)))
+      {
+         if (in_argument)
+            arguments.push_back(argument);
+         argument.clear();
+         in_argument = false;
+         continue;
+      }
+      else
+         argument += c;
+      in_argument = true;
+   }
+   if (in_argument)
+      arguments.push_back(argument);
+   return arguments;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::string join_quoted(const std::vector<std::string>& arguments)
+{
+   std::string command_line;
+   for (const auto& argument : arguments)
+   {
+      std::string quoted = "'";
+      for (const char c : argument)
+         quoted += c == '\'' ? std::string("'\\''") : std::string(1, c);
+      command_line += " " + quoted + "'";
+   }
+   return command_line;
+}
+
+//--------------------------------------------------------------------------------------------------
+
 boost::filesystem::path compile_to_llvm_ir(const program_t& program,
-                                           const boost::filesystem::path& output_dir,
+                                           const boost::filesystem::path& ir_program,
                                            const std::string& compiler,
                                            const std::string& optimization_level,
-                                           const std::string& compiler_options)
+                                           const std::vector<std::string>& compiler_options)
 {
-   auto ir_program = output_dir / program.filename();
-   ir_program += ".bc";
-
    const std::string command = (llvm_bin / compiler).string() + " -g -pthread -emit-llvm -O" +
-                               optimization_level + " " + compiler_options + " -c " +
+                               optimization_level + join_quoted(compiler_options) + " -c " +
                                program.string() + " -o " + ir_program.string();
-   system(command.c_str());
+   run_command(command);
 
    return ir_program;
 }
 
 //--------------------------------------------------------------------------------------------------
 
-boost::filesystem::path run_instrumentation_pass(const boost::filesystem::path& ir_program)
+/// @param whole_program Whether ir_program is a whole program, so that only accesses to memory
+/// that may be shared between threads need instrumenting.
+/// @throws std::runtime_error if opt fails, in which case no instrumented program is left.
+
+boost::filesystem::path run_instrumentation_pass(const boost::filesystem::path& ir_program,
+                                                 bool whole_program = false)
 {
    auto instrumented_program = ir_program;
    instrumented_program.replace_extension(".instrumented.bc");
 
-   const std::string command =
-      (llvm_bin / "opt").string() + " -load " +
-      (record_replay_build_dir / "src/llvm-pass/LLVMRecordReplayPass.dylib").string() +
-      " -instrument-record-replay-lw < " + ir_program.string() + " > " +
-      instrumented_program.string();
-   system(command.c_str());
+#if defined(RECORD_REPLAY_PASS_PLUGIN)
+   const std::string pass = " -load-pass-plugin " + pass_module().string() + " -passes=" +
+                            (whole_program ? "instrument-record-replay-whole-program"
+                                           : "instrument-record-replay-lw");
+#else
+   const std::string pass = " -load " + pass_module().string() + " -instrument-record-replay-lw" +
+                            (whole_program ? " -record-replay-whole-program" : "");
+#endif
+   const std::string command = (llvm_bin / "opt").string() + pass + " < " + ir_program.string() +
+                               " > " + instrumented_program.string();
+   // The redirection creates the output even if opt fails
+   const int status = system(command.c_str());
+   if (status != 0 || boost::filesystem::file_size(instrumented_program) == 0)
+   {
+      boost::filesystem::remove(instrumented_program);
+      throw std::runtime_error("exit status " + std::to_string(status) + " of " + command);
+   }
 
    return instrumented_program;
 }
@@ -111,22 +323,232 @@ void dump_human_readable_ir(const boost::filesystem::path& instrumented_ir)
 
 //--------------------------------------------------------------------------------------------------
 
-boost::filesystem::path link_with_scheduler_library(const boost::filesystem::path& instrumented_ir,
-                                                    const std::string& compiler)
+/// @brief Compiles and instruments program into <output>.instrumented.o if built with
+/// RECORD_REPLAY_IN_PROCESS_INSTRUMENTATION or RECORD_REPLAY_PASS_PLUGIN, and into
+/// <output>.instrumented.bc otherwise.
+
+boost::filesystem::path instrument_translation_unit(
+   const program_t& program, const boost::filesystem::path& output, const std::string& compiler,
+   const std::string& optimization_level, const std::vector<std::string>& compiler_options,
+   bool dump_human_readable_ir)
+{
+#if defined(RECORD_REPLAY_IN_PROCESS_INSTRUMENTATION)
+   auto object = output;
+   object += ".instrumented.o";
+
+   concurrency_passes::instrumenter_options options;
+   options.compiler = llvm_bin / compiler;
+   options.optimization_level = optimization_level;
+   options.compiler_options = compiler_options;
+   options.dump_ir = dump_human_readable_ir;
+   concurrency_passes::compile_instrumented_object(program, object, options);
+
+   return object;
+#elif defined(RECORD_REPLAY_PASS_PLUGIN)
+   auto object = output;
+   object += ".instrumented.o";
+
+   // clang runs the pass at the end of its optimization pipeline
+   const std::string command = (llvm_bin / compiler).string() + " -g -pthread -O" +
+                               optimization_level + join_quoted(compiler_options) +
+                               " -fpass-plugin=" + pass_module().string() + " -c " +
+                               program.string();
+   run_command(command + " -o " + object.string());
+   if (dump_human_readable_ir)
+   {
+      auto dump = output;
+      dump += ".instrumented.txt";
+      system((command + " -S -emit-llvm -o " + dump.string()).c_str());
+   }
+
+   return object;
+#else
+   auto ir_program = output;
+   ir_program += ".bc";
+   compile_to_llvm_ir(program, ir_program, compiler, optimization_level, compiler_options);
+
+   const auto instrumented = run_instrumentation_pass(ir_program);
+   if (dump_human_readable_ir)
+      detail::dump_human_readable_ir(instrumented);
+   return instrumented;
+#endif
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Links the bitcode files ir_programs into <output>.bc and instruments the whole program
+/// into <output>.instrumented.bc.
+/// @throws std::runtime_error if llvm-link or opt fails.
+
+boost::filesystem::path instrument_whole_program(
+   const std::vector<boost::filesystem::path>& ir_programs, const boost::filesystem::path& output,
+   bool dump_human_readable_ir)
+{
+   auto linked = output;
+   linked += ".bc";
+   std::string command = (llvm_bin / "llvm-link").string();
+   for (const auto& ir_program : ir_programs)
+      command += " " + ir_program.string();
+   run_command(command + " -o " + linked.string());
+
+   const auto instrumented = run_instrumentation_pass(linked, true);
+   if (dump_human_readable_ir)
+      detail::dump_human_readable_ir(instrumented);
+   return instrumented;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Preprocesses program, which includes the headers it depends on.
+/// @throws std::runtime_error if the compiler fails.
+
+std::string preprocess(const program_t& program, const std::string& compiler,
+                       const std::vector<std::string>& compiler_options)
+{
+   const std::string command = (llvm_bin / compiler).string() + " -E" +
+                               join_quoted(compiler_options) + " " + program.string();
+   std::string output;
+   FILE* pipe = popen(command.c_str(), "r");
+   if (pipe == nullptr)
+      throw std::runtime_error("cannot run " + command);
+   char buffer[4096];
+   std::size_t size;
+   while ((size = fread(buffer, 1, sizeof(buffer), pipe)) > 0)
+      output.append(buffer, size);
+   const int status = pclose(pipe);
+   if (status != 0)
+      throw std::runtime_error("exit status " + std::to_string(status) + " of " + command);
+   return output;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @param instrumented The instrumented bitcode or object files.
+
+void link_with_scheduler_library(const std::vector<boost::filesystem::path>& instrumented,
+                                 const boost::filesystem::path& executable,
+                                 const std::string& compiler,
+                                 const std::vector<std::string>& link_options = {})
 {
    const auto scheduler_build_dir = record_replay_build_dir / "src/scheduler";
-   auto instrumented_executable = instrumented_ir;
-   instrumented_executable.replace_extension("");
 
-   const std::string command =
-      (llvm_bin / compiler).string() + " " + instrumented_ir.string() + " " +
-      (scheduler_build_dir / "libRecordReplayScheduler.dylib").string() + " -rpath " +
-      scheduler_build_dir.string() + " -o " + instrumented_executable.string();
+   std::string command = (llvm_bin / compiler).string();
+   for (const auto& file : instrumented)
+      command += " " + file.string();
+   command += " " +
+              (scheduler_build_dir / ("libRecordReplayScheduler" + shared_library_extension))
+                 .string() +
+              join_quoted(link_options) + " -pthread -Wl,-rpath," + scheduler_build_dir.string() +
+              " -o " + executable.string();
    system(command.c_str());
+}
 
-   return instrumented_executable;
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief 64-bit FNV-1a, which unlike std::hash is the same across runs and platforms.
+
+class content_hash
+{
+public:
+   content_hash& add(const std::string& data)
+   {
+      for (const char c : data)
+         m_hash = (m_hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+      // Separate consecutive pieces of data
+      m_hash = (m_hash ^ 0xffu) * 1099511628211ull;
+      return *this;
+   }
+
+   content_hash& add_file(const boost::filesystem::path& file)
+   {
+      std::ifstream ifs(file.string(), std::ios::binary);
+      return add(std::string(std::istreambuf_iterator<char>(ifs), {}));
+   }
+
+   std::string str() const
+   {
+      std::ostringstream os;
+      os << std::hex << std::setw(16) << std::setfill('0') << m_hash;
+      return os.str();
+   }
+
+private:
+   uint64_t m_hash = 14695981039346656037ull;
+
+}; // end class content_hash
+
+//--------------------------------------------------------------------------------------------------
+
+struct translation_unit
+{
+   program_t file;
+   boost::filesystem::path directory;
+   std::vector<std::string> compiler_options;
+};
+
+/// @brief Reads a translation unit from an entry of a compile_commands.json, keeping the options
+/// of its command that affect compilation, but not the compiler, -c, -o <file>, dependency file
+/// options and the source file.
+
+translation_unit read_compile_command(const boost::property_tree::ptree& entry)
+{
+   translation_unit unit;
+   unit.directory = entry.get<std::string>("directory");
+   unit.file = entry.get<std::string>("file");
+   if (unit.file.is_relative())
+      unit.file = unit.directory / unit.file;
+
+   std::vector<std::string> arguments;
+   if (const auto list = entry.get_child_optional("arguments"))
+   {
+      for (const auto& argument : *list)
+         arguments.push_back(argument.second.get_value<std::string>());
+   }
+   else
+   {
+      arguments = split_command_line(entry.get<std::string>("command"));
+   }
+
+   for (std::size_t i = 1; i < arguments.size(); ++i)
+   {
+      const auto& argument = arguments[i];
+      if (argument == "-o" || argument == "-MF" || argument == "-MT" || argument == "-MQ")
+         ++i;
+      else if (argument != "-c" && argument != "-MD" && argument != "-MMD" &&
+               unit.file != boost::filesystem::absolute(argument, unit.directory))
+         unit.compiler_options.push_back(argument);
+   }
+   // Relative include paths and the like are relative to the directory of the command
+   unit.compiler_options.insert(unit.compiler_options.begin(),
+                                {"-working-directory", unit.directory.string()});
+   return unit;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Reads the translation units from compile_commands, keeping the options of each command
+/// that affect compilation, but not the compiler, -c, -o <file>, dependency file options and the
+/// source file.
+
+std::vector<translation_unit> read_compile_commands(const boost::filesystem::path& compile_commands)
+{
+   boost::property_tree::ptree entries;
+   std::vector<translation_unit> units;
+   try
+   {
+      boost::property_tree::read_json(compile_commands.string(), entries);
+      for (const auto& entry : entries)
+         units.push_back(read_compile_command(entry.second));
+   }
+   catch (const boost::property_tree::ptree_error& error)
+   {
+      throw std::invalid_argument(compile_commands.string() + ": " + error.what());
+   }
+   return units;
 }
 
+
 } // end namespace detail
 
 //--------------------------------------------------------------------------------------------------
@@ -135,22 +557,144 @@ boost::filesystem::path link_with_scheduler_library(const boost::filesystem::pat
 boost::filesystem::path instrument(const program_t& program_source,
                                    const boost::filesystem::path& output_dir,
                                    const std::string& optimization_level,
-                                   const std::string& compiler_options)
+                                   const std::string& compiler_options,
+                                   bool dump_human_readable_ir)
 {
    if (boost::filesystem::exists(output_dir))
       boost::filesystem::remove_all(output_dir);
    boost::filesystem::create_directories(output_dir);
 
-   const auto ir_program =
-      detail::compile_to_llvm_ir(program_source, output_dir, detail::get_compiler(program_source),
-                                 optimization_level, compiler_options);
+   const auto compiler = detail::get_compiler(program_source);
+   const auto instrumented = detail::instrument_translation_unit(
+      program_source, output_dir / program_source.filename(), compiler, optimization_level,
+      detail::split_command_line(compiler_options), dump_human_readable_ir);
 
-   const auto instrumented_ir = detail::run_instrumentation_pass(ir_program);
+   auto instrumented_executable = instrumented;
+   instrumented_executable.replace_extension("");
+   detail::link_with_scheduler_library({instrumented}, instrumented_executable, compiler);
+   return instrumented_executable;
+}
 
-   detail::dump_human_readable_ir(instrumented_ir);
+//--------------------------------------------------------------------------------------------------
 
-   return detail::link_with_scheduler_library(instrumented_ir,
-                                              detail::get_compiler(program_source));
+project_result instrument_project(const boost::filesystem::path& compile_commands,
+                                  const boost::filesystem::path& output_dir,
+                                  const project_options& options)
+{
+   const auto units = detail::read_compile_commands(compile_commands);
+   // Absolute, as the commands run in their own directories
+   const auto cache_dir = boost::filesystem::absolute(
+      options.cache_dir.empty() ? output_dir / "cache" : options.cache_dir);
+   boost::filesystem::create_directories(cache_dir);
+
+#if defined(RECORD_REPLAY_IN_PROCESS_INSTRUMENTATION) || defined(RECORD_REPLAY_PASS_PLUGIN)
+   std::string extension = ".instrumented.o";
+#else
+   std::string extension = ".instrumented.bc";
+#endif
+   // The whole program is instrumented after linking the bitcode of the translation units
+   if (options.whole_program)
+      extension = ".bc";
+   detail::content_hash pass_hash;
+   pass_hash.add_file(detail::pass_module());
+
+   // The cached file of each unit, and the units to instrument (once per distinct key)
+   std::vector<boost::filesystem::path> instrumented;
+   std::vector<std::pair<std::size_t, std::string>> to_instrument;
+   std::set<std::string> keys;
+   std::string linker = "clang";
+   for (std::size_t i = 0; i < units.size(); ++i)
+   {
+      const auto compiler = detail::get_compiler(units[i].file);
+      if (compiler == "clang++")
+         linker = compiler;
+
+      // The preprocessed source covers the included headers
+      auto hash = pass_hash;
+      hash.add(detail::preprocess(units[i].file, compiler, units[i].compiler_options))
+         .add(units[i].directory.string())
+         .add(compiler)
+         .add(options.optimization_level)
+         .add(extension);
+      for (const auto& option : units[i].compiler_options)
+         hash.add(option);
+      const auto key = hash.str();
+
+      instrumented.push_back(cache_dir / (key + extension));
+      if (!boost::filesystem::exists(instrumented.back()) && keys.insert(key).second)
+         to_instrument.emplace_back(i, key);
+   }
+
+   std::atomic<std::size_t> next(0);
+   std::mutex failures_mutex;
+   std::vector<std::string> failures;
+   const auto instrument_units = [&] {
+      for (auto j = next++; j < to_instrument.size(); j = next++)
+      {
+         const auto& unit = units[to_instrument[j].first];
+         const auto& key = to_instrument[j].second;
+         const auto temporary_prefix = key + ".tmp";
+         try
+         {
+            // Instrument into a temporary, so that an interrupted run leaves no partial entry
+            const auto temporary =
+               options.whole_program
+                  ? detail::compile_to_llvm_ir(unit.file, cache_dir / temporary_prefix,
+                                               detail::get_compiler(unit.file),
+                                               options.optimization_level, unit.compiler_options)
+                  : detail::instrument_translation_unit(
+                       unit.file, cache_dir / temporary_prefix, detail::get_compiler(unit.file),
+                       options.optimization_level, unit.compiler_options,
+                       options.dump_human_readable_ir);
+            if (!boost::filesystem::exists(temporary) ||
+                boost::filesystem::file_size(temporary) == 0)
+               throw std::runtime_error("no output");
+            boost::filesystem::rename(temporary, cache_dir / (key + extension));
+         }
+         catch (const std::exception& e)
+         {
+            // Remove the temporary files of the unit (<key>.tmp and derived files), which would
+            // otherwise be left in the cache
+            boost::system::error_code error;
+            for (const auto& entry : boost::filesystem::directory_iterator(cache_dir, error))
+            {
+               if (entry.path().filename().string().compare(0, temporary_prefix.size(),
+                                                             temporary_prefix) == 0)
+                  boost::filesystem::remove(entry.path(), error);
+            }
+            std::lock_guard<std::mutex> lock(failures_mutex);
+            failures.push_back(unit.file.string() + ": " + e.what());
+         }
+      }
+   };
+
+   const unsigned int nr_jobs =
+      options.nr_jobs > 0 ? options.nr_jobs : std::max(1u, std::thread::hardware_concurrency());
+   std::vector<std::thread> workers;
+   for (unsigned int job = 1; job < std::min<std::size_t>(nr_jobs, to_instrument.size()); ++job)
+      workers.emplace_back(instrument_units);
+   instrument_units();
+   for (auto& worker : workers)
+      worker.join();
+
+   if (!failures.empty())
+   {
+      std::string what = "instrumenting failed for";
+      for (const auto& failure : failures)
+         what += "\n   " + failure;
+      throw std::runtime_error(what);
+   }
+
+   project_result result{output_dir / options.executable_name, to_instrument.size(),
+                         units.size() - to_instrument.size()};
+   if (options.whole_program)
+   {
+      instrumented = {detail::instrument_whole_program(instrumented, result.executable,
+                                                       options.dump_human_readable_ir)};
+   }
+   detail::link_with_scheduler_library(instrumented, result.executable, linker,
+                                       detail::split_command_line(options.link_options));
+   return result;
 }
 #endif
 
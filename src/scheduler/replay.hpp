@@ -7,6 +7,7 @@
 
 #include <chrono>
 #include <string>
+#include <vector>
 
 //--------------------------------------------------------------------------------------------------
 /// @file replay.hpp
@@ -35,15 +36,93 @@ void run_under_schedule(const program_t&, const schedule_t&,
                         const boost::optional<timeout_t>& timeout = boost::none,
                         const boost::filesystem::path& output_dir = "./record_replay_output");
 
+/// @note If the settings take a checkpoint, the limit of glibc's stack cache is lifted for this
+/// and later runs (see checkpoint).
+
 void run_under_schedule(const program_t&, const schedule_t&, const SchedulerSettings&,
                         const boost::optional<timeout_t>& timeout = boost::none,
                         const boost::filesystem::path& output_dir = "./record_replay_output");
 
+/// @brief Continues the execution from the checkpoint taken by a previous run (see
+/// SchedulerSettings::checkpoint) under the given schedule, which includes the prefix up to the
+/// checkpoint.
+/// @returns The exit status of the branch process.
+/// @throws std::runtime_error if no checkpoint was taken.
+
+int run_from_checkpoint(const schedule_t&,
+                        const boost::filesystem::path& output_dir = "./record_replay_output");
+
+/// @brief Terminates the checkpoint taken by a previous run, once it removed its fifos, so that
+/// a next run can take a checkpoint.
+/// @throws std::runtime_error if no checkpoint was taken.
+
+void release_checkpoint();
+
 #if defined(LLVM_BIN) && defined(RECORD_REPLAY_BUILD_DIR)
+/// @brief Compiles program_source, instruments it with LightWeightPass and links it with the
+/// scheduler library into output_dir.
+/// @details If built with RECORD_REPLAY_IN_PROCESS_INSTRUMENTATION, the program is compiled,
+/// instrumented and emitted as an object file in-process (see llvm-pass/instrumenter.hpp). If
+/// built with RECORD_REPLAY_PASS_PLUGIN, clang instruments it while compiling, with the pass
+/// module as -fpass-plugin. Otherwise this goes through clang, opt and bitcode files. With
+/// dump_human_readable_ir, the instrumented IR is also written as text.
+
 boost::filesystem::path instrument(const program_t& program_source,
                                    const boost::filesystem::path& output_dir,
                                    const std::string& optimization_level = "0",
-                                   const std::string& compiler_options = "");
+                                   const std::string& compiler_options = "",
+                                   bool dump_human_readable_ir = false);
+
+struct project_options
+{
+   /// @brief The default optimization level, overridden by -O options of the commands.
+   std::string optimization_level = "0";
+
+   /// @brief The number of translation units instrumented in parallel, 0 for one per core.
+   unsigned int nr_jobs = 0;
+
+   /// @brief The directory of instrumented translation units, by default <output_dir>/cache.
+   boost::filesystem::path cache_dir;
+
+   std::string executable_name = "program";
+
+   /// @brief Further options for linking the executable, e.g. libraries.
+   std::string link_options;
+
+   bool dump_human_readable_ir = false;
+
+   /// @brief Whether to link the translation units into a single module and instrument it as a
+   /// whole, like at LTO link time, instead of instrumenting each translation unit. This knows
+   /// which memory may be shared between threads and only instruments accesses to it.
+   bool whole_program = false;
+
+}; // end struct project_options
+
+struct project_result
+{
+   boost::filesystem::path executable;
+
+   /// @brief The number of translation units instrumented, or compiled to bitcode if
+   /// project_options::whole_program.
+   std::size_t nr_instrumented;
+
+   /// @brief The number of translation units taken from the cache.
+   std::size_t nr_cached;
+
+}; // end struct project_result
+
+/// @brief Instruments all translation units in compile_commands (a compile_commands.json, as
+/// written by CMake with CMAKE_EXPORT_COMPILE_COMMANDS) in parallel and links them with the
+/// scheduler library into <output_dir>/<options.executable_name>.
+/// @details An instrumented translation unit is cached under a hash of its preprocessed source
+/// (so including the headers it includes), its directory and options and the pass module, and
+/// only re-instrumented when one of these changes.
+/// @throws std::runtime_error if a translation unit cannot be preprocessed, or listing the
+/// translation units that failed to instrument.
+
+project_result instrument_project(const boost::filesystem::path& compile_commands,
+                                  const boost::filesystem::path& output_dir,
+                                  const project_options& options = project_options());
 #endif
 
 void write_settings(const SchedulerSettings&);
@@ -1,44 +1,51 @@
 
 #include "scheduler.hpp"
 
+#include "checkpoint.hpp"
+#include "trace.hpp"
+
+#include <compressed_stream.hpp>
 #include <execution_io.hpp>
 #include <visible_instruction_io.hpp>
 
 #include <container_io.hpp>
-#include <debug.hpp>
 #include <error.hpp>
 #include <utils_io.hpp>
 
+#include <boost/filesystem/operations.hpp>
 #include <boost/range/algorithm/find_if.hpp>
 
+#include <chrono>
+#include <cstdlib>
 #include <exception>
-#include <iomanip>
 
 
 namespace scheduler {
 
 //--------------------------------------------------------------------------------------------------
 
+class unregistered_thread : public std::exception
+{
+};
+
+//--------------------------------------------------------------------------------------------------
+
 namespace {
-std::string pid_to_string(const pthread_t& pid)
+
+void copy_trace(const boost::filesystem::path& from, const boost::filesystem::path& to)
 {
-   std::stringstream stream("0x");
-   stream << std::setfill('0') << std::setw(2);
-   unsigned char* pidc = (unsigned char*)(void*)(&pid);
-   for (size_t i = 0; i < sizeof(pid); ++i)
+   boost::system::error_code error;
+   boost::filesystem::create_directories(to.parent_path(), error);
+   boost::filesystem::copy_file(from, to, boost::filesystem::copy_option::overwrite_if_exists,
+                                error);
+   if (error)
    {
-      stream << (unsigned)(pidc[i]);
+      ERROR("Scheduler::take_checkpoint",
+            "copying " + from.string() + " to " + to.string() + ": " + error.message());
    }
-   return stream.str();
 }
-} // end namespace
 
-
-//--------------------------------------------------------------------------------------------------
-
-class unregistered_thread : public std::exception
-{
-};
+} // end namespace
 
 //--------------------------------------------------------------------------------------------------
 
@@ -51,13 +58,29 @@ Scheduler::Scheduler()
 , mRegMutex()
 , mRegCond()
 , mStatus(Execution::Status::RUNNING)
-, mStatusMutex()
 , mSettings(SchedulerSettings::read_from_file("schedules/settings.txt"))
-, mSelector(selector_factory(mSettings.strategy_tag()))
+, mCheckpointPending(static_cast<bool>(mSettings.checkpoint()))
+, mSelector(selector_factory(mSettings))
+, mStats()
 , mThread([this] { return run(); })
 {
-   DEBUG_SYNC("Starting Scheduler\n");
-   DEBUG_SYNC("schedule:\t" << mLocVars->schedule() << "\n");
+   if (mSettings.trace_level() > 0)
+   {
+      boost::filesystem::create_directories(mSettings.output_dir());
+      trace::open(mSettings.output_dir() / "trace_events.bin", mSettings.trace_level());
+   }
+   if (!mSettings.site_filter().empty())
+   {
+      try
+      {
+         set_site_filter(site_filter::read_from_file(mSettings.site_filter()));
+      }
+      catch (const std::invalid_argument& e)
+      {
+         ERROR("Scheduler", e.what());
+      }
+   }
+   RECORD_REPLAY_TRACE(start, mLocVars->schedule().size(), 0);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -72,13 +95,12 @@ void Scheduler::register_main_thread()
 Thread::tid_t Scheduler::register_thread(const pthread_t& pid,
                                          boost::optional<program_model::Thread::tid_t> tid)
 {
-   DEBUGF_SYNC(thread_str(pid), "register_thread", "", "\n");
    std::lock_guard<std::mutex> lock(mRegMutex);
    if (!tid)
    {
       tid = get_fresh_tid(lock);
    }
-   mThreads.insert(TidMap::value_type(pid, *tid));
+   add_thread_handle(pid, *tid, lock);
    mControllableThreads.emplace(std::piecewise_construct, std::forward_as_tuple(*tid),
                                 std::forward_as_tuple(*tid, pid, mThread.get_id()));
    mPool.register_thread(*tid);
@@ -86,23 +108,22 @@ Thread::tid_t Scheduler::register_thread(const pthread_t& pid,
    if (tid == 0)
       mMainThreadRegistered.store(true);
 
-   DEBUGF_SYNC(thread_str(*tid), "register_thread", "pid=" << pid_to_string(pid), "\n");
+   RECORD_REPLAY_TRACE(register_thread, *tid, pid);
    mRegCond.notify_all();
    return *tid;
 }
 
 //--------------------------------------------------------------------------------------------------
 
-program_model::Thread::tid_t Scheduler::post_spawn_instruction(pthread_t* pid,
-                                                               const std::string& file_name,
-                                                               unsigned int line_number)
+program_model::Thread::tid_t Scheduler::post_spawn_instruction(
+   pthread_t* pid, const program_model::meta_data_t& meta_data)
 {
    const auto new_tid = get_fresh_tid(std::lock_guard<std::mutex>(mRegMutex));
 
-   post_task([new_tid, &file_name, line_number](const auto tid) {
+   post_task([new_tid, &meta_data](const auto tid) {
       return program_model::thread_management_instruction(tid, thread_management_operation::Spawn,
                                                           program_model::Thread(new_tid),
-                                                          {file_name, line_number});
+                                                          meta_data);
    });
 
    // The thread about to be spawn cannot be registered yet, because pid only holds useful
@@ -112,64 +133,78 @@ program_model::Thread::tid_t Scheduler::post_spawn_instruction(pthread_t* pid,
 
 //--------------------------------------------------------------------------------------------------
 
-void Scheduler::post_join_instruction(pthread_t pid, const std::string& file_name,
-                                      unsigned int line_number)
+void Scheduler::post_join_instruction(pthread_t pid, const program_model::meta_data_t& meta_data)
 {
    try
    {
       const auto tid_joined = find_tid(pid);
-      post_task([tid_joined, &file_name, line_number](const auto tid) {
+      post_task([tid_joined, &meta_data](const auto tid) {
          return program_model::thread_management_instruction(tid, thread_management_operation::Join,
                                                              program_model::Thread(tid_joined),
-                                                             {file_name, line_number});
+                                                             meta_data);
       });
    }
    catch (const unregistered_thread&)
    {
-      DEBUGF_SYNC("", "post_join_thread", "unregistered thread " << pid_to_string(pid), "\n");
+      RECORD_REPLAY_TRACE(join_unregistered, pid, 0);
    }
 }
 
 //--------------------------------------------------------------------------------------------------
 
 void Scheduler::post_memory_instruction(const int op, const Object& obj, bool is_atomic,
-                                        const std::string& file_name, unsigned int line_number)
+                                        const program_model::meta_data_t& meta_data)
 {
-   post_task([op, &obj, is_atomic, &file_name, line_number](const auto tid) {
+   post_task([op, &obj, is_atomic, &meta_data](const auto tid) {
       return program_model::memory_instruction(tid, static_cast<memory_operation>(op), obj,
-                                               is_atomic, {file_name, line_number});
+                                               is_atomic, meta_data);
    });
 }
 
 //--------------------------------------------------------------------------------------------------
 
-void Scheduler::post_lock_instruction(const int op, const Object& obj, const std::string& file_name,
-                                      unsigned int line_number)
+void Scheduler::post_lock_instruction(const int op, const Object& obj,
+                                      const program_model::meta_data_t& meta_data)
 {
-   post_task([op, &obj, &file_name, line_number](const auto tid) {
+   post_task([op, &obj, &meta_data](const auto tid) {
       return program_model::lock_instruction(tid, static_cast<lock_operation>(op), obj,
-                                             {file_name, line_number});
+                                             meta_data);
    });
 }
 
 //--------------------------------------------------------------------------------------------------
 
-void Scheduler::enter_function(const std::string& function_name)
+int Scheduler::post_cond_wait_instruction(pthread_cond_t* cond, pthread_mutex_t* mutex,
+                                          const program_model::meta_data_t& meta_data)
 {
-   DEBUGF_SYNC(thread_str(pthread_self()), "enter_function", function_name, "\n");
+   if (!mMainThreadRegistered.load() || !runs_controlled())
+   {
+      return pthread_cond_wait(cond, mutex);
+   }
+   post_lock_instruction(static_cast<int>(lock_operation::Unlock), Object(mutex), meta_data);
+   pthread_mutex_unlock(mutex);
+   // Requested before any other thread is scheduled, so that no signal is lost
+   post_lock_instruction(static_cast<int>(lock_operation::CondWait), Object(cond), meta_data);
+   post_lock_instruction(static_cast<int>(lock_operation::Lock), Object(mutex), meta_data);
+   return pthread_mutex_lock(mutex);
+}
 
-   const auto tid = wait_until_registered();
-   get_controllable_thread(tid).enter_function(function_name);
+//--------------------------------------------------------------------------------------------------
+
+void Scheduler::enter_function(const std::string& function_name)
+{
+   current_thread().thread->enter_function(function_name);
 }
 
 //--------------------------------------------------------------------------------------------------
 
 void Scheduler::exit_function(const std::string& function_name)
 {
-   const auto tid = wait_until_registered();
+   const auto registration = current_thread();
+   const auto tid = registration.tid;
    try
    {
-      get_controllable_thread(tid).exit_function(function_name);
+      registration.thread->exit_function(function_name);
    }
    catch (const controllable_thread::finished&)
    {
@@ -177,7 +212,7 @@ void Scheduler::exit_function(const std::string& function_name)
       {
          mPool.yield(tid);
 
-         DEBUGF_SYNC(thread_str(tid), "finish", "", "\n");
+         RECORD_REPLAY_TRACE(finish_thread, tid, 0);
          mPool.finish(tid);
       }
 
@@ -186,6 +221,12 @@ void Scheduler::exit_function(const std::string& function_name)
       {
          join();
       }
+      // A re-created thread cannot return into the frames of the original thread's start
+      else if (registration.thread->restored())
+      {
+         trace::exit_thread();
+         exit_restored_thread();
+      }
    }
 }
 
@@ -196,11 +237,7 @@ void Scheduler::join()
    if (mThread.joinable())
    {
       mThread.join();
-      DEBUG_SYNC("mTread.joined\n");
-   }
-   else
-   {
-      DEBUG_SYNC("!mThread.joinable()\n");
+      RECORD_REPLAY_TRACE(joined_scheduler, 0, 0);
    }
 }
 
@@ -217,36 +254,81 @@ Thread::tid_t Scheduler::get_fresh_tid(const std::lock_guard<std::mutex>& regist
 
 //--------------------------------------------------------------------------------------------------
 
+/// @details glibc reuses the pthread_t of a thread once it is joined. The pthread_t of an
+/// unfinished thread is only handed out again in a branch of a checkpoint, when glibc gives a new
+/// thread the cached stack, and with it the descriptor, of a thread that vanished in the fork and
+/// that a re-created thread continues on (see checkpoint). The latter's stack is then corrupt.
+
+void Scheduler::add_thread_handle(const pthread_t& pid, const Thread::tid_t tid,
+                                  const std::lock_guard<std::mutex>& registration_lock)
+{
+   const auto registered = mThreads.find(pid);
+   if (registered != mThreads.end())
+   {
+      if (mPool.status_protected(registered->second) != Thread::Status::FINISHED)
+      {
+         ERROR("Scheduler::add_thread_handle",
+               "thread " + std::to_string(tid) + " has the pthread_t of unfinished thread " +
+                  std::to_string(registered->second));
+         std::abort();
+      }
+      mThreads.erase(registered);
+   }
+   mThreads.insert(TidMap::value_type(pid, tid));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+template <typename create_instruction_t>
 void Scheduler::post_task(const create_instruction_t& create_instruction)
 {
    if (!mMainThreadRegistered.load())
    {
-      DEBUGF_SYNC("unregistered thread", "post_task", "", "\n");
+      RECORD_REPLAY_TRACE(post_task_unregistered, 0, 0);
       return;
    }
 
-   const auto tid = wait_until_registered();
-   auto instruction = create_instruction(tid);
-   DEBUGF_SYNC(thread_str(tid), "post_task",
-               boost::apply_visitor(program_model::instruction_to_short_string(), instruction),
-               "\n");
+   const auto registration = current_thread();
+   const auto tid = registration.tid;
+   const program_model::visible_instruction_t instruction = create_instruction(tid);
+   RECORD_REPLAY_TRACE(post_task, tid, trace::operation(instruction));
    if (runs_controlled())
    {
       mPool.yield(tid);
       mPool.post(tid, instruction);
-      get_controllable_thread(tid).post_task();
+      const auto save_context = mCheckpointPending.load(std::memory_order_relaxed);
+      if (const auto latency = registration.thread->post_task(save_context))
+         mStats.handoff_latency.record(latency->count());
+   }
+   else
+   {
+      // The status does not return to RUNNING, so the thread can stop posting for good
+      wrapper_thread_uncontrolled = 1;
    }
 }
 
 //--------------------------------------------------------------------------------------------------
 
+auto Scheduler::current_thread() -> registration_t
+{
+   thread_local registration_t registration{nullptr, 0, nullptr};
+   if (registration.scheduler != this)
+   {
+      const auto tid = wait_until_registered();
+      registration = registration_t{this, tid, &get_controllable_thread(tid)};
+   }
+   return registration;
+}
+
+//--------------------------------------------------------------------------------------------------
+
 program_model::Thread::tid_t Scheduler::wait_until_registered()
 {
    const auto pid = pthread_self();
    Thread::tid_t tid;
    std::unique_lock<std::mutex> lock(mRegMutex);
    mRegCond.wait(lock, [this, &pid, &tid]() {
-      DEBUGF_SYNC(thread_str(pid), "wait_until_registered", "", "\n");
+      RECORD_REPLAY_TRACE(wait_until_registered, pid, 0);
       const auto it = mThreads.find(pid);
       if (it != mThreads.end())
       {
@@ -292,34 +374,14 @@ bool Scheduler::runs_controlled()
 
 Execution::Status Scheduler::status()
 {
-   std::lock_guard<std::mutex> guard(mStatusMutex);
-   return mStatus;
+   return mStatus.load();
 }
 
 //--------------------------------------------------------------------------------------------------
 
 void Scheduler::set_status(const Execution::Status& s)
 {
-   std::lock_guard<std::mutex> guard(mStatusMutex);
-   mStatus = s;
-}
-
-//--------------------------------------------------------------------------------------------------
-
-std::string Scheduler::thread_str(const Thread::tid_t& tid)
-{
-   std::stringstream ss("");
-   ss << "[thread" << tid << "]\t\t";
-   return ss.str();
-}
-
-//--------------------------------------------------------------------------------------------------
-
-std::string Scheduler::thread_str(const pthread_t& pid)
-{
-   std::stringstream ss("");
-   ss << "[thread" << pid << "]\t\t";
-   return ss.str();
+   mStatus.store(s);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -331,19 +393,31 @@ std::string Scheduler::thread_str(const pthread_t& pid)
 // on mPool, but this is not checked/enforced.
 void Scheduler::run()
 {
+   const auto wait_until_unfinished_threads_have_posted = [this] {
+      const auto start = std::chrono::steady_clock::now();
+      mPool.wait_until_unfinished_threads_have_posted();
+      mStats.record_wait(std::chrono::steady_clock::now() - start);
+   };
+
    wait_until_main_thread_registered();
-   mPool.wait_until_unfinished_threads_have_posted();
-   DEBUG_SYNC(mPool << "\n");
+   wait_until_unfinished_threads_have_posted();
 
    Execution E(mPool.program_state());
 
    while (status() == Execution::Status::RUNNING)
    {
-      DEBUG_SYNC("---------- [round" << mLocVars->task_nr() << "]\n");
+      RECORD_REPLAY_TRACE(round, mLocVars->task_nr(), 0);
+      ++mStats.rounds;
+      // Before the state is recorded, so that it shows the Awaits woken anyway as enabled
+      mPool.wake_stale_awaits();
       if (mLocVars->task_nr() > 0)
       {
          E.push_back(*mPool.current_task(), mPool.program_state());
       }
+      if (mSettings.checkpoint() && *mSettings.checkpoint() == unsigned(mLocVars->task_nr()))
+      {
+         take_checkpoint();
+      }
       try
       {
          auto selection = mSelector->select(mPool, mLocVars->schedule(), mLocVars->task_nr());
@@ -361,12 +435,12 @@ void Scheduler::run()
             set_status(selection.first);
             break;
          }
-         mPool.wait_until_unfinished_threads_have_posted();
-         DEBUG_SYNC(mPool << "\n");
+         wait_until_unfinished_threads_have_posted();
       }
       catch (const deadlock_exception& deadlock)
       {
          write_to_stream(std::cout, deadlock.get());
+         mLocVars->mark_step();
          E.push_back(mPool.tasks_cbegin()->second, mPool.program_state());
          set_status(Execution::Status::DEADLOCK);
          break;
@@ -388,13 +462,75 @@ void Scheduler::wait_until_main_thread_registered()
 {
    std::unique_lock<std::mutex> lock(mRegMutex);
    mRegCond.wait(lock, [this]() {
-      DEBUGF_SYNC("Scheduler", "wait_until_main_thread_registered", "", "\n");
+      RECORD_REPLAY_TRACE(wait_until_main_thread_registered, 0, 0);
       return mMainThreadRegistered.load();
    });
 }
 
 //--------------------------------------------------------------------------------------------------
 
+/// @note All unfinished threads have posted their task, but may not yet be waiting for their
+/// turn. The checkpoint has to be taken when none of them is executing.
+
+void Scheduler::take_checkpoint()
+{
+   Tids unfinished;
+   {
+      std::lock_guard<std::mutex> lock(mRegMutex);
+      for (const auto& entry : mControllableThreads)
+      {
+         if (mPool.status_protected(entry.first) != Thread::Status::FINISHED)
+            unfinished.insert(entry.first);
+      }
+   }
+   for (const auto tid : unfinished)
+   {
+      while (!get_controllable_thread(tid).parked())
+         std::this_thread::yield();
+   }
+
+   RECORD_REPLAY_TRACE(take_checkpoint, mLocVars->task_nr(), 0);
+   // Buffered records would otherwise be written by both processes. The trace so far is kept
+   // with the checkpoint, as the original process goes on writing the trace file.
+   trace::flush();
+   const boost::filesystem::path directory = "schedules/checkpoint";
+   const auto trace_file = mSettings.output_dir() / "trace_events.bin";
+   const auto trace_prefix = directory / "trace_events.bin";
+   if (mSettings.trace_level() > 0)
+      copy_trace(trace_file, trace_prefix);
+   const bool branch = checkpoint(directory).take();
+   mCheckpointPending.store(false, std::memory_order_relaxed);
+   if (branch)
+   {
+      if (mSettings.trace_level() > 0)
+      {
+         copy_trace(trace_prefix, trace_file);
+         trace::open(trace_file, mSettings.trace_level(), true);
+      }
+      restore_threads();
+      mLocVars->read_schedule();
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void Scheduler::restore_threads()
+{
+   std::lock_guard<std::mutex> lock(mRegMutex);
+   for (auto& entry : mControllableThreads)
+   {
+      if (entry.second.parked())
+      {
+         const pthread_t pid = entry.second.restore();
+         // The original pid remains registered, as the program refers to it in joins
+         add_thread_handle(pid, entry.first, lock);
+         RECORD_REPLAY_TRACE(restore_thread, entry.first, pid);
+      }
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
 /// Sets tid as the current thread in TaskPool, removing and obtaining the current
 /// posted task by Thread tid from the TaskPool. Removing the task is to guarantee that
 /// the Scheduler thread blocks on mPool.all_enabled_collected, because the thread only
@@ -406,10 +542,8 @@ bool Scheduler::schedule_thread(const Thread::tid_t& tid)
    if (mPool.status_protected(tid) == Thread::Status::ENABLED)
    {
       const program_model::visible_instruction_t task = mPool.set_current(tid);
-      DEBUGF_SYNC(
-         "Scheduler", "schedule_thread", tid,
-         "next task = " << boost::apply_visitor(program_model::instruction_to_short_string(), task)
-                        << "\n");
+      RECORD_REPLAY_TRACE(schedule_thread, tid, trace::operation(task));
+      mLocVars->mark_step();
       get_controllable_thread(tid).grant_execution_right();
       mLocVars->increase_task_nr();
       return true;
@@ -432,7 +566,8 @@ void Scheduler::report_error(const std::string& what)
 
 void Scheduler::close(Execution& E)
 {
-   DEBUGF_SYNC("Scheduler", "close", "", to_string(status()) << "\n");
+   RECORD_REPLAY_TRACE(close, status(), 0);
+   mLocVars->mark_step();
    if (!runs_controlled())
    {
       std::lock_guard<std::mutex> lock(mRegMutex);
@@ -449,8 +584,13 @@ void Scheduler::close(Execution& E)
       ERROR("Scheduler::close", e.what());
    }
    E.set_status(status());
+   boost::filesystem::create_directories(mSettings.output_dir());
    dump_execution(E);
+   dump_settings();
    dump_data_races();
+   dump_stats();
+   dump_sites();
+   trace::flush();
 
    if (status() == Execution::Status::DEADLOCK)
       std::terminate();
@@ -458,20 +598,60 @@ void Scheduler::close(Execution& E)
 
 //--------------------------------------------------------------------------------------------------
 
-void Scheduler::dump_execution(const Execution& E) const
+void Scheduler::dump_execution(const Execution& E)
 {
-   if (!E.empty())
+   if (E.empty() || mSettings.trace_format() == trace_format_t::None)
+   {
+      return;
+   }
+   const bool binary = mSettings.trace_format() == trace_format_t::Binary;
+   const bool compressed = mSettings.trace_codec() == trace_codec_t::LZ4;
+   const auto write = [&E, binary](std::ostream& os) {
+      if (binary)
+         write_binary(os, E);
+      else
+         os << E;
+   };
+   std::ofstream record((mSettings.output_dir() / (binary ? "record.bin" : "record.txt")).string() +
+                           (compressed ? ".lz4" : ""),
+                        std::ios::binary);
+   if (compressed)
+   {
+      compressed_ostream compressed_record(record);
+      write(compressed_record);
+   }
+   else
    {
-      std::ofstream record;
-      record.open("record.txt");
-      record << E;
-      record.close();
+      write(record);
+   }
+   mStats.trace_bytes = record.tellp();
 
+   if (!binary)
+   {
       std::ofstream record_short;
-      record_short.open("record_short.txt");
+      record_short.open((mSettings.output_dir() / "record_short.txt").string());
       record_short << to_short_string(E);
       record_short.close();
    }
+
+   std::ofstream record_times((mSettings.output_dir() / "record_times.txt").string());
+   for (const auto time : mLocVars->step_times())
+   {
+      record_times << time << "\n";
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @note The recorded settings include the seed, so that copying them to schedules/settings.txt
+/// reproduces the run.
+
+void Scheduler::dump_settings() const
+{
+   std::ofstream settings;
+   settings.open((mSettings.output_dir() / "record_settings.txt").string());
+   settings << mSettings;
+   settings.close();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -479,7 +659,7 @@ void Scheduler::dump_execution(const Execution& E) const
 void Scheduler::dump_data_races() const
 {
    std::ofstream ofs;
-   ofs.open("data_races.txt", std::ofstream::app);
+   ofs.open((mSettings.output_dir() / "data_races.txt").string(), std::ofstream::app);
    for (const auto& data_race : mPool.data_races())
    {
       write_to_stream(ofs, data_race);
@@ -490,15 +670,53 @@ void Scheduler::dump_data_races() const
 
 //--------------------------------------------------------------------------------------------------
 
+void Scheduler::dump_stats() const
+{
+   std::ofstream stats;
+   stats.open((mSettings.output_dir() / "stats.json").string());
+   stats << "{\n"
+         << "   \"rounds\": " << mStats.rounds << ",\n"
+         << "   \"wait_time_ns\": " << mStats.wait_time.count() << ",\n"
+         << "   \"max_wait_time_ns\": " << mStats.max_wait_time.count() << ",\n"
+         << "   \"round_wait_time_ns\": " << mStats.round_wait_time << ",\n"
+         << "   \"handoff_latency_ns\": " << mStats.handoff_latency << ",\n"
+         << "   \"task_pool_mutex\": " << mPool.mutex_stats() << ",\n"
+         << "   \"objects_mutex\": " << mPool.objects_mutex_stats() << ",\n"
+         << "   \"nr_objects\": " << mPool.nr_objects() << ",\n"
+         << "   \"trace_bytes\": " << mStats.trace_bytes << "\n"
+         << "}\n";
+   stats.close();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void Scheduler::dump_sites() const
+{
+   std::ofstream sites((mSettings.output_dir() / "sites.txt").string());
+   write_sites(sites);
+}
+
+//--------------------------------------------------------------------------------------------------
+
 // Class Scheduler::LocalVars
 
 Scheduler::LocalVars::LocalVars()
 : mSchedule()
 , mTaskNr(0)
+, mStart(std::chrono::steady_clock::now())
+, mStepTimes()
 {
+   read_schedule();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void Scheduler::LocalVars::read_schedule()
+{
+   mSchedule = {};
    if (!utils::io::read_from_file("schedules/schedule.txt", mSchedule))
    {
-      ERROR("Scheduler::LocalVars()", "reading schedules/schedule.txt");
+      ERROR("Scheduler::LocalVars::read_schedule", "reading schedules/schedule.txt");
       mSchedule = {};
    }
 }
@@ -526,10 +744,43 @@ void Scheduler::LocalVars::increase_task_nr()
 
 //--------------------------------------------------------------------------------------------------
 
+void Scheduler::LocalVars::mark_step()
+{
+   mStepTimes.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now() - mStart)
+                           .count());
+}
+
+//--------------------------------------------------------------------------------------------------
+
+const std::vector<uint64_t>& Scheduler::LocalVars::step_times() const
+{
+   return mStepTimes;
+}
+
+//--------------------------------------------------------------------------------------------------
+
 } // end namespace scheduler
 
 //--------------------------------------------------------------------------------------------------
 
+namespace {
+
+/// @brief The file names passed by the instrumentation are global string constants, so they can
+/// be interned by address without allocating.
+
+program_model::meta_data_t meta_data(const char* file_name, unsigned int line_number)
+{
+   return {program_model::interned_string::from_static(file_name), line_number};
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+
+thread_local uint8_t wrapper_thread_uncontrolled = 0;
+
+//--------------------------------------------------------------------------------------------------
 
 void wrapper_register_main_thread()
 {
@@ -547,7 +798,7 @@ void wrapper_register_thread(const pthread_t* const pid, const int tid)
 
 int wrapper_post_spawn_instruction(pthread_t* pid, const char* file_name, unsigned int line_number)
 {
-   return the_scheduler.post_spawn_instruction(pid, file_name, line_number);
+   return the_scheduler.post_spawn_instruction(pid, meta_data(file_name, line_number));
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -555,7 +806,7 @@ int wrapper_post_spawn_instruction(pthread_t* pid, const char* file_name, unsign
 void wrapper_post_pthread_join_instruction(pthread_t pid, const char* file_name,
                                            unsigned int line_number)
 {
-   return the_scheduler.post_join_instruction(pid, file_name, line_number);
+   return the_scheduler.post_join_instruction(pid, meta_data(file_name, line_number));
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -563,25 +814,50 @@ void wrapper_post_pthread_join_instruction(pthread_t pid, const char* file_name,
 void wrapper_post_stdthread_join_instruction(std::thread* thr, const char* file_name,
                                              unsigned int line_number)
 {
-   return the_scheduler.post_join_instruction(thr->native_handle(), file_name, line_number);
+   return the_scheduler.post_join_instruction(thr->native_handle(),
+                                              meta_data(file_name, line_number));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void wrapper_post_memory_instruction(void* operand, const scheduler::instrumentation_site* site)
+{
+   the_scheduler.post_memory_instruction(site->operation, program_model::Object(operand),
+                                         site->is_atomic != 0,
+                                         meta_data(site->file_name, site->line_number));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void wrapper_post_lock_instruction(void* operand, const scheduler::instrumentation_site* site)
+{
+   the_scheduler.post_lock_instruction(site->operation, program_model::Object(operand),
+                                       meta_data(site->file_name, site->line_number));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int wrapper_pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex, const char* file_name,
+                              unsigned int line_number)
+{
+   return the_scheduler.post_cond_wait_instruction(cond, mutex, meta_data(file_name, line_number));
 }
 
 //--------------------------------------------------------------------------------------------------
 
-void wrapper_post_memory_instruction(int operation, void* operand, bool is_atomic,
-                                     const char* file_name, unsigned int line_number)
+void wrapper_stdcondvar_wait(std::condition_variable* cond, std::unique_lock<std::mutex>* lock,
+                             const char* file_name, unsigned int line_number)
 {
-   the_scheduler.post_memory_instruction(operation, program_model::Object(operand), is_atomic,
-                                         file_name, line_number);
+   the_scheduler.post_cond_wait_instruction(cond->native_handle(), lock->mutex()->native_handle(),
+                                            meta_data(file_name, line_number));
 }
 
 //--------------------------------------------------------------------------------------------------
 
-void wrapper_post_lock_instruction(int operation, void* operand, const char* file_name,
-                                   unsigned int line_number)
+void wrapper_register_sites(const scheduler::instrumentation_site* sites, uint8_t* enabled,
+                            const uint32_t size)
 {
-   the_scheduler.post_lock_instruction(operation, program_model::Object(operand), file_name,
-                                       line_number);
+   scheduler::register_site_table({sites, enabled, size});
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -1,16 +1,22 @@
 #pragma once
 
 #include "controllable_thread.hpp"
+#include "instrumentation_sites.hpp"
 #include "schedule.hpp"
 #include "scheduler_settings.hpp"
+#include "scheduler_stats.hpp"
 #include "selector_register.hpp"
 
 #include <execution.hpp>
 
 #include <boost/optional.hpp>
 
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 //--------------------------------------------------------------------------------------------------
 /// @file scheduler.hpp
@@ -52,17 +58,29 @@ public:
    /// created thread with the Scheduler. Called by the spawning thread.
    /// @returns The return value of the pthread_create call.
 
-   Thread::tid_t post_spawn_instruction(pthread_t* pid, const std::string& file_name,
-                                        unsigned int line_number);
+   Thread::tid_t post_spawn_instruction(pthread_t* pid,
+                                        const program_model::meta_data_t& meta_data);
 
-   void post_join_instruction(pthread_t pid, const std::string& file_name,
-                              unsigned int line_number);
+   void post_join_instruction(pthread_t pid, const program_model::meta_data_t& meta_data);
+
+   /// @note Posting does not allocate, provided meta_data.file_name was interned before (see
+   /// interned_string::from_static) and the posted operand was operated on before.
 
    void post_memory_instruction(const int op, const Object& obj, bool is_atomic,
-                                const std::string& file_name, unsigned int line_number);
+                                const program_model::meta_data_t& meta_data);
 
-   void post_lock_instruction(const int op, const Object& obj, const std::string& file_name,
-                              unsigned int line_number);
+   void post_lock_instruction(const int op, const Object& obj,
+                              const program_model::meta_data_t& meta_data);
+
+   /// @brief Replaces pthread_cond_wait(cond, mutex) by an Unlock of mutex, a CondWait on cond
+   /// and a Lock of mutex. The waiting thread is DISABLED until a CondSignal or CondBroadcast
+   /// wakes it, rather than blocking in pthread_cond_wait while the Scheduler waits for its next
+   /// instruction. As nothing waits in pthread_cond_wait, the program's own signals are no-ops.
+   /// @returns The return value of pthread_mutex_lock, or of pthread_cond_wait if the Scheduler
+   /// does not control the execution.
+
+   int post_cond_wait_instruction(pthread_cond_t* cond, pthread_mutex_t* mutex,
+                                  const program_model::meta_data_t& meta_data);
 
    void enter_function(const std::string& function_name);
 
@@ -93,25 +111,57 @@ private:
    std::atomic<bool> mMainThreadRegistered;
    std::condition_variable mRegCond;
 
-   Execution::Status mStatus;
-   std::mutex mStatusMutex;
+   std::atomic<Execution::Status> mStatus;
 
    SchedulerSettings mSettings;
+   /// @brief Whether a checkpoint is configured and not yet taken, in which case the threads
+   /// save their context whenever they are parked.
+   std::atomic<bool> mCheckpointPending;
    SelectorUniquePtr mSelector;
 
+   scheduler_stats mStats;
+
    std::thread mThread;
 
    // SCHEDULER INTERNAL
 
    Thread::tid_t get_fresh_tid(const std::lock_guard<std::mutex>& registration_lock);
 
-   using create_instruction_t =
-      std::function<program_model::visible_instruction_t(program_model::Thread::tid_t)>;
+   /// @brief Associates pid with tid in mThreads, replacing the entry of a finished thread with
+   /// the same pid. Aborts if pid is that of an unfinished thread.
+
+   void add_thread_handle(const pthread_t& pid, Thread::tid_t tid,
+                          const std::lock_guard<std::mutex>& registration_lock);
+
+   /// @brief Posts the instruction create_instruction(tid) of the calling thread tid and waits
+   /// for its turn.
+   /// @details create_instruction is a template parameter rather than a std::function, which
+   /// might allocate to hold the captures.
 
-   void post_task(const create_instruction_t&);
+   template <typename create_instruction_t>
+   void post_task(const create_instruction_t& create_instruction);
 
    program_model::Thread::tid_t wait_until_registered();
 
+   /// @brief The registration of a program thread. thread points into mControllableThreads, whose
+   /// elements are never erased.
+
+   struct registration_t
+   {
+      const Scheduler* scheduler;
+      Thread::tid_t tid;
+      controllable_thread* thread;
+   };
+
+   /// @brief Returns the registration of the calling thread. Only the first call of a thread
+   /// waits until it is registered (by its spawning thread) and takes mRegMutex, later calls
+   /// return the registration it cached in a thread_local.
+   /// @note The registration is returned by value, as a thread re-created by
+   /// controllable_thread::restore continues on a copy of the stack of the original thread, but
+   /// not with its thread_local storage.
+
+   registration_t current_thread();
+
    Thread::tid_t find_tid(const pthread_t& pid);
 
    controllable_thread& get_controllable_thread(const program_model::Thread::tid_t tid);
@@ -122,9 +172,6 @@ private:
 
    void set_status(const Execution::Status&);
 
-   std::string thread_str(const Thread::tid_t&);
-   std::string thread_str(const pthread_t&);
-
    // THREAD
 
    /// @brief Start routine of mThread.
@@ -135,6 +182,15 @@ private:
 
    void wait_until_main_thread_registered();
 
+   /// @brief Forks a checkpoint of the program (see class checkpoint). In a branch process
+   /// forked from the checkpoint, re-creates the parked threads and reloads the schedule.
+
+   void take_checkpoint();
+
+   /// @brief Re-creates all unfinished threads and associates them with the new pthread ids.
+
+   void restore_threads();
+
    /// @brief Schedule the next task of given tid.
    /// @returns true iff scheduling the thread succeeded (i.e. tid is ENABLED.
 
@@ -144,9 +200,18 @@ private:
 
    void close(Execution& E);
 
-   void dump_execution(const Execution& E) const;
+   void dump_execution(const Execution& E);
+   void dump_settings() const;
    void dump_data_races() const;
 
+   /// @brief Writes mStats and the counters of mPool to stats.json.
+
+   void dump_stats() const;
+
+   /// @brief Writes the instrumented sites and whether they were enabled to sites.txt.
+
+   void dump_sites() const;
+
 }; // end class Scheduler
 
 //--------------------------------------------------------------------------------------------------
@@ -164,12 +229,26 @@ public:
 
    const schedule_t& schedule() const;
 
+   /// @brief (Re)reads mSchedule from schedules/schedule.txt.
+
+   void read_schedule();
+
    /// @brief Getter.
 
    int task_nr() const;
 
    void increase_task_nr();
 
+   /// @brief Records the current time as the start of the next step, or as the end of the
+   /// execution.
+
+   void mark_step();
+
+   /// @brief Getter.
+   /// @details Nanoseconds since the construction of LocalVars, see mark_step.
+
+   const std::vector<uint64_t>& step_times() const;
+
 private:
    /// @brief The schedule under which the scheduler is driving the program.
 
@@ -179,6 +258,9 @@ private:
 
    int mTaskNr;
 
+   std::chrono::steady_clock::time_point mStart;
+   std::vector<uint64_t> mStepTimes;
+
 }; // end class Scheduler::LocalVars
 } // end namespace scheduler
 
@@ -190,6 +272,12 @@ static scheduler::Scheduler the_scheduler;
 
 extern "C" {
 
+/// @brief Set on a thread once its visible instructions no longer have to be posted, because the
+/// Scheduler stopped controlling the execution. The prologue LightWeightPass inlines in front of a
+/// memory or lock instruction then skips the call to the wrapper.
+
+extern thread_local uint8_t wrapper_thread_uncontrolled;
+
 void wrapper_register_main_thread();
 
 void wrapper_register_thread(const pthread_t* const pid, int tid);
@@ -202,11 +290,25 @@ void wrapper_post_pthread_join_instruction(pthread_t, const char* file_name,
 void wrapper_post_stdthread_join_instruction(std::thread*, const char* file_name,
                                              unsigned int line_number);
 
-void wrapper_post_memory_instruction(int operation, void* operand, bool is_atomic,
-                                     const char* file_name, unsigned int line_number);
+void wrapper_post_memory_instruction(void* operand, const scheduler::instrumentation_site* site);
+
+void wrapper_post_lock_instruction(void* operand, const scheduler::instrumentation_site* site);
+
+/// @brief Replaces a call pthread_cond_wait(cond, mutex), see
+/// Scheduler::post_cond_wait_instruction.
+
+int wrapper_pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex, const char* file_name,
+                              unsigned int line_number);
+
+/// @brief Replaces a call cond->wait(*lock).
+
+void wrapper_stdcondvar_wait(std::condition_variable* cond, std::unique_lock<std::mutex>* lock,
+                             const char* file_name, unsigned int line_number);
+
+/// @brief Registers the site table of an instrumented module (see instrumentation_sites.hpp).
 
-void wrapper_post_lock_instruction(int operation, void* operand, const char* file_name,
-                                   unsigned int line_number);
+void wrapper_register_sites(const scheduler::instrumentation_site* sites, uint8_t* enabled,
+                            uint32_t size);
 
 void wrapper_enter_function(const char* function_name);
 
@@ -5,15 +5,102 @@
 #include "error.hpp"
 
 // STL
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
 
 namespace scheduler
 {
    //-------------------------------------------------------------------------------------
    
-   SchedulerSettings::SchedulerSettings(const std::string& strategy_tag)
-   : mStrategyTag(strategy_tag) { }
+   namespace
+   {
+      /// @throws std::invalid_argument if value is not entirely a non-negative number.
+      
+      uint64_t to_number(const std::string& value)
+      {
+         std::size_t end = 0;
+         const bool digits =
+            !value.empty() && std::isdigit(static_cast<unsigned char>(value.front()));
+         const auto number = digits ? std::stoull(value, &end) : 0;
+         if (!digits || end != value.size())
+         {
+            throw std::invalid_argument(value);
+         }
+         return number;
+      }
+      
+      trace_format_t to_trace_format(const std::string& value)
+      {
+         for (const auto format :
+              { trace_format_t::Text, trace_format_t::Binary, trace_format_t::None })
+         {
+            if (to_string(format) == value)
+               return format;
+         }
+         throw std::invalid_argument(value);
+      }
+      
+      trace_codec_t to_trace_codec(const std::string& value)
+      {
+         for (const auto codec : { trace_codec_t::None, trace_codec_t::LZ4 })
+         {
+            if (to_string(codec) == value)
+               return codec;
+         }
+         throw std::invalid_argument(value);
+      }
+   } // end namespace
+   
+   //-------------------------------------------------------------------------------------
+   
+   std::string to_string(const trace_format_t& format)
+   {
+      switch (format)
+      {
+         case trace_format_t::Text:
+            return "text";
+         case trace_format_t::Binary:
+            return "binary";
+         case trace_format_t::None:
+            return "none";
+      }
+      return "undefined";
+   }
+   
+   //-------------------------------------------------------------------------------------
+   
+   std::string to_string(const trace_codec_t& codec)
+   {
+      switch (codec)
+      {
+         case trace_codec_t::None:
+            return "none";
+         case trace_codec_t::LZ4:
+            return "lz4";
+      }
+      return "undefined";
+   }
+   
+   //-------------------------------------------------------------------------------------
+   
+   SchedulerSettings::SchedulerSettings(const std::string& strategy_tag,
+                                        const boost::optional<unsigned int>& checkpoint)
+   : mStrategyTag(strategy_tag)
+   , mCheckpoint(checkpoint)
+   , mSeed(boost::none)
+   , mDepth(3)
+   , mNrSteps(1000)
+   , mOutputDir(".")
+   , mTraceFormat(trace_format_t::Text)
+   , mTraceCodec(trace_codec_t::None)
+   , mTraceLevel(0)
+   , mSiteFilter() { }
    
    //-------------------------------------------------------------------------------------
    
@@ -24,23 +111,280 @@ namespace scheduler
    
    //-------------------------------------------------------------------------------------
    
+   const boost::optional<unsigned int>& SchedulerSettings::checkpoint() const
+   {
+      return mCheckpoint;
+   }
+   
+   //-------------------------------------------------------------------------------------
+   
+   const boost::optional<uint64_t>& SchedulerSettings::seed() const
+   {
+      return mSeed;
+   }
+   
+   //-------------------------------------------------------------------------------------
+   
+   SchedulerSettings& SchedulerSettings::set_seed(uint64_t seed)
+   {
+      mSeed = seed;
+      return *this;
+   }
+   
+   //-------------------------------------------------------------------------------------
+   
+   unsigned int SchedulerSettings::depth() const
+   {
+      return mDepth;
+   }
+   
+   //-------------------------------------------------------------------------------------
+   
+   SchedulerSettings& SchedulerSettings::set_depth(unsigned int depth)
+   {
+      mDepth = depth;
+      return *this;
+   }
+   
+   //-------------------------------------------------------------------------------------
+   
+   unsigned int SchedulerSettings::nr_steps() const
+   {
+      return mNrSteps;
+   }
+   
+   //-------------------------------------------------------------------------------------
+   
+   SchedulerSettings& SchedulerSettings::set_nr_steps(unsigned int nr_steps)
+   {
+      mNrSteps = nr_steps;
+      return *this;
+   }
+   
+   //-------------------------------------------------------------------------------------
+   
+   const boost::filesystem::path& SchedulerSettings::output_dir() const
+   {
+      return mOutputDir;
+   }
+   
+   //-------------------------------------------------------------------------------------
+   
+   SchedulerSettings& SchedulerSettings::set_output_dir(const boost::filesystem::path& output_dir)
+   {
+      mOutputDir = output_dir;
+      return *this;
+   }
+   
+   //-------------------------------------------------------------------------------------
+   
+   trace_format_t SchedulerSettings::trace_format() const
+   {
+      return mTraceFormat;
+   }
+   
+   //-------------------------------------------------------------------------------------
+   
+   SchedulerSettings& SchedulerSettings::set_trace_format(trace_format_t format)
+   {
+      mTraceFormat = format;
+      return *this;
+   }
+   
+   //-------------------------------------------------------------------------------------
+   
+   trace_codec_t SchedulerSettings::trace_codec() const
+   {
+      return mTraceCodec;
+   }
+   
+   //-------------------------------------------------------------------------------------
+   
+   SchedulerSettings& SchedulerSettings::set_trace_codec(trace_codec_t codec)
+   {
+      mTraceCodec = codec;
+      return *this;
+   }
+   
+   //-------------------------------------------------------------------------------------
+   
+   unsigned int SchedulerSettings::trace_level() const
+   {
+      return mTraceLevel;
+   }
+   
+   //-------------------------------------------------------------------------------------
+   
+   SchedulerSettings& SchedulerSettings::set_trace_level(unsigned int level)
+   {
+      mTraceLevel = level;
+      return *this;
+   }
+   
+   //-------------------------------------------------------------------------------------
+   
+   const boost::filesystem::path& SchedulerSettings::site_filter() const
+   {
+      return mSiteFilter;
+   }
+   
+   //-------------------------------------------------------------------------------------
+   
+   SchedulerSettings& SchedulerSettings::set_site_filter(
+      const boost::filesystem::path& site_filter)
+   {
+      mSiteFilter = site_filter;
+      return *this;
+   }
+   
+   //-------------------------------------------------------------------------------------
+   
+   void SchedulerSettings::set(const std::string& key, const std::string& value)
+   {
+      if (std::find(keys().begin(), keys().end(), key) == keys().end())
+      {
+         throw std::invalid_argument("unknown setting " + key);
+      }
+      try
+      {
+         if (key == "strategy")
+            mStrategyTag = value;
+         else if (key == "checkpoint")
+            mCheckpoint = to_number(value);
+         else if (key == "seed")
+            set_seed(to_number(value));
+         else if (key == "depth")
+            set_depth(to_number(value));
+         else if (key == "nr_steps")
+            set_nr_steps(to_number(value));
+         else if (key == "output_dir")
+            set_output_dir(value);
+         else if (key == "trace_format")
+            set_trace_format(to_trace_format(value));
+         else if (key == "trace_codec")
+            set_trace_codec(to_trace_codec(value));
+         else if (key == "trace_level")
+            set_trace_level(to_number(value));
+         else if (key == "site_filter")
+            set_site_filter(value);
+      }
+      catch (const std::logic_error&)
+      {
+         throw std::invalid_argument("invalid value " + key + "=" + value);
+      }
+   }
+   
+   //-------------------------------------------------------------------------------------
+   
+   const std::vector<std::string>& SchedulerSettings::keys()
+   {
+      static const std::vector<std::string> keys = {
+         "strategy", "checkpoint", "seed", "depth", "nr_steps", "output_dir", "trace_format",
+         "trace_codec", "trace_level", "site_filter"
+      };
+      return keys;
+   }
+   
+   //-------------------------------------------------------------------------------------
+   
+   std::string SchedulerSettings::environment_variable(const std::string& key)
+   {
+      std::string variable = "RECORD_REPLAY_" + key;
+      std::transform(variable.begin(), variable.end(), variable.begin(),
+                     [](const unsigned char c) { return std::toupper(c); });
+      return variable;
+   }
+   
+   //-------------------------------------------------------------------------------------
+   
+   void SchedulerSettings::apply_environment()
+   {
+      for (const auto& key : keys())
+      {
+         if (const char* value = std::getenv(environment_variable(key).c_str()))
+         {
+            try
+            {
+               set(key, value);
+            }
+            catch (const std::invalid_argument& e)
+            {
+               ERROR("SchedulerSettings", environment_variable(key) << ": " << e.what());
+            }
+         }
+      }
+   }
+   
+   //-------------------------------------------------------------------------------------
+   
    SchedulerSettings SchedulerSettings::read_from_file(const std::string& filename)
    {
-      std::string strategy_tag = "Random";
+      SchedulerSettings settings;
       std::ifstream ifs(filename);
-      if (!(ifs >> strategy_tag))
+      if (!ifs)
       {
          ERROR("SchedulerSettings", "reading settings from " << filename);
       }
+      bool first = true;
+      std::string line;
+      while (std::getline(ifs, line))
+      {
+         std::istringstream tokens(line.substr(0, line.find('#')));
+         std::string token;
+         while (tokens >> token)
+         {
+            const auto separator = token.find('=');
+            try
+            {
+               if (separator != std::string::npos)
+                  settings.set(token.substr(0, separator), token.substr(separator + 1));
+               else if (std::isdigit(static_cast<unsigned char>(token.front())))
+                  settings.set("checkpoint", token);
+               else if (first)
+                  settings.set("strategy", token);
+               else
+                  throw std::invalid_argument("unknown setting " + token);
+            }
+            catch (const std::invalid_argument& e)
+            {
+               ERROR("SchedulerSettings", filename << ": " << e.what());
+            }
+            first = false;
+         }
+      }
       ifs.close();
-      return SchedulerSettings(strategy_tag);
+      settings.apply_environment();
+      if (!settings.seed())
+      {
+         std::random_device device;
+         settings.set_seed((uint64_t(device()) << 32) | device());
+      }
+      return settings;
    }
    
    //-------------------------------------------------------------------------------------
     
    std::ostream& operator<<(std::ostream& os, const SchedulerSettings& settings)
    {
-      os << settings.strategy_tag();
+      os << "strategy=" << settings.strategy_tag() << "\n";
+      if (settings.checkpoint())
+      {
+         os << "checkpoint=" << *settings.checkpoint() << "\n";
+      }
+      if (settings.seed())
+      {
+         os << "seed=" << *settings.seed() << "\n";
+      }
+      os << "depth=" << settings.depth() << "\n"
+         << "nr_steps=" << settings.nr_steps() << "\n"
+         << "output_dir=" << settings.output_dir().string() << "\n"
+         << "trace_format=" << to_string(settings.trace_format()) << "\n"
+         << "trace_codec=" << to_string(settings.trace_codec()) << "\n"
+         << "trace_level=" << settings.trace_level() << "\n";
+      if (!settings.site_filter().empty())
+      {
+         os << "site_filter=" << settings.site_filter().string() << "\n";
+      }
       return os;
    }
    
@@ -1,7 +1,13 @@
 #pragma once
 
+// BOOST
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
+
 // STL
+#include <cstdint>
 #include <string>
+#include <vector>
 
 //--------------------------------------------------------------------------------------90
 /// @file scheduler_settings.hpp
@@ -14,6 +20,41 @@ namespace scheduler
 {
    //-------------------------------------------------------------------------------------
    
+   /// @brief The format in which the Scheduler dumps the recorded Execution.
+   
+   enum class trace_format_t
+   {
+      /// @brief record.txt and record_short.txt
+      Text,
+      /// @brief record.bin (see record_format.hpp), which mapped_execution reads in place.
+      Binary,
+      /// @brief The Execution is not dumped, e.g. when measuring overhead.
+      None
+   };
+   
+   std::string to_string(const trace_format_t& format);
+   
+   /// @brief The codec with which the Scheduler compresses the recorded Execution.
+   
+   enum class trace_codec_t
+   {
+      None,
+      /// @brief record.txt.lz4 resp. record.bin.lz4, in LZ4's frame format (see
+      /// compressed_stream.hpp).
+      LZ4
+   };
+   
+   std::string to_string(const trace_codec_t& codec);
+   
+   //-------------------------------------------------------------------------------------
+   
+   /// @details The settings are read once, by the Scheduler at startup, from a file of
+   /// whitespace separated key=value pairs (see SchedulerSettings::keys), one or more per
+   /// line. Text following a # is ignored. For backward compatibility, a first token
+   /// without '=' is the strategy and a bare number is the checkpoint. After the file,
+   /// every key can be overridden by the environment variable RECORD_REPLAY_<KEY>, e.g.
+   /// RECORD_REPLAY_SEED=42.
+   
    class SchedulerSettings
    {
    public:
@@ -22,7 +63,8 @@ namespace scheduler
         
       /// @brief Constructor.
       
-      explicit SchedulerSettings(const std::string& strategy_tag="Random");
+      explicit SchedulerSettings(const std::string& strategy_tag="Random",
+                                 const boost::optional<unsigned int>& checkpoint = boost::none);
       
       //----------------------------------------------------------------------------------
         
@@ -30,8 +72,127 @@ namespace scheduler
       
       const std::string& strategy_tag() const;
       
+      //----------------------------------------------------------------------------------
+      
+      /// @brief Getter.
+      /// @details The task number at which the Scheduler takes a checkpoint, if any.
+      
+      const boost::optional<unsigned int>& checkpoint() const;
+      
+      //----------------------------------------------------------------------------------
+      
+      /// @brief Getter.
+      /// @details The seed of randomized strategies. Settings read from file always have a
+      /// seed, so that a run can be reproduced from the settings it recorded.
+      
+      const boost::optional<uint64_t>& seed() const;
+      
+      /// @brief Setter.
+      
+      SchedulerSettings& set_seed(uint64_t seed);
+      
+      //----------------------------------------------------------------------------------
+      
+      /// @brief Getter.
+      /// @details The bug depth targeted by the PCT strategy.
+      
+      unsigned int depth() const;
+      
+      /// @brief Setter.
+      
+      SchedulerSettings& set_depth(unsigned int depth);
+      
+      //----------------------------------------------------------------------------------
+      
+      /// @brief Getter.
+      /// @details An estimate of the number of steps of an execution, over which the PCT
+      /// strategy spreads its priority change points.
+      
+      unsigned int nr_steps() const;
+      
+      /// @brief Setter.
+      
+      SchedulerSettings& set_nr_steps(unsigned int nr_steps);
+      
+      //----------------------------------------------------------------------------------
+      
+      /// @brief Getter.
+      /// @details The directory, relative to the working directory of the program, into
+      /// which the Scheduler dumps its records.
+      
+      const boost::filesystem::path& output_dir() const;
+      
+      /// @brief Setter.
+      
+      SchedulerSettings& set_output_dir(const boost::filesystem::path& output_dir);
+      
+      //----------------------------------------------------------------------------------
+      
+      /// @brief Getter.
+      
+      trace_format_t trace_format() const;
+      
+      /// @brief Setter.
+      
+      SchedulerSettings& set_trace_format(trace_format_t format);
+      
+      //----------------------------------------------------------------------------------
+      
+      /// @brief Getter.
+      
+      trace_codec_t trace_codec() const;
+      
+      /// @brief Setter.
+      
+      SchedulerSettings& set_trace_codec(trace_codec_t codec);
+      
+      //----------------------------------------------------------------------------------
+      
+      /// @brief Getter.
+      /// @details The level up to which the Scheduler records binary trace events into
+      /// trace_events.bin (see trace.hpp), 0 disables the trace. Events above the level
+      /// RECORD_REPLAY_TRACE_LEVEL the library was compiled with are never recorded.
+      
+      unsigned int trace_level() const;
+      
+      /// @brief Setter.
+      
+      SchedulerSettings& set_trace_level(unsigned int level);
+      
+      //----------------------------------------------------------------------------------
+      
+      /// @brief Getter.
+      /// @details The file, relative to the working directory of the program, of rules
+      /// enabling and disabling instrumented sites (see site_filter). If empty, all sites
+      /// are enabled.
+      
+      const boost::filesystem::path& site_filter() const;
+      
+      /// @brief Setter.
+      
+      SchedulerSettings& set_site_filter(const boost::filesystem::path& site_filter);
+      
+      //----------------------------------------------------------------------------------
+      
+      /// @brief Sets the setting with the given key from its string representation.
+      /// @throws std::invalid_argument if key is unknown or value is invalid.
+      
+      void set(const std::string& key, const std::string& value);
+      
+      //----------------------------------------------------------------------------------
+      
+      /// @brief The keys accepted by SchedulerSettings::set.
+      
+      static const std::vector<std::string>& keys();
+      
+      /// @brief The name of the environment variable overriding the given key.
+      
+      static std::string environment_variable(const std::string& key);
+      
       //----------------------------------------------------------------------------------
         
+      /// @brief Reads the settings from the given file and applies the environment
+      /// overrides. If no seed is set, one is drawn from std::random_device.
       /// @note Function to initialize SchedulerSettings object in the initializer list of
       /// Scheduler.
 
@@ -48,11 +209,36 @@ namespace scheduler
       std::string mStrategyTag;
       
       //----------------------------------------------------------------------------------
+      
+      boost::optional<unsigned int> mCheckpoint;
+      
+      //----------------------------------------------------------------------------------
+      
+      boost::optional<uint64_t> mSeed;
+      unsigned int mDepth;
+      unsigned int mNrSteps;
+      
+      //----------------------------------------------------------------------------------
+      
+      boost::filesystem::path mOutputDir;
+      trace_format_t mTraceFormat;
+      trace_codec_t mTraceCodec;
+      unsigned int mTraceLevel;
+      boost::filesystem::path mSiteFilter;
+      
+      //----------------------------------------------------------------------------------
+      
+      void apply_environment();
+      
+      //----------------------------------------------------------------------------------
         
    }; // end class SchedulerSettings
    
    //-------------------------------------------------------------------------------------
    
+   /// @brief Writes the settings as key=value pairs, one per line, such that
+   /// SchedulerSettings::read_from_file reads them back.
+   
    std::ostream& operator<<(std::ostream&, const SchedulerSettings&);
    
    //-------------------------------------------------------------------------------------
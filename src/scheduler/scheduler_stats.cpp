@@ -0,0 +1,88 @@
+
+#include "scheduler_stats.hpp"
+
+#include <ostream>
+
+
+namespace scheduler {
+
+//--------------------------------------------------------------------------------------------------
+
+log2_histogram::log2_histogram()
+{
+   for (auto& bucket : m_buckets)
+      bucket.store(0, std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void log2_histogram::record(uint64_t value)
+{
+   std::size_t bucket = 0;
+   while (value >>= 1)
+      ++bucket;
+   m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint64_t log2_histogram::count(std::size_t bucket) const
+{
+   return m_buckets[bucket].load(std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::ostream& operator<<(std::ostream& os, const log2_histogram& histogram)
+{
+   os << "[";
+   bool first = true;
+   for (std::size_t bucket = 0; bucket < log2_histogram::nr_buckets; ++bucket)
+   {
+      if (const auto count = histogram.count(bucket))
+      {
+         os << (first ? "" : ", ") << "{\"lower_bound\": " << (bucket == 0 ? 0 : 1ull << bucket)
+            << ", \"count\": " << count << "}";
+         first = false;
+      }
+   }
+   os << "]";
+   return os;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::ostream& operator<<(std::ostream& os, const lock_stats& stats)
+{
+   os << "{\"acquisitions\": " << stats.acquisitions.load()
+      << ", \"contended\": " << stats.contended.load() << "}";
+   return os;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::unique_lock<std::mutex> counted_lock(std::mutex& mutex, lock_stats& stats)
+{
+   std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+   if (!lock.owns_lock())
+   {
+      stats.contended.fetch_add(1, std::memory_order_relaxed);
+      lock.lock();
+   }
+   stats.acquisitions.fetch_add(1, std::memory_order_relaxed);
+   return lock;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void scheduler_stats::record_wait(duration_t wait)
+{
+   wait_time += wait;
+   round_wait_time.record(wait.count());
+   if (wait > max_wait_time)
+      max_wait_time = wait;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace scheduler
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+
+//--------------------------------------------------------------------------------------------------
+/// @file scheduler_stats.hpp
+/// @brief Profiling counters of the Scheduler and the TaskPool, dumped to stats.json.
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+namespace scheduler {
+
+/// @brief Lock-free histogram with power of two buckets: bucket i counts the values in
+/// [2^i, 2^(i+1)), bucket 0 also counts 0.
+
+class log2_histogram
+{
+public:
+   static constexpr std::size_t nr_buckets = 64;
+
+   log2_histogram();
+
+   void record(uint64_t value);
+
+   uint64_t count(std::size_t bucket) const;
+
+private:
+   std::array<std::atomic<uint64_t>, nr_buckets> m_buckets;
+
+}; // end class log2_histogram
+
+/// @brief Writes the non-empty buckets as a JSON array of {"lower_bound", "count"} objects.
+
+std::ostream& operator<<(std::ostream&, const log2_histogram&);
+
+//--------------------------------------------------------------------------------------------------
+
+struct lock_stats
+{
+   std::atomic<uint64_t> acquisitions{0};
+
+   /// @brief The number of acquisitions that found the mutex locked.
+   std::atomic<uint64_t> contended{0};
+
+}; // end struct lock_stats
+
+std::ostream& operator<<(std::ostream&, const lock_stats&);
+
+/// @brief Locks mutex, counting the acquisition and whether it was contended in stats.
+
+std::unique_lock<std::mutex> counted_lock(std::mutex& mutex, lock_stats& stats);
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief The counters maintained by the Scheduler. Apart from handoff_latency, which is
+/// recorded by the controlled threads, they are only updated by the Scheduler thread.
+
+struct scheduler_stats
+{
+   using duration_t = std::chrono::nanoseconds;
+
+   uint64_t rounds = 0;
+
+   /// @brief Time spent in TaskPool::wait_until_unfinished_threads_have_posted.
+   duration_t wait_time{0};
+   duration_t max_wait_time{0};
+
+   /// @brief Nanoseconds spent in TaskPool::wait_until_unfinished_threads_have_posted per
+   /// round.
+   log2_histogram round_wait_time;
+
+   /// @brief Nanoseconds between granting a thread the execution right and the thread taking
+   /// its turn.
+   log2_histogram handoff_latency;
+
+   /// @brief Size of record.txt or record.bin, compressed under trace_codec=lz4.
+   uint64_t trace_bytes = 0;
+
+   void record_wait(duration_t wait);
+
+}; // end struct scheduler_stats
+
+} // end namespace scheduler
@@ -9,7 +9,7 @@
 #include "state.hpp"
 
 // UTILS
-#include "debug.hpp"
+#include "trace.hpp"
 
 // STL
 #include <algorithm>
@@ -65,11 +65,12 @@ namespace scheduler
       
       //----------------------------------------------------------------------------------
       
-      /// @brief Constructor.
+      /// @brief Constructor forwarding args to the constructor of Strategy.
         
-      Selector()
+      template <typename... args_t>
+      explicit Selector(args_t&&... args)
       : SelectorBase()
-      , Strategy() { }
+      , Strategy(std::forward<args_t>(args)...) { }
       
       //----------------------------------------------------------------------------------
 		
@@ -81,13 +82,13 @@ namespace scheduler
       {
          if (task_nr < schedule.size())
          {
-            DEBUGF_SYNC("Selector", "select", "", "schedule[" << task_nr << "] = " << schedule[task_nr] << "\n");
+            RECORD_REPLAY_TRACE(select_from_schedule, task_nr, schedule[task_nr]);
             return result_t(Status::RUNNING, schedule[task_nr]);
          }
          std::lock_guard<std::mutex> guard(pool.mMutex);
          if (pool.size() > 0)
          {
-            const Tids enabled = pool.enabled_set();
+            const auto& enabled = pool.enabled();
             if (!enabled.empty())
             {
                return Strategy::select(pool, enabled, task_nr);
@@ -0,0 +1,72 @@
+
+#include "bounding.hpp"
+
+#include <assert.h>
+#include <iterator>
+
+
+namespace scheduler {
+namespace bounding {
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+/// @brief Position of tid in the round-robin order of enabled that starts at the first enabled
+/// thread with a tid not smaller than from.
+
+std::size_t round_robin_position(const program_model::Tids& enabled, const tid_t from,
+                                 const tid_t tid)
+{
+   const auto it = enabled.find(tid);
+   assert(it != enabled.end());
+   const auto start =
+      static_cast<std::size_t>(std::distance(enabled.begin(), enabled.lower_bound(from)));
+   const auto position = static_cast<std::size_t>(std::distance(enabled.begin(), it));
+   return (position + enabled.size() - start) % enabled.size();
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+
+tid_t default_choice(bound_t bound, const program_model::Tids& enabled,
+                     const boost::optional<tid_t>& current)
+{
+   /// @pre !enabled.empty()
+   assert(!enabled.empty());
+   if (current && enabled.find(*current) != enabled.end())
+   {
+      return *current;
+   }
+   if (bound == bound_t::Delay && current)
+   {
+      const auto next = enabled.lower_bound(*current);
+      return next == enabled.end() ? *enabled.begin() : *next;
+   }
+   return *enabled.begin();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+unsigned int cost(bound_t bound, const program_model::Tids& enabled,
+                  const boost::optional<tid_t>& current, const tid_t next)
+{
+   if (bound == bound_t::Preemption)
+   {
+      return (current && *current != next && enabled.find(*current) != enabled.end()) ? 1 : 0;
+   }
+   return round_robin_position(enabled, current ? *current : *enabled.begin(), next);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::string to_string(bound_t bound)
+{
+   return bound == bound_t::Preemption ? "PreemptionBounded" : "DelayBounded";
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace bounding
+} // end namespace scheduler
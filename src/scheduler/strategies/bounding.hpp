@@ -0,0 +1,50 @@
+#pragma once
+
+#include <thread.hpp>
+
+#include <boost/optional.hpp>
+
+#include <string>
+
+//--------------------------------------------------------------------------------------------------
+/// @file bounding.hpp
+/// @brief Deterministic choices and scheduling costs underlying preemption bounding and delay
+/// bounding.
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+namespace scheduler {
+namespace bounding {
+
+enum class bound_t
+{
+   Preemption,
+   Delay
+};
+
+using tid_t = program_model::Thread::tid_t;
+
+/// @brief The thread a bounded strategy selects from enabled when not following a schedule.
+/// @details Both keep running current as long as it is enabled. Otherwise, preemption bounding
+/// selects the enabled thread with the smallest tid and delay bounding the first enabled thread
+/// following current in round-robin order.
+/// @pre !enabled.empty()
+
+tid_t default_choice(bound_t bound, const program_model::Tids& enabled,
+                     const boost::optional<tid_t>& current);
+
+/// @brief The number of preemptions, resp. delays, incurred by selecting next from enabled
+/// when current was the previously executed thread.
+/// @details A preemption is a switch away from current while it is still enabled. A delay skips
+/// a thread in the round-robin order starting at the default choice, so selecting the n-th
+/// enabled thread following the default choice costs n delays.
+
+unsigned int cost(bound_t bound, const program_model::Tids& enabled,
+                  const boost::optional<tid_t>& current, const tid_t next);
+
+std::string to_string(bound_t bound);
+
+} // end namespace bounding
+} // end namespace scheduler
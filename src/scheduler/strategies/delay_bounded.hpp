@@ -0,0 +1,34 @@
+#pragma once
+
+#include "task_pool.hpp"
+
+#include <execution.hpp>
+#include <state.hpp>
+
+//--------------------------------------------------------------------------------------------------
+/// @file delay_bounded.hpp
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+namespace scheduler {
+
+/// @brief Completes a schedule prefix with bounding::default_choice for
+/// bounding::bound_t::Delay, so that the completion does not incur any delays.
+/// @note Used by explore_bounded (see bounded_search.hpp).
+
+class DelayBounded
+{
+public:
+   using Status = program_model::Execution::Status;
+   using result_t = std::pair<Status, program_model::Thread::tid_t>;
+
+   DelayBounded() = default;
+
+   result_t select(const TaskPool& pool, const TaskPool::enabled_t& selection,
+                   const unsigned int task_nr) const;
+
+}; // end class DelayBounded
+
+} // end namespace scheduler
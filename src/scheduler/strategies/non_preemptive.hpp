@@ -22,7 +22,7 @@ public:
 
    NonPreemptive() = default;
 
-   result_t select(const TaskPool& pool, const program_model::Tids& selection,
+   result_t select(const TaskPool& pool, const TaskPool::enabled_t& selection,
                    const unsigned int task_nr) const;
 
 }; // end class NonPreemptive
@@ -0,0 +1,72 @@
+
+#include "pct.hpp"
+
+#include "trace.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <set>
+
+
+namespace scheduler {
+
+//--------------------------------------------------------------------------------------------------
+
+PCT::PCT(uint64_t seed, unsigned int depth, unsigned int nr_steps)
+: m_random(seed)
+, m_depth(std::max(depth, 1u))
+, m_change_points()
+, m_priorities()
+{
+   // The distributions of <random> are implementation-defined, so all draws go through prng to
+   // reproduce a run from its seed with any standard library
+   std::set<unsigned int> change_points;
+   while (change_points.size() + 1 < m_depth && change_points.size() < nr_steps)
+   {
+      change_points.insert(1 + m_random.below(std::max(nr_steps, 1u)));
+   }
+   m_change_points.assign(change_points.begin(), change_points.end());
+}
+
+//--------------------------------------------------------------------------------------------------
+
+PCT::result_t PCT::select(const TaskPool& pool, const TaskPool::enabled_t& selection,
+                          const unsigned int task_nr)
+{
+   /// @pre !selection.empty
+   assert(!selection.empty());
+   for (const auto tid : selection)
+   {
+      if (m_priorities.find(tid) == m_priorities.end())
+      {
+         // A uniform 62-bit priority, which lies above depth without overflowing
+         m_priorities.emplace(tid, static_cast<priority_t>(m_random() >> 2) + m_depth + 1);
+      }
+   }
+
+   auto next = highest_priority(selection);
+   const auto change_point =
+      std::lower_bound(m_change_points.begin(), m_change_points.end(), task_nr);
+   if (change_point != m_change_points.end() && *change_point == task_nr)
+   {
+      // Each change point lowers the selected thread below the ones lowered before it
+      m_priorities[next] = m_depth - std::distance(m_change_points.begin(), change_point);
+      RECORD_REPLAY_TRACE(pct_change_point, task_nr, next);
+      next = highest_priority(selection);
+   }
+   return result_t(Status::RUNNING, next);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+program_model::Thread::tid_t PCT::highest_priority(const TaskPool::enabled_t& selection) const
+{
+   return *std::max_element(selection.begin(), selection.end(), [this](const auto lhs,
+                                                                       const auto rhs) {
+      return m_priorities.at(lhs) < m_priorities.at(rhs);
+   });
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace scheduler
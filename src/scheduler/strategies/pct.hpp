@@ -0,0 +1,57 @@
+#pragma once
+
+#include "prng.hpp"
+#include "task_pool.hpp"
+
+#include <execution.hpp>
+#include <state.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+/// @file pct.hpp
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+namespace scheduler {
+
+/// @brief Probabilistic Concurrency Testing (Burckhardt et al., ASPLOS 2010).
+/// @details Each thread gets a random priority above depth when it is first seen enabled and the
+/// enabled thread with the highest priority is selected. At depth - 1 change points, drawn
+/// uniformly from [1, nr_steps], the priority of the selected thread drops below all initial
+/// priorities: to depth - i at the i-th change point counting from 0, so that a thread lowered at
+/// a later change point runs after the ones lowered before it. An execution of n threads and at
+/// most nr_steps steps then hits a bug of depth d with probability at least
+/// 1 / (n * nr_steps^(d-1)). A run is fully determined by (seed, depth, nr_steps).
+
+class PCT
+{
+public:
+   using Status = program_model::Execution::Status;
+   using result_t = std::pair<Status, program_model::Thread::tid_t>;
+
+   PCT(uint64_t seed, unsigned int depth, unsigned int nr_steps);
+
+   result_t select(const TaskPool& pool, const TaskPool::enabled_t& selection,
+                   const unsigned int task_nr);
+
+private:
+   using priority_t = int64_t;
+
+   prng m_random;
+   unsigned int m_depth;
+
+   /// @brief The sorted change points.
+   std::vector<unsigned int> m_change_points;
+
+   std::unordered_map<program_model::Thread::tid_t, priority_t> m_priorities;
+
+   program_model::Thread::tid_t highest_priority(const TaskPool::enabled_t& selection) const;
+
+}; // end class PCT
+
+} // end namespace scheduler
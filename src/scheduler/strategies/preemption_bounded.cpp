@@ -0,0 +1,31 @@
+
+#include "preemption_bounded.hpp"
+
+#include "bounding.hpp"
+
+#include <assert.h>
+
+
+namespace scheduler {
+
+//--------------------------------------------------------------------------------------------------
+
+PreemptionBounded::result_t PreemptionBounded::select(const TaskPool& pool,
+                                                      const TaskPool::enabled_t& selection,
+                                                      const unsigned int task_nr) const
+{
+   boost::optional<program_model::Thread::tid_t> current;
+   if (task_nr > 0)
+   {
+      /// @pre task_nr > 0 -> pool.current_task != nullptr
+      assert(pool.current_task() != nullptr);
+      current = boost::apply_visitor(program_model::get_tid(), *pool.current_task());
+   }
+   const program_model::Tids enabled(selection.begin(), selection.end());
+   return result_t(Status::RUNNING,
+                   bounding::default_choice(bounding::bound_t::Preemption, enabled, current));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace scheduler
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "task_pool.hpp"
+
+#include <execution.hpp>
+#include <state.hpp>
+
+//--------------------------------------------------------------------------------------------------
+/// @file preemption_bounded.hpp
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+namespace scheduler {
+
+/// @brief Completes a schedule prefix with bounding::default_choice for
+/// bounding::bound_t::Preemption, so that the completion does not incur any preemptions.
+/// @note Used by explore_bounded (see bounded_search.hpp).
+
+class PreemptionBounded
+{
+public:
+   using Status = program_model::Execution::Status;
+   using result_t = std::pair<Status, program_model::Thread::tid_t>;
+
+   PreemptionBounded() = default;
+
+   result_t select(const TaskPool& pool, const TaskPool::enabled_t& selection,
+                   const unsigned int task_nr) const;
+
+}; // end class PreemptionBounded
+
+} // end namespace scheduler
@@ -1,7 +1,7 @@
 
 #include "random.hpp"
 
-#include <debug.hpp>
+#include "trace.hpp"
 
 #include <assert.h>
 
@@ -10,17 +10,21 @@ namespace scheduler {
 
 //--------------------------------------------------------------------------------------------------
 
-Random::result_t Random::select(const TaskPool& pool, const program_model::Tids& selection,
-                                const unsigned int task_nr) const
+Random::Random(uint64_t seed)
+: m_random(seed)
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+
+Random::result_t Random::select(const TaskPool& pool, const TaskPool::enabled_t& selection,
+                                const unsigned int task_nr)
 {
    /// @pre !selection.empty
    assert(!selection.empty());
-   srand(time(NULL));
-   program_model::Tids::iterator it = selection.begin();
-   int index = rand() % selection.size();
-   std::advance(it, index);
-   DEBUGF_SYNC("Random", "select", "", "selection[" << index << "] = " << *it);
-   return result_t(Status::RUNNING, *it);
+   const auto next = selection[m_random.below(selection.size())];
+   RECORD_REPLAY_TRACE(select_random, task_nr, next);
+   return result_t(Status::RUNNING, next);
 }
 
 //--------------------------------------------------------------------------------------------------
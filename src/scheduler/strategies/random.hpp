@@ -1,5 +1,6 @@
 #pragma once
 
+#include "prng.hpp"
 #include "task_pool.hpp"
 
 #include <execution.hpp>
@@ -14,16 +15,22 @@
 
 namespace scheduler {
 
+/// @brief Selects an enabled thread uniformly at random.
+/// @details A run is fully determined by the seed.
+
 class Random
 {
 public:
    using Status = program_model::Execution::Status;
    using result_t = std::pair<Status, program_model::Thread::tid_t>;
 
-   Random() = default;
+   explicit Random(uint64_t seed);
+
+   result_t select(const TaskPool& pool, const TaskPool::enabled_t& selection,
+                   const unsigned int task_nr);
 
-   result_t select(const TaskPool& pool, const program_model::Tids& selection,
-                   const unsigned int task_nr) const;
+private:
+   prng m_random;
 
 }; // end class Random
 
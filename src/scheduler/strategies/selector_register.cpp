@@ -2,23 +2,44 @@
 #include "selector_register.hpp"
 
 #include "custom_selector_register.hpp"
+#include "delay_bounded.hpp"
 #include "non_preemptive.hpp"
+#include "pct.hpp"
+#include "preemption_bounded.hpp"
 #include "random.hpp"
 
+#include <assert.h>
+
 
 namespace scheduler {
 
 //--------------------------------------------------------------------------------------------------
 
-SelectorUniquePtr selector_factory(const std::string& tag)
+SelectorUniquePtr selector_factory(const SchedulerSettings& settings)
 {
+   const auto& tag = settings.strategy_tag();
+   /// @pre settings.seed()
+   assert(settings.seed());
    if (tag == "NonPreemptive")
    {
       return std::make_unique<Selector<NonPreemptive>>();
    }
    else if (tag == "Random")
    {
-      return std::make_unique<Selector<Random>>();
+      return std::make_unique<Selector<Random>>(*settings.seed());
+   }
+   else if (tag == "PreemptionBounded")
+   {
+      return std::make_unique<Selector<PreemptionBounded>>();
+   }
+   else if (tag == "DelayBounded")
+   {
+      return std::make_unique<Selector<DelayBounded>>();
+   }
+   else if (tag == "PCT")
+   {
+      return std::make_unique<Selector<PCT>>(*settings.seed(), settings.depth(),
+                                             settings.nr_steps());
    }
    else
    {
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "scheduler_settings.hpp"
 #include "selector.hpp"
 
 //--------------------------------------------------------------------------------------------------
@@ -13,6 +14,6 @@ namespace scheduler {
 
 using SelectorUniquePtr = std::unique_ptr<SelectorBase>;
 
-SelectorUniquePtr selector_factory(const std::string& tag);
+SelectorUniquePtr selector_factory(const SchedulerSettings& settings);
 
 } // end namespace scheduler
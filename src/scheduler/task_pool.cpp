@@ -1,41 +1,40 @@
 
 #include "task_pool.hpp"
 
+#include "trace.hpp"
+
 #include "object_io.hpp"
 #include "thread_io.hpp"
 #include "visible_instruction_io.hpp"
 
-#include "debug.hpp"
 #include "utils_io.hpp"
 #include <algorithm/zip_map_values.hpp>
 
-#include <boost/range/adaptor/filtered.hpp>
-#include <boost/range/adaptor/map.hpp>
-#include <boost/range/algorithm/copy.hpp>
-
 #include <algorithm>
 #include <assert.h>
 
 namespace scheduler {
 
+constexpr unsigned int TaskPool::await_rounds;
+
 //--------------------------------------------------------------------------------------------------
 
 void TaskPool::register_thread(const Thread::tid_t& tid)
 {
-   std::lock_guard<std::mutex> guard(mMutex);
+   const auto guard = counted_lock(mMutex, m_mutex_stats);
    mThreads.insert(Threads::value_type(tid, Thread(tid)));
    const auto thread = mThreads.find(tid);
-   std::lock_guard<std::mutex> lock(m_objects_mutex);
+   const auto lock = counted_lock(m_objects_mutex, m_objects_mutex_stats);
    m_thread_states.insert(thread_states_t::value_type(tid, thread_state(thread->second)));
-   DEBUGF_SYNC("TaskPool", "register_thread", thread->second, "\n");
+   RECORD_REPLAY_TRACE(pool_register_thread, tid, 0);
 }
 
 //--------------------------------------------------------------------------------------------------
 
 void TaskPool::post(const Thread::tid_t& tid, const instruction_t& task)
 {
-   std::lock_guard<std::mutex> lock_mutex(mMutex);
-   DEBUGF_SYNC("Taskpool", "post", tid, "\n");
+   const auto lock_mutex = counted_lock(mMutex, m_mutex_stats);
+   RECORD_REPLAY_TRACE(pool_post, tid, 0);
    auto task_it(mTasks.find(tid));
    /// @pre mTasks.find(tid) == mTasks.end()
    assert(task_it == mTasks.end());
@@ -49,10 +48,10 @@ void TaskPool::post(const Thread::tid_t& tid, const instruction_t& task)
 
 void TaskPool::yield(const Thread::tid_t& tid)
 {
-   std::lock_guard<std::mutex> guard(mMutex);
+   const auto guard = counted_lock(mMutex, m_mutex_stats);
    if (mCurrentTask && boost::apply_visitor(program_model::get_tid(), *mCurrentTask) == tid)
    {
-      DEBUGF_SYNC("Taskpool", "yield", tid, "\n");
+      RECORD_REPLAY_TRACE(pool_yield, tid, 0);
       update_object_yield(*mCurrentTask);
    }
 }
@@ -61,7 +60,7 @@ void TaskPool::yield(const Thread::tid_t& tid)
 
 void TaskPool::finish(const program_model::Thread::tid_t& tid)
 {
-   std::lock_guard<std::mutex> lock(m_objects_mutex);
+   const auto lock = counted_lock(m_objects_mutex, m_objects_mutex_stats);
    
    auto thread_state = m_thread_states.find(tid);
    if (thread_state == m_thread_states.end())
@@ -82,25 +81,25 @@ void TaskPool::finish(const program_model::Thread::tid_t& tid)
 
 void TaskPool::wait_until_unfinished_threads_have_posted()
 {
-   std::unique_lock<std::mutex> lock(mMutex);
+   auto lock = counted_lock(mMutex, m_mutex_stats);
    mModified.wait(lock, [this] {
-      DEBUGF_SYNC("TaskPool", "wait_until_unfinished_threads_have_posted", "", "\n");
+      RECORD_REPLAY_TRACE(wait_until_unfinished_threads_have_posted, 0, 0);
       return std::all_of(mThreads.begin(), mThreads.end(), [this](const auto& thread) {
          return thread.second.status() == Thread::Status::FINISHED ||
                 mTasks.find(thread.first) != mTasks.end();
       });
    });
-   DEBUGF_SYNC("TaskPool", "all_unfinished_threads_have_posted", "", "\n");
+   RECORD_REPLAY_TRACE(all_unfinished_threads_have_posted, 0, 0);
 }
 
 //--------------------------------------------------------------------------------------------------
 
 void TaskPool::wait_all_finished()
 {
-   std::unique_lock<std::mutex> ul(mMutex);
+   auto ul = counted_lock(mMutex, m_mutex_stats);
    // cond WAIT mModified
    mModified.wait(ul, [this] {
-      DEBUGF_SYNC("TaskPool", "wait_all_finished", "", "\n");
+      RECORD_REPLAY_TRACE(wait_all_finished, 0, 0);
       return all_finished();
    });
 }
@@ -109,11 +108,15 @@ void TaskPool::wait_all_finished()
 
 instruction_t TaskPool::set_current(const Thread::tid_t& tid)
 {
-   std::lock_guard<std::mutex> guard(mMutex);
+   const auto guard = counted_lock(mMutex, m_mutex_stats);
    auto it = mTasks.find(tid);
    /// @pre mTasks.find(tid) != mTasks.end()
    assert(it != mTasks.end());
-   mCurrentTask = std::shared_ptr<instruction_t>(new instruction_t(it->second));
+   // Reuse the current task's storage, unless it is still shared with a reader of current_task
+   if (mCurrentTask && mCurrentTask.use_count() == 1)
+      *mCurrentTask = it->second;
+   else
+      mCurrentTask = std::make_shared<instruction_t>(it->second);
    mTasks.erase(it); // noexcept
    return *mCurrentTask;
 }
@@ -164,7 +167,7 @@ size_t TaskPool::size() const
 
 Thread::Status TaskPool::status_protected(const Thread::tid_t& tid)
 {
-   std::lock_guard<std::mutex> guard(mMutex);
+   const auto guard = counted_lock(mMutex, m_mutex_stats);
    return status(tid);
 }
 
@@ -172,7 +175,7 @@ Thread::Status TaskPool::status_protected(const Thread::tid_t& tid)
 
 void TaskPool::set_status_protected(const Thread::tid_t& tid, const Thread::Status& status)
 {
-   std::lock_guard<std::mutex> guard(mMutex);
+   const auto guard = counted_lock(mMutex, m_mutex_stats);
    set_status(tid, status);
    if (status == Thread::Status::DISABLED || status == Thread::Status::FINISHED)
    {
@@ -184,32 +187,62 @@ void TaskPool::set_status_protected(const Thread::tid_t& tid, const Thread::Stat
 
 Tids TaskPool::enabled_set() const
 {
-   using namespace boost::adaptors;
-   Tids tids;
-   const auto is_enabled = [](const auto& thread) {
-      return thread.second.status() == Thread::Status::ENABLED;
-   };
-   boost::copy(mThreads | filtered(is_enabled) | map_keys, std::inserter(tids, tids.end()));
-   return tids;
+   return Tids(m_enabled.begin(), m_enabled.end());
+}
+
+//--------------------------------------------------------------------------------------------------
+
+const TaskPool::enabled_t& TaskPool::enabled() const
+{
+   return m_enabled;
 }
 
 //--------------------------------------------------------------------------------------------------
 
 Tids TaskPool::enabled_set_protected()
 {
-   std::lock_guard<std::mutex> guard(mMutex);
+   const auto guard = counted_lock(mMutex, m_mutex_stats);
    return enabled_set();
 }
 
 //--------------------------------------------------------------------------------------------------
 
+void TaskPool::wake_stale_awaits()
+{
+   const auto guard = counted_lock(mMutex, m_mutex_stats);
+   const auto lock = counted_lock(m_objects_mutex, m_objects_mutex_stats);
+   if (m_awaits.empty())
+      return;
+   const bool none_enabled = m_enabled.empty();
+   for (auto await = m_awaits.begin(); await != m_awaits.end();)
+   {
+      // Woken by a write to the object
+      if (status(await->first) != Thread::Status::DISABLED)
+      {
+         await = m_awaits.erase(await);
+         continue;
+      }
+      if (--await->second.second > 0 && !none_enabled)
+      {
+         ++await;
+         continue;
+      }
+      RECORD_REPLAY_TRACE(wake_stale_await, await->second.first, await->first);
+      m_objects.find(await->second.first)->second.wake_await(await->first);
+      set_status(await->first, Thread::Status::ENABLED);
+      await = m_awaits.erase(await);
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
 NextSet TaskPool::nextset_protected()
 {
    using zip_function_t = std::function<next_t(const instruction_t&, const Thread&)>;
    const zip_function_t zip_function = [](const auto& task, const auto& thread) {
       return next_t{task, thread.status() == Thread::Status::ENABLED};
    };
-   std::lock_guard<std::mutex> guard(mMutex);
+   const auto guard = counted_lock(mMutex, m_mutex_stats);
    /// @throws std::invalid_argument (rethrow)
    return utils::algorithm::zip_map_values(mTasks, mThreads, zip_function);
 }
@@ -218,7 +251,7 @@ NextSet TaskPool::nextset_protected()
 
 std::unique_ptr<State> TaskPool::program_state()
 {
-   std::lock_guard<std::mutex> guard(mMutex);
+   const auto guard = counted_lock(mMutex, m_mutex_stats);
    NextSet N{};
    Tids Enabled{};
    for (const auto& entry : mTasks)
@@ -235,9 +268,31 @@ std::unique_ptr<State> TaskPool::program_state()
 
 //--------------------------------------------------------------------------------------------------
 
+std::size_t TaskPool::nr_objects() const
+{
+   const auto lock = counted_lock(m_objects_mutex, m_objects_mutex_stats);
+   return m_objects.size();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+const lock_stats& TaskPool::mutex_stats() const
+{
+   return m_mutex_stats;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+const lock_stats& TaskPool::objects_mutex_stats() const
+{
+   return m_objects_mutex_stats;
+}
+
+//--------------------------------------------------------------------------------------------------
+
 std::vector<data_race_t> TaskPool::data_races() const
 {
-   std::lock_guard<std::mutex> lock(m_objects_mutex);
+   const auto lock = counted_lock(m_objects_mutex, m_objects_mutex_stats);
    return m_data_races;
 }
 
@@ -258,6 +313,16 @@ void TaskPool::set_status(const Thread::tid_t& tid, const Thread::Status& status
    auto thread_it = mThreads.find(tid);
    assert(thread_it != mThreads.end());
    thread_it->second.set_status(status);
+   const auto position = std::lower_bound(m_enabled.begin(), m_enabled.end(), tid);
+   const bool listed = position != m_enabled.end() && *position == tid;
+   if (status == Thread::Status::ENABLED && !listed)
+   {
+      m_enabled.insert(position, tid);
+   }
+   else if (status != Thread::Status::ENABLED && listed)
+   {
+      m_enabled.erase(position);
+   }
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -269,7 +334,7 @@ void TaskPool::update_object_post(const Thread::tid_t& tid, const instruction_t&
    if (const auto* mem_location = boost::get<program_model::Object>(&operand))
    {
        const program_model::Object::ptr_t address = mem_location->address();
-       std::lock_guard<std::mutex> lock(m_objects_mutex);
+       const auto lock = counted_lock(m_objects_mutex, m_objects_mutex_stats);
        // Create a new object if one with name does not exist in m_objects
        if (m_objects.find(address) == m_objects.end())
        {
@@ -281,12 +346,16 @@ void TaskPool::update_object_post(const Thread::tid_t& tid, const instruction_t&
        std::move(data_races.begin(), data_races.end(), std::back_inserter(m_data_races));
        // Update status of threads operating on same operand
        enabled = operand_state.request(task);
+       const auto* mem_instr = boost::get<program_model::memory_instruction>(&task);
+       if (!enabled && mem_instr &&
+           mem_instr->operation() == program_model::memory_operation::Await)
+          m_awaits[tid] = {address, await_rounds};
    }
    else if (const auto* management_instr = boost::get<program_model::thread_management_instruction>(&task))
    {
       if (management_instr->operation() == program_model::thread_management_operation::Join)
       {
-         std::lock_guard<std::mutex> lock(m_objects_mutex);
+         const auto lock = counted_lock(m_objects_mutex, m_objects_mutex_stats);
          auto& operand_state = m_thread_states.find(management_instr->operand().tid())->second;
          enabled = operand_state.request(*management_instr);
       }
@@ -302,29 +371,28 @@ void TaskPool::update_object_yield(const instruction_t& task)
    if (const auto* mem_location = boost::get<program_model::Object>(&operand))
    {
        const auto tid = boost::apply_visitor(program_model::get_tid(), task);
-       std::lock_guard<std::mutex> lock(m_objects_mutex);
+       const auto lock = counted_lock(m_objects_mutex, m_objects_mutex_stats);
        auto obj = m_objects.find(mem_location->address());
        /// @pre mLockObs.find(task.obj()) != mLockObs.end()
        assert(obj != m_objects.end());
-       obj->second.perform(tid);
-       if (const auto* lock_instr = boost::get<program_model::lock_instruction>(&task))
+       if (obj->second.perform(tid))
        {
-          const bool is_lock = lock_instr->operation() == program_model::lock_operation::Lock;
-          set_status_of_waiting_on(obj->second,
-                                   (is_lock ? Thread::Status::DISABLED : Thread::Status::ENABLED));
+          update_status_of_waiting_on(obj->second);
        }
    }
 }
 
 //--------------------------------------------------------------------------------------------------
 
-void TaskPool::set_status_of_waiting_on(const object_state& object, const Thread::Status& status)
+void TaskPool::update_status_of_waiting_on(const object_state& object)
 {
-   DEBUGF_SYNC("TaskPool", "set_status_of_waiting_on", object.str() << ", " << to_string(status), "\n");
-   std::for_each(object.begin(0), object.end(0),
-                 [&status, this](const auto& request) { set_status(request.first, status); });
-   std::for_each(object.begin(1), object.end(1),
-                 [&status, this](const auto& request) { set_status(request.first, status); });
+   RECORD_REPLAY_TRACE(update_status_of_waiting_on, object.object().address(), 0);
+   const auto update = [&object, this](const auto& request) {
+      set_status(request.first, (object.enabled(request.second) ? Thread::Status::ENABLED
+                                                                : Thread::Status::DISABLED));
+   };
+   std::for_each(object.begin(0), object.end(0), update);
+   std::for_each(object.begin(1), object.end(1), update);
 }
 
 //--------------------------------------------------------------------------------------------------
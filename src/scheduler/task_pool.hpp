@@ -2,12 +2,15 @@
 
 #include "concurrency_error.hpp"
 #include "object_state.hpp"
+#include "recycling_allocator.hpp"
+#include "scheduler_stats.hpp"
 #include "thread_state.hpp"
 
 #include "state.hpp"
 
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 using namespace program_model;
 
@@ -34,10 +37,11 @@ public:
    // Type definitions
    using object_t = program_model::Object;
    using instruction_t = program_model::visible_instruction_t;
-   using Tasks = std::unordered_map<Thread::tid_t, instruction_t>;
+   using Tasks = recycling_unordered_map<Thread::tid_t, instruction_t>;
    using Threads = std::unordered_map<Thread::tid_t, Thread>;
    using objects_t = std::unordered_map<object_t::ptr_t, object_state>;
    using thread_states_t = std::unordered_map<Thread::tid_t, thread_state>;
+   using enabled_t = std::vector<Thread::tid_t>;
 
    /// @brief Mytex protecting mTasks, mStatus, mNr_registered, and mModified.
 
@@ -119,10 +123,28 @@ public:
 
    Tids enabled_set() const;
 
+   /// @brief The tids of the ENABLED Threads in increasing order.
+   /// @details Kept up to date by every status change, so a Strategy can index it without
+   /// rebuilding the enabled set per selection. Sorted rather than in order of the status
+   /// changes, which depends on the order in which threads post, so that a selection is
+   /// reproducible. Not mMutex-protected.
+
+   const enabled_t& enabled() const;
+
    /// @brief mMutex-protected version of TaskPool::enabled_set.
 
    Tids enabled_set_protected();
 
+   /// @brief The number of rounds after which an Await that no visible write woke is enabled
+   /// anyway: the object may be written by code that is not instrumented, or at a disabled site.
+
+   static constexpr unsigned int await_rounds = 64;
+
+   /// @brief Counts a round for each Await that was not woken yet, and wakes the ones that
+   /// waited await_rounds rounds, or all of them if no thread is enabled.
+
+   void wake_stale_awaits();
+
    /// @brief Constructs and returns the NextSet
    /// { (tid, (mTasks[tid], mThread[tid.status == ENABLED)) } from this TaskPool.
 
@@ -135,6 +157,16 @@ public:
 
    std::vector<data_race_t> data_races() const;
 
+   /// @brief The number of objects operated on so far.
+
+   std::size_t nr_objects() const;
+
+   /// @brief Contention on mMutex, not counting the Selector's.
+
+   const lock_stats& mutex_stats() const;
+
+   const lock_stats& objects_mutex_stats() const;
+
 private:
    /// @brief Datastrucure mapping Thread::tid_t's to the associated Thread's posted
    /// next task.
@@ -149,6 +181,10 @@ private:
 
    Threads mThreads;
 
+   /// @brief The sorted tids of the ENABLED Threads.
+
+   enabled_t m_enabled;
+
    /// @brief Datastructure containing the objects operated on by the program.
 
    objects_t m_objects;
@@ -156,10 +192,17 @@ private:
 
    std::vector<data_race_t> m_data_races;
 
-   /// @brief Mutex protecting m_objects and m_data_races.
+   /// @brief The Awaits that were disabled when they were posted, by tid: the object they wait
+   /// for and the number of rounds left until they are woken anyway.
+   std::unordered_map<Thread::tid_t, std::pair<object_t::ptr_t, unsigned int>> m_awaits;
+
+   /// @brief Mutex protecting m_objects, m_data_races and m_awaits.
 
    mutable std::mutex m_objects_mutex;
 
+   mutable lock_stats m_mutex_stats;
+   mutable lock_stats m_objects_mutex_stats;
+
    // HELPER FUNCTIONS
 
    /// @brief Unprotected read-only access to the status of Thread tid.
@@ -174,9 +217,11 @@ private:
 
    void update_object_yield(const instruction_t& task);
 
-   /// @brief Set the status of all Threads with lock requests on obj to the given one.
+   /// @brief Sets the status of all Threads with requests on obj to whether their request is
+   /// enabled, after the state of obj as a lock, semaphore or condition variable changed or a
+   /// write to obj woke an Await.
 
-   void set_status_of_waiting_on(const object_state& obj, const Thread::Status&);
+   void update_status_of_waiting_on(const object_state& obj);
 
    /// @brief Returns whether all registered threads are FINISHED.
 
@@ -1,9 +1,10 @@
 
 #include "thread_state.hpp"
 
+#include "trace.hpp"
+
 #include <visible_instruction_io.hpp>
 
-#include <debug.hpp>
 #include <utils_io.hpp>
 
 #include <algorithm>
@@ -24,15 +25,13 @@ thread_state::thread_state(thread_t& object)
 
 bool thread_state::request(const instruction_t& instr)
 {
-   DEBUGF_SYNC("thread_state", "request", program_model::instruction_to_short_string()(instr),
-               "\n");
    using namespace program_model;
    if (instr.operation() == thread_management_operation::Join)
    {
       if (m_waiting.find(instr.tid()) == m_waiting.end())
       {
          m_waiting.insert({instr.tid(), instr});
-         DEBUG_SYNC(*this << "\n");
+         RECORD_REPLAY_TRACE(thread_request, instr.tid(), m_object.tid());
          return m_object.status() == Thread::Status::FINISHED;
       }
       throw std::logic_error("requesting thread already has instruction waiting");
@@ -44,12 +43,11 @@ bool thread_state::request(const instruction_t& instr)
 
 void thread_state::perform(const thread_t::tid_t& tid)
 {
-   DEBUGF_SYNC("thread_state", "perform", tid, "\n");
    const auto it = m_waiting.find(tid);
    if (it != m_waiting.end())
    {
       m_waiting.erase(it);
-      DEBUG_SYNC(*this << "\n");
+      RECORD_REPLAY_TRACE(thread_perform, tid, 0);
       return;
    }
    throw std::invalid_argument("requesting thread has no instruction waiting");
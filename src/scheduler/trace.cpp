@@ -0,0 +1,237 @@
+
+#include "trace.hpp"
+
+#include <error.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace scheduler {
+namespace trace {
+
+//--------------------------------------------------------------------------------------------------
+
+std::atomic<unsigned int> detail::level(0);
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+constexpr std::size_t buffer_capacity = 4096;
+
+/// @brief The records of a single thread. Only the owning thread appends, but flush writes the
+/// buffers of all threads, hence the (normally uncontended) mutex.
+
+struct buffer
+{
+   explicit buffer(const uint32_t thread)
+   : thread(thread)
+   {
+      records.reserve(buffer_capacity);
+   }
+
+   std::mutex mutex;
+   const uint32_t thread;
+   std::vector<record_t> records;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+class sink
+{
+public:
+   static sink& instance()
+   {
+      static sink the_sink;
+      return the_sink;
+   }
+
+   void open(const boost::filesystem::path& file, const unsigned int level, const bool append)
+   {
+      std::lock_guard<std::mutex> lock(m_file_mutex);
+      m_file.close();
+      if (level > 0)
+      {
+         m_file.open(file.string(),
+                     std::ios::binary | (append ? std::ios::app : std::ios::trunc));
+         if (!m_file)
+         {
+            ERROR("trace::open", "opening " << file);
+            return;
+         }
+         // An appended trace keeps its header and the time base of its earlier records
+         m_file.seekp(0, std::ios::end);
+         if (m_file.tellp() == 0)
+         {
+            file_header header{{}, version, sizeof(record_t)};
+            std::copy(std::begin(magic), std::end(magic), std::begin(header.magic));
+            m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            m_start = std::chrono::steady_clock::now();
+         }
+      }
+      detail::level.store(m_file.is_open() ? level : 0);
+   }
+
+   std::shared_ptr<buffer> attach()
+   {
+      std::lock_guard<std::mutex> lock(m_buffers_mutex);
+      m_buffers.push_back(std::make_shared<buffer>(m_nr_threads++));
+      return m_buffers.back();
+   }
+
+   void detach(const std::shared_ptr<buffer>& thread_buffer)
+   {
+      write(*thread_buffer);
+      std::lock_guard<std::mutex> lock(m_buffers_mutex);
+      m_buffers.erase(std::remove(m_buffers.begin(), m_buffers.end(), thread_buffer),
+                      m_buffers.end());
+   }
+
+   void flush()
+   {
+      std::lock_guard<std::mutex> lock(m_buffers_mutex);
+      for (const auto& thread_buffer : m_buffers)
+      {
+         write(*thread_buffer);
+      }
+      std::lock_guard<std::mutex> file_lock(m_file_mutex);
+      m_file.flush();
+   }
+
+   uint64_t now() const
+   {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - m_start)
+         .count();
+   }
+
+   /// @pre The caller holds thread_buffer.mutex.
+
+   void write_locked(buffer& thread_buffer)
+   {
+      std::lock_guard<std::mutex> lock(m_file_mutex);
+      if (m_file.is_open())
+      {
+         m_file.write(reinterpret_cast<const char*>(thread_buffer.records.data()),
+                      thread_buffer.records.size() * sizeof(record_t));
+      }
+      thread_buffer.records.clear();
+   }
+
+private:
+   sink()
+   : m_start(std::chrono::steady_clock::now())
+   {
+   }
+
+   void write(buffer& thread_buffer)
+   {
+      std::lock_guard<std::mutex> lock(thread_buffer.mutex);
+      write_locked(thread_buffer);
+   }
+
+   std::mutex m_file_mutex;
+   std::ofstream m_file;
+   std::chrono::steady_clock::time_point m_start;
+
+   std::mutex m_buffers_mutex;
+   std::vector<std::shared_ptr<buffer>> m_buffers;
+   uint32_t m_nr_threads = 0;
+
+}; // end class sink
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Attaches a buffer to the calling thread on its first record and writes it when the
+/// thread exits.
+
+class local_buffer
+{
+public:
+   local_buffer()
+   : m_buffer(sink::instance().attach())
+   {
+   }
+
+   ~local_buffer()
+   {
+      sink::instance().detach(m_buffer);
+   }
+
+   buffer& get()
+   {
+      return *m_buffer;
+   }
+
+private:
+   std::shared_ptr<buffer> m_buffer;
+
+}; // end class local_buffer
+
+/// @brief The calling thread's local_buffer, if it has recorded anything.
+
+thread_local std::unique_ptr<local_buffer> local;
+
+buffer& local_records()
+{
+   if (!local)
+   {
+      local = std::make_unique<local_buffer>();
+   }
+   return local->get();
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+
+void open(const boost::filesystem::path& file, const unsigned int level, const bool append)
+{
+   sink::instance().open(file, std::min(level, unsigned(RECORD_REPLAY_TRACE_LEVEL)), append);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void flush()
+{
+   sink::instance().flush();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void exit_thread()
+{
+   local.reset();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void record(const event_t event, const uint64_t arg0, const uint64_t arg1)
+{
+   auto& thread_buffer = local_records();
+   std::lock_guard<std::mutex> lock(thread_buffer.mutex);
+   thread_buffer.records.push_back(record_t{sink::instance().now(), thread_buffer.thread,
+                                            static_cast<uint16_t>(event), 0, {arg0, arg1}});
+   if (thread_buffer.records.size() == buffer_capacity)
+   {
+      sink::instance().write_locked(thread_buffer);
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint64_t operation(const program_model::visible_instruction_t& instruction)
+{
+   return (uint64_t(instruction.which()) << 8) |
+          uint64_t(boost::apply_visitor(program_model::operation_as_int(), instruction));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace trace
+} // end namespace scheduler
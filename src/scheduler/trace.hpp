@@ -0,0 +1,113 @@
+#pragma once
+
+#include "trace_events.hpp"
+
+#include <visible_instruction.hpp>
+
+#include <boost/filesystem/path.hpp>
+
+#include <atomic>
+#include <type_traits>
+
+//--------------------------------------------------------------------------------------------------
+/// @file trace.hpp
+/// @brief Level-filtered binary tracing of the Scheduler into per-thread buffers.
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+/// @brief The highest level of events compiled in. At 0 RECORD_REPLAY_TRACE expands to a branch on
+/// a constant, so that its arguments are type checked but never evaluated.
+
+#ifndef RECORD_REPLAY_TRACE_LEVEL
+#define RECORD_REPLAY_TRACE_LEVEL 0
+#endif
+
+/// @brief Records the given event with its two arguments (see RECORD_REPLAY_TRACE_EVENTS), if its
+/// level is compiled in and enabled at runtime.
+
+#define RECORD_REPLAY_TRACE(event, arg0, arg1)                                                     \
+   do                                                                                              \
+   {                                                                                               \
+      using ::scheduler::trace::event_t;                                                           \
+      if (::scheduler::trace::compiled<event_t::event>::value &&                                   \
+          ::scheduler::trace::enabled(event_t::event))                                             \
+      {                                                                                            \
+         ::scheduler::trace::record(event_t::event, ::scheduler::trace::to_arg(arg0),              \
+                                    ::scheduler::trace::to_arg(arg1));                             \
+      }                                                                                            \
+   } while (false)
+
+
+namespace scheduler {
+namespace trace {
+
+template <event_t event>
+struct compiled : std::integral_constant<bool, level_of(event) <= RECORD_REPLAY_TRACE_LEVEL>
+{
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Starts tracing the events up to the given level (capped at RECORD_REPLAY_TRACE_LEVEL)
+/// into the given file, replacing a previously opened one. Level 0 only closes the trace.
+/// @param append Whether to continue an existing trace file, e.g. the prefix of the execution
+/// in a branch process forked from a checkpoint, rather than to truncate it.
+
+void open(const boost::filesystem::path& file, unsigned int level, bool append = false);
+
+/// @brief Writes the buffered records of all threads to the file.
+/// @note A thread's buffer is also written when it is full and when the thread exits.
+
+void flush();
+
+/// @brief Writes the buffered records of the calling thread, for a thread that is about to exit
+/// without running the destructors of its thread_local objects (see exit_restored_thread).
+
+void exit_thread();
+
+//--------------------------------------------------------------------------------------------------
+
+namespace detail {
+extern std::atomic<unsigned int> level;
+} // end namespace detail
+
+inline bool enabled(const event_t event)
+{
+   return level_of(event) <= detail::level.load(std::memory_order_relaxed);
+}
+
+void record(event_t event, uint64_t arg0, uint64_t arg1);
+
+//--------------------------------------------------------------------------------------------------
+
+template <typename T, typename = std::enable_if_t<std::is_integral<T>::value>>
+uint64_t to_arg(const T value)
+{
+   return static_cast<uint64_t>(value);
+}
+
+template <typename T, typename = std::enable_if_t<std::is_enum<T>::value>, typename = void>
+uint64_t to_arg(const T value)
+{
+   return static_cast<uint64_t>(value);
+}
+
+template <typename T>
+uint64_t to_arg(const T* pointer)
+{
+   return reinterpret_cast<uintptr_t>(pointer);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Encodes the kind of the instruction (its index in visible_instruction_t) in the second
+/// byte and its operation in the first.
+
+uint64_t operation(const program_model::visible_instruction_t& instruction);
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace trace
+} // end namespace scheduler
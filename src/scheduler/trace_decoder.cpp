@@ -0,0 +1,108 @@
+
+#include "trace_events.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+/// @file trace_decoder.cpp
+/// @brief Renders a binary Scheduler trace (trace_events.bin) as text, one record per line,
+/// ordered by time.
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+namespace {
+
+using namespace scheduler::trace;
+
+std::vector<record_t> read_records(std::istream& is)
+{
+   file_header header;
+   if (!is.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+       std::memcmp(header.magic, magic, sizeof(magic)) != 0)
+   {
+      throw std::runtime_error("not a trace file");
+   }
+   if (header.version != version || header.record_size != sizeof(record_t))
+   {
+      throw std::runtime_error("unsupported trace version " + std::to_string(header.version));
+   }
+   std::vector<record_t> records;
+   record_t record;
+   while (is.read(reinterpret_cast<char*>(&record), sizeof(record)))
+   {
+      records.push_back(record);
+   }
+   return records;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void write_record(std::ostream& os, const record_t& record)
+{
+   os << record.time << "\t[thread" << record.thread << "]\t";
+   if (record.event >= static_cast<uint16_t>(event_t::nr_events))
+   {
+      os << "unknown(" << record.event << ")\n";
+      return;
+   }
+   const auto& info = event_info[record.event];
+   os << info.name;
+   for (std::size_t i = 0; i < 2; ++i)
+   {
+      if (info.args[i][0] != '\0')
+      {
+         os << " " << info.args[i] << "=";
+         if (std::strcmp(info.args[i], "operation") == 0)
+            os << (record.args[i] >> 8) << "/" << (record.args[i] & 0xff);
+         else if (std::strcmp(info.args[i], "object") == 0 || std::strcmp(info.args[i], "pid") == 0)
+            os << std::hex << "0x" << record.args[i] << std::dec;
+         else
+            os << record.args[i];
+      }
+   }
+   os << "\n";
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+
+int main(int argc, const char* argv[])
+{
+   if (argc != 2)
+   {
+      std::cerr << "usage: " << argv[0] << " <trace_events.bin>\n";
+      return 1;
+   }
+   std::ifstream ifs(argv[1], std::ios::binary);
+   if (!ifs)
+   {
+      std::cerr << "cannot open " << argv[1] << "\n";
+      return 1;
+   }
+   try
+   {
+      auto records = read_records(ifs);
+      std::stable_sort(records.begin(), records.end(), [](const auto& lhs, const auto& rhs) {
+         return lhs.time < rhs.time;
+      });
+      for (const auto& record : records)
+      {
+         write_record(std::cout, record);
+      }
+   }
+   catch (const std::runtime_error& e)
+   {
+      std::cerr << argv[1] << ": " << e.what() << "\n";
+      return 1;
+   }
+   return 0;
+}
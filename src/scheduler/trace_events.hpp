@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------------------
+/// @file trace_events.hpp
+/// @brief The events of the binary Scheduler trace and the layout of the trace file, shared by
+/// the writer (trace.hpp) and the offline decoder.
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+
+/// @brief X(event, level, arg0, arg1) for every event, where arg0 and arg1 name the (at most two)
+/// integer arguments an event carries. An empty name marks an unused argument. Levels are
+/// 1 (scheduling decisions), 2 (per-task events) and 3 (condition variable wake-ups).
+
+#define RECORD_REPLAY_TRACE_EVENTS(X)                                                              \
+   X(start, 1, "schedule_size", "")                                                               \
+   X(round, 1, "task_nr", "")                                                                     \
+   X(select_from_schedule, 1, "task_nr", "tid")                                                   \
+   X(select_random, 1, "task_nr", "tid")                                                          \
+   X(pct_change_point, 1, "task_nr", "tid")                                                       \
+   X(schedule_thread, 1, "tid", "operation")                                                      \
+   X(register_thread, 1, "tid", "pid")                                                            \
+   X(restore_thread, 1, "tid", "pid")                                                             \
+   X(finish_thread, 1, "tid", "")                                                                 \
+   X(join_unregistered, 1, "pid", "")                                                             \
+   X(take_checkpoint, 1, "task_nr", "")                                                           \
+   X(close, 1, "status", "")                                                                      \
+   X(joined_scheduler, 1, "", "")                                                                 \
+   X(post_task, 2, "tid", "operation")                                                            \
+   X(post_task_unregistered, 2, "", "")                                                           \
+   X(wait_for_turn, 2, "tid", "")                                                                 \
+   X(take_turn, 2, "tid", "latency_ns")                                                           \
+   X(enter_function, 2, "tid", "depth")                                                           \
+   X(exit_function, 2, "tid", "depth")                                                            \
+   X(pool_register_thread, 2, "tid", "")                                                          \
+   X(pool_post, 2, "tid", "")                                                                     \
+   X(pool_yield, 2, "tid", "")                                                                    \
+   X(all_unfinished_threads_have_posted, 2, "", "")                                               \
+   X(update_status_of_waiting_on, 2, "object", "")                                                \
+   X(object_request, 2, "object", "tid")                                                          \
+   X(object_perform, 2, "object", "tid")                                                          \
+   X(thread_request, 2, "tid", "joined")                                                          \
+   X(thread_perform, 2, "tid", "")                                                                \
+   X(wait_until_registered, 3, "pid", "")                                                         \
+   X(wait_until_main_thread_registered, 3, "", "")                                                \
+   X(wait_until_unfinished_threads_have_posted, 3, "", "")                                        \
+   X(wait_all_finished, 3, "", "")                                                                \
+   X(wake_stale_await, 1, "object", "tid")
+
+
+namespace scheduler {
+namespace trace {
+
+enum class event_t : uint16_t
+{
+#define RECORD_REPLAY_TRACE_ENUMERATOR(event, level, arg0, arg1) event,
+   RECORD_REPLAY_TRACE_EVENTS(RECORD_REPLAY_TRACE_ENUMERATOR)
+#undef RECORD_REPLAY_TRACE_ENUMERATOR
+      nr_events
+};
+
+//--------------------------------------------------------------------------------------------------
+
+struct event_info_t
+{
+   const char* name;
+   unsigned int level;
+   const char* args[2];
+};
+
+constexpr event_info_t event_info[] = {
+#define RECORD_REPLAY_TRACE_INFO(event, level, arg0, arg1) {#event, level, {arg0, arg1}},
+   RECORD_REPLAY_TRACE_EVENTS(RECORD_REPLAY_TRACE_INFO)
+#undef RECORD_REPLAY_TRACE_INFO
+};
+
+constexpr unsigned int level_of(const event_t event)
+{
+   return event_info[static_cast<std::size_t>(event)].level;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief A trace file is a file_header followed by records in native byte order. Records of one
+/// thread appear in order, but records of different threads are interleaved per flushed buffer.
+
+struct file_header
+{
+   char magic[8];
+   uint32_t version;
+   uint32_t record_size;
+};
+
+constexpr char magic[8] = {'R', 'R', 'T', 'R', 'A', 'C', 'E', '\0'};
+constexpr uint32_t version = 1;
+
+struct record_t
+{
+   /// @brief Nanoseconds since the trace was opened.
+   uint64_t time;
+   /// @brief Index of the recording thread, in order of its first record.
+   uint32_t thread;
+   uint16_t event;
+   uint16_t reserved;
+   uint64_t args[2];
+};
+
+static_assert(sizeof(record_t) == 32, "record_t is written as is");
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace trace
+} // end namespace scheduler
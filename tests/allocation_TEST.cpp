@@ -0,0 +1,192 @@
+#include <controllable_thread.hpp>
+#include <scheduler_stats.hpp>
+#include <task_pool.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+// These tests replace the global operator new, hence their own executable
+// (RecordReplayAllocationTest) rather than RecordReplayTest.
+
+//--------------------------------------------------------------------------------------------------
+
+namespace record_replay {
+namespace test {
+namespace detail {
+
+/// @brief Whether the allocations of the current thread are counted.
+
+thread_local bool counting_allocations = false;
+std::atomic<std::size_t> nr_allocations(0);
+
+/// @brief Counts the allocations made by the calling thread while in scope. Another thread is
+/// counted along by setting its counting_allocations.
+
+class allocation_counter
+{
+public:
+   allocation_counter()
+   {
+      nr_allocations.store(0);
+      counting_allocations = true;
+   }
+
+   ~allocation_counter() { counting_allocations = false; }
+
+   std::size_t count() const { return nr_allocations.load(); }
+
+}; // end class allocation_counter
+
+} // end namespace detail
+} // end namespace test
+} // end namespace record_replay
+
+void* operator new(std::size_t size)
+{
+   if (record_replay::test::detail::counting_allocations)
+      ++record_replay::test::detail::nr_allocations;
+   if (void* block = std::malloc(size == 0 ? 1 : size))
+      return block;
+   throw std::bad_alloc();
+}
+
+void operator delete(void* block) noexcept
+{
+   std::free(block);
+}
+
+void operator delete(void* block, std::size_t) noexcept
+{
+   std::free(block);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+namespace record_replay {
+namespace test {
+
+/// @brief Posting a task as a wrapper_post_* function does (constructing the instruction with an
+/// interned file name and posting it to the TaskPool) and scheduling it does not allocate, once
+/// the pool's containers have reached their peak size.
+
+TEST(AllocationTest, PostingAndSchedulingTasksDoesNotAllocate)
+{
+   using namespace program_model;
+   int shared = 0;
+   std::mutex mutex;
+   static const char file_name[] = "allocation_TEST.cpp";
+
+   const auto instruction = [&](const Thread::tid_t tid, const unsigned int step) {
+      const meta_data_t meta_data{interned_string::from_static(file_name), step};
+      switch (step % 4)
+      {
+         case 0: return visible_instruction_t(lock_instruction(tid, lock_operation::Lock,
+                                                               Object(&mutex), meta_data));
+         case 1: return visible_instruction_t(memory_instruction(tid, memory_operation::Load,
+                                                                 Object(&shared), false,
+                                                                 meta_data));
+         case 2: return visible_instruction_t(memory_instruction(tid, memory_operation::Store,
+                                                                 Object(&shared), false,
+                                                                 meta_data));
+         default: return visible_instruction_t(lock_instruction(tid, lock_operation::Unlock,
+                                                                Object(&mutex), meta_data));
+      }
+   };
+
+   const Thread::tid_t nr_threads = 4;
+   scheduler::TaskPool pool;
+   for (Thread::tid_t tid = 0; tid < nr_threads; ++tid)
+   {
+      pool.register_thread(tid);
+      pool.post(tid, instruction(tid, 0));
+   }
+
+   const auto run = [&](const unsigned int nr_rounds) {
+      // Every thread in turn runs a critical section, while the others wait for the lock
+      for (unsigned int round = 0; round < nr_rounds; ++round)
+      {
+         const Thread::tid_t tid = round % nr_threads;
+         for (unsigned int step = 0; step < 4; ++step)
+         {
+            pool.set_current(tid);
+            pool.yield(tid);
+            pool.post(tid, instruction(tid, step + 1));
+         }
+      }
+   };
+
+   run(nr_threads);
+   detail::allocation_counter counter;
+   run(100);
+   EXPECT_EQ(0u, counter.count());
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief The handoff between the Scheduler thread and a controlled thread, as in
+/// Scheduler::post_task and Scheduler::run (granting the execution right, taking the turn and
+/// recording the handoff latency), does not allocate on either thread.
+
+TEST(AllocationTest, HandingOffTurnsDoesNotAllocate)
+{
+   const unsigned int nr_turns = 100;
+   scheduler::log2_histogram handoff_latency;
+   std::atomic<unsigned int> turns(0);
+   std::atomic<bool> created(false);
+   std::atomic<bool> counting(false);
+   std::unique_ptr<scheduler::controllable_thread> controlled;
+
+   std::thread thread([&] {
+      while (!created.load())
+         std::this_thread::yield();
+      for (unsigned int turn = 0; turn < nr_turns; ++turn)
+      {
+         if (const auto latency = controlled->post_task(false))
+            handoff_latency.record(latency->count());
+         ++turns;
+         // The first turn warms up the thread's synchronization
+         while (!counting.load())
+            std::this_thread::yield();
+         detail::counting_allocations = true;
+      }
+   });
+   controlled = std::make_unique<scheduler::controllable_thread>(0, thread.native_handle(),
+                                                                 std::this_thread::get_id());
+   created.store(true);
+
+   const auto take_turn = [&](const unsigned int turn) {
+      while (!controlled->parked())
+         std::this_thread::yield();
+      controlled->grant_execution_right();
+      while (turns.load() == turn)
+         std::this_thread::yield();
+   };
+   take_turn(0);
+   detail::allocation_counter counter;
+   counting.store(true);
+   for (unsigned int turn = 1; turn < nr_turns; ++turn)
+      take_turn(turn);
+   const auto nr_allocations = counter.count();
+   thread.join();
+
+   EXPECT_EQ(0u, nr_allocations);
+   std::size_t nr_recorded = 0;
+   for (std::size_t bucket = 0; bucket < scheduler::log2_histogram::nr_buckets; ++bucket)
+      nr_recorded += handoff_latency.count(bucket);
+   EXPECT_EQ(nr_turns, nr_recorded);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace test
+} // end namespace record_replay
+
+int main(int argc, char** argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,224 @@
+
+//--------------------------------------------------------------------------------------------------
+/// @file generate_workload.cpp
+/// @brief Generator of synthetic multithreaded test programs of configurable size.
+/// @details Usage:
+///
+///    GenerateWorkload [--threads n] [--objects n] [--ops n] [--lock-ratio r]
+///                     [--atomic-ratio r] [--seed n] [--output-dir dir]
+///
+/// The generated program spawns the given number of threads, each of which performs the given
+/// number of operations on shared objects. An operation accesses a shared int under its
+/// pthread mutex with probability lock-ratio, performs an atomic read-modify-write with
+/// probability atomic-ratio and otherwise accesses a shared int without synchronization (a
+/// potential data race). The operations are drawn at run time from a per-thread xorshift
+/// sequence seeded with seed + thread index, so that the program size does not grow with the
+/// number of operations. The program is written to
+/// <output-dir>/workload_t<threads>_o<objects>_n<ops>_l<lock%>_a<atomic%>.cpp.
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+
+namespace {
+
+struct workload_t
+{
+   unsigned long threads = 4;
+   unsigned long objects = 8;
+   unsigned long ops = 100;
+   double lock_ratio = 0.25;
+   double atomic_ratio = 0.25;
+   unsigned long seed = 0;
+   std::string output_dir = "tests/test_programs/generated";
+
+}; // end struct workload_t
+
+//--------------------------------------------------------------------------------------------------
+
+workload_t parse(int argc, char** argv)
+{
+   std::map<std::string, std::string> options;
+   for (int i = 1; i + 1 < argc; i += 2)
+   {
+      options[argv[i]] = argv[i + 1];
+   }
+   if (argc % 2 == 0)
+   {
+      throw std::invalid_argument(std::string("missing value for ") + argv[argc - 1]);
+   }
+
+   workload_t workload;
+   for (const auto& option : options)
+   {
+      const auto& value = option.second;
+      if (option.first == "--threads")
+         workload.threads = std::stoul(value);
+      else if (option.first == "--objects")
+         workload.objects = std::stoul(value);
+      else if (option.first == "--ops")
+         workload.ops = std::stoul(value);
+      else if (option.first == "--lock-ratio")
+         workload.lock_ratio = std::stod(value);
+      else if (option.first == "--atomic-ratio")
+         workload.atomic_ratio = std::stod(value);
+      else if (option.first == "--seed")
+         workload.seed = std::stoul(value);
+      else if (option.first == "--output-dir")
+         workload.output_dir = value;
+      else
+         throw std::invalid_argument("unknown option " + option.first);
+   }
+   if (workload.threads == 0 || workload.objects == 0 || workload.lock_ratio < 0 ||
+       workload.atomic_ratio < 0 || workload.lock_ratio + workload.atomic_ratio > 1)
+   {
+      throw std::invalid_argument("invalid workload");
+   }
+   return workload;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+unsigned int per_mille(const double ratio)
+{
+   return static_cast<unsigned int>(ratio * 1000 + 0.5);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::string file_name(const workload_t& workload)
+{
+   std::stringstream name;
+   name << "workload_t" << workload.threads << "_o" << workload.objects << "_n" << workload.ops
+        << "_l" << per_mille(workload.lock_ratio) / 10 << "_a"
+        << per_mille(workload.atomic_ratio) / 10 << ".cpp";
+   return name.str();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void generate(std::ostream& os, const workload_t& workload)
+{
+   const auto lock_threshold = per_mille(workload.lock_ratio);
+   const auto atomic_threshold = lock_threshold + per_mille(workload.atomic_ratio);
+   os << R"(
+//--------------------------------------------------------------------------------------------------
+/// @file )" << file_name(workload) << R"(
+/// @brief Generated by GenerateWorkload (tests/generator/generate_workload.cpp).
+/// @details threads=)" << workload.threads << " objects=" << workload.objects
+      << " ops=" << workload.ops << " lock-ratio=" << workload.lock_ratio
+      << " atomic-ratio=" << workload.atomic_ratio << " seed=" << workload.seed << R"(
+//--------------------------------------------------------------------------------------------------
+
+#include <atomic>
+#include <pthread.h>
+#include <thread>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+constexpr unsigned int nr_threads = )" << workload.threads << R"(;
+constexpr unsigned int nr_objects = )" << workload.objects << R"(;
+constexpr unsigned long nr_ops = )" << workload.ops << R"(;
+constexpr unsigned int seed = )" << workload.seed << R"(;
+
+// Thresholds on a draw from [0, 1000)
+constexpr unsigned int lock_threshold = )" << lock_threshold << R"(;
+constexpr unsigned int atomic_threshold = )" << atomic_threshold << R"(;
+
+int shared[nr_objects];
+std::atomic<int> atomics[nr_objects];
+pthread_mutex_t mutexes[nr_objects];
+
+void work(const unsigned int index)
+{
+   // Odd, so never 0, which xorshift would never leave
+   unsigned int state = (seed + index) * 2654435761u | 1;
+   for (unsigned long op = 0; op < nr_ops; ++op)
+   {
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+      const unsigned int object = state % nr_objects;
+      const unsigned int kind = (state >> 16) % 1000;
+      if (kind < lock_threshold)
+      {
+         pthread_mutex_lock(&mutexes[object]);
+         shared[object] += 1;
+         pthread_mutex_unlock(&mutexes[object]);
+      }
+      else if (kind < atomic_threshold)
+      {
+         atomics[object].fetch_add(1);
+      }
+      else if (kind % 2 == 0)
+      {
+         shared[object] = static_cast<int>(op);
+      }
+      else
+      {
+         volatile int value = shared[object];
+         (void)value;
+      }
+   }
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+
+int main()
+{
+   for (auto& mutex : mutexes)
+   {
+      pthread_mutex_init(&mutex, nullptr);
+   }
+   std::vector<std::thread> threads;
+   for (unsigned int index = 0; index < nr_threads; ++index)
+   {
+      threads.emplace_back(work, index);
+   }
+   for (auto& thread : threads)
+   {
+      thread.join();
+   }
+   return 0;
+}
+)";
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+   try
+   {
+      const auto workload = parse(argc, argv);
+      const auto path = workload.output_dir + "/" + file_name(workload);
+      std::ofstream ofs(path);
+      if (!ofs)
+      {
+         throw std::runtime_error("cannot write " + path);
+      }
+      generate(ofs, workload);
+      std::cout << path << std::endl;
+      return 0;
+   }
+   catch (const std::exception& e)
+   {
+      std::cerr << "GenerateWorkload: " << e.what() << std::endl;
+      return 1;
+   }
+}
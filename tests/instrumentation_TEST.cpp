@@ -1,18 +1,39 @@
 
 #include "include/test_helpers.hpp"
 
+#include <execution_io.hpp>
 #include <replay.hpp>
+#include <scheduler_settings.hpp>
 
 #include <gtest/gtest.h>
 
 #include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
 
 #include <chrono>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
 
 //--------------------------------------------------------------------------------------------------
 
 namespace record_replay {
 namespace test {
+namespace {
+
+/// @brief The lines of the sites.txt written by a run, one per site.
+
+std::vector<std::string> read_sites(const boost::filesystem::path& sites_file)
+{
+   std::vector<std::string> sites;
+   boost::filesystem::ifstream sites_stream(sites_file);
+   for (std::string site; std::getline(sites_stream, site);)
+      sites.push_back(site);
+   return sites;
+}
+
+} // end namespace
 
 struct InstrumentedProgramRunTest : public ::testing::TestWithParam<InstrumentedProgramTestData>
 {
@@ -48,6 +69,180 @@ INSTANTIATE_TEST_CASE_P(
       InstrumentedProgramTestData{"real_world/dining_philosophers.cpp", "0", "-std=c++14"},
       InstrumentedProgramTestData{"real_world/work_stealing_queue.cpp", "0", "-std=c++14"}));
 
+INSTANTIATE_TEST_CASE_P(
+   GeneratedPrograms, InstrumentedProgramRunTest,
+   ::testing::Values(
+      InstrumentedProgramTestData{"generated/workload_t4_o8_n100_l25_a25.cpp", "0", "-std=c++14"}));
+
+//--------------------------------------------------------------------------------------------------
+
+#if defined(RECORD_REPLAY_PASS_PLUGIN)
+
+/// @brief Instrumenting with clang -fpass-plugin declares the sites of every instrumented function
+/// and registers them with the scheduler, which lists them in sites.txt.
+
+TEST(PassPluginTest, RegistersTheSitesOfInstrumentedFunctions)
+{
+   const auto output_dir = detail::test_data_dir / "pass_plugin";
+   boost::filesystem::remove_all(output_dir);
+   boost::filesystem::create_directories(output_dir / "records");
+
+   const auto instrumented_executable = scheduler::instrument(
+      detail::test_programs_dir / "global_variable.cpp", output_dir / "instrumented", "0",
+      "-std=c++14");
+   ASSERT_NO_THROW(scheduler::run_under_schedule(
+      instrumented_executable, {}, std::chrono::milliseconds(3000), output_dir / "records"));
+
+   const auto sites = read_sites(output_dir / "records" / "sites.txt");
+   std::size_t nr_stores = 0;
+   for (const auto& site : sites)
+   {
+      EXPECT_NE(std::string::npos, site.find(" enabled")) << site;
+      if (site.find("modify_global_variablei global_variable Store") != std::string::npos)
+         ++nr_stores;
+   }
+   EXPECT_EQ(1u, nr_stores);
+}
+
+#endif
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief The prologue in front of a site skips the call to the wrapper on a thread flagged as
+/// uncontrolled and at a disabled site, so neither write is recorded.
+
+TEST(SitePrologueTest, UncontrolledThreadsAndDisabledSitesSkipTheWrapper)
+{
+   const auto output_dir = detail::test_data_dir / "skipped_sites";
+   boost::filesystem::create_directories(output_dir / "records");
+   const auto instrumented_executable = scheduler::instrument(
+      detail::test_programs_dir / "skipped_sites.c", output_dir / "instrumented", "0", "");
+   const auto site_filter = boost::filesystem::absolute(output_dir / "site_filter.txt");
+   boost::filesystem::ofstream(site_filter) << "disable function=write_disabled\n";
+
+   auto settings = scheduler::SchedulerSettings("NonPreemptive");
+   settings.set_site_filter(site_filter);
+   ASSERT_NO_THROW(scheduler::run_under_schedule(instrumented_executable, {}, settings,
+                                                 std::chrono::milliseconds(3000),
+                                                 output_dir / "records"));
+   program_model::Execution execution;
+   {
+      boost::filesystem::ifstream record(output_dir / "records" / "record.txt");
+      record >> execution;
+   }
+   ASSERT_EQ(program_model::Execution::Status::DONE, execution.status());
+
+   std::set<unsigned int> lines;
+   for (program_model::Execution::index_t index = 1; index <= execution.size(); ++index)
+   {
+      const auto& instruction = execution[index].instr();
+      const auto meta_data = boost::apply_visitor(program_model::get_meta_data(), instruction);
+      if (boost::get<program_model::memory_instruction>(&instruction) &&
+          boost::filesystem::path(meta_data.file_name).filename() == "skipped_sites.c")
+         lines.insert(meta_data.line_number);
+   }
+   // visible = 1
+   EXPECT_EQ(1u, lines.count(37));
+   // disabled = 1 at a disabled site, hidden = 1 on the uncontrolled thread
+   EXPECT_EQ(0u, lines.count(21));
+   EXPECT_EQ(0u, lines.count(27));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST(InstrumentProjectTest, InstrumentsEachTranslationUnitOnce)
+{
+   const auto project_dir = detail::test_programs_dir / "project";
+   const auto output_dir = detail::test_data_dir / "project";
+   boost::filesystem::remove_all(output_dir);
+   boost::filesystem::create_directories(output_dir / "records");
+
+   const auto compile_commands = output_dir / "compile_commands.json";
+   boost::filesystem::ofstream(compile_commands)
+      << R"([{"directory": ")" << project_dir.string() << R"(", "file": "counter.cpp", )"
+      << R"("command": "c++ -std=c++14 -I. -o counter.o -c counter.cpp"},)"
+      << R"({"directory": ")" << project_dir.string() << R"(", "file": "main.cpp", )"
+      << R"("arguments": ["c++", "-std=c++14", "-c", "main.cpp"]}])";
+
+   const auto instrumented = scheduler::instrument_project(compile_commands, output_dir);
+   EXPECT_EQ(2u, instrumented.nr_instrumented);
+   EXPECT_EQ(0u, instrumented.nr_cached);
+
+   const auto cached = scheduler::instrument_project(compile_commands, output_dir);
+   EXPECT_EQ(0u, cached.nr_instrumented);
+   EXPECT_EQ(2u, cached.nr_cached);
+
+   ASSERT_NO_THROW(scheduler::run_under_schedule(
+      cached.executable, {}, std::chrono::milliseconds(3000), output_dir / "records"));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST(InstrumentProjectTest, ReinstrumentsTheUnitsIncludingAChangedHeader)
+{
+   // Edit a copy of the project, not the test program itself
+   const auto output_dir = detail::test_data_dir / "project_header";
+   const auto project_dir = output_dir / "source";
+   boost::filesystem::remove_all(output_dir);
+   boost::filesystem::create_directories(project_dir);
+   for (const auto* file : {"counter.cpp", "counter.hpp", "main.cpp"})
+      boost::filesystem::copy_file(detail::test_programs_dir / "project" / file,
+                                   project_dir / file);
+
+   const auto compile_commands = output_dir / "compile_commands.json";
+   boost::filesystem::ofstream(compile_commands)
+      << R"([{"directory": ")" << project_dir.string() << R"(", "file": "counter.cpp", )"
+      << R"("arguments": ["c++", "-std=c++14", "-c", "counter.cpp"]},)"
+      << R"({"directory": ")" << project_dir.string() << R"(", "file": "main.cpp", )"
+      << R"("arguments": ["c++", "-std=c++14", "-c", "main.cpp"]}])";
+
+   EXPECT_EQ(2u, scheduler::instrument_project(compile_commands, output_dir).nr_instrumented);
+   boost::filesystem::ofstream(project_dir / "counter.hpp", std::ios::app)
+      << "int reset();\n";
+   const auto changed = scheduler::instrument_project(compile_commands, output_dir);
+   EXPECT_EQ(2u, changed.nr_instrumented);
+   EXPECT_EQ(0u, changed.nr_cached);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST(InstrumentProjectTest, WholeProgramInstrumentationRunsThrough)
+{
+   const auto project_dir = detail::test_programs_dir / "project";
+   const auto output_dir = detail::test_data_dir / "project_whole_program";
+   boost::filesystem::remove_all(output_dir);
+   boost::filesystem::create_directories(output_dir / "records");
+
+   const auto compile_commands = output_dir / "compile_commands.json";
+   boost::filesystem::ofstream(compile_commands)
+      << R"([{"directory": ")" << project_dir.string() << R"(", "file": "counter.cpp", )"
+      << R"("arguments": ["c++", "-std=c++14", "-c", "counter.cpp"]},)"
+      << R"({"directory": ")" << project_dir.string() << R"(", "file": "main.cpp", )"
+      << R"("arguments": ["c++", "-std=c++14", "-c", "main.cpp"]}])";
+
+   scheduler::project_options options;
+   options.whole_program = true;
+   const auto instrumented = scheduler::instrument_project(compile_commands, output_dir, options);
+   EXPECT_EQ(2u, instrumented.nr_instrumented);
+
+   ASSERT_NO_THROW(scheduler::run_under_schedule(
+      instrumented.executable, {}, std::chrono::milliseconds(3000), output_dir / "records"));
+
+   // nr_runs and the locals of main are only accessed by the main thread, counter is shared
+   std::size_t nr_shared = 0;
+   for (const auto& site : read_sites(output_dir / "records" / "sites.txt"))
+   {
+      std::istringstream fields(site);
+      std::string id, location, function, variable;
+      fields >> id >> location >> function >> variable;
+      EXPECT_NE("main", function) << site;
+      EXPECT_NE("nr_runs", variable) << site;
+      if (function == "_Z9incrementv" && variable.find("counter") != std::string::npos)
+         ++nr_shared;
+   }
+   EXPECT_LT(0u, nr_shared);
+}
+
 //--------------------------------------------------------------------------------------------------
 
 } // end namespace test
@@ -0,0 +1,50 @@
+
+#include <instrumentation_sites.hpp>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <sstream>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace record_replay {
+namespace test {
+
+TEST(SiteFilterTest, LastMatchingRuleDecidesForMemorySitesAndIsAppliedToRegisteredTables)
+{
+   // Registered tables are never unregistered, like those of an instrumented module
+   static const std::array<scheduler::instrumentation_site, 3> sites = {{
+      {0x1, 0, 0, 0, "src/queue.cpp", 10, "push", "head"},
+      {0x2, 0, 0, 1, "src/queue.cpp", 20, "pop", "tail"},
+      {0x3, 1, 0, 0, "src/pool.cpp", 30, "run", ""},
+   }};
+   static std::array<uint8_t, 3> enabled = {{1, 1, 1}};
+   scheduler::register_site_table({sites.data(), enabled.data(), 3});
+
+   scheduler::site_filter filter;
+   filter.add_rule("disable all");
+   filter.add_rule("enable file=queue.cpp");
+   filter.add_rule("disable variable=tail");
+   filter.add_rule("disable id=3");
+   scheduler::set_site_filter(filter);
+   EXPECT_EQ(1, enabled[0]);
+   EXPECT_EQ(0, enabled[1]);
+   // Lock sites always post
+   EXPECT_EQ(1, enabled[2]);
+
+   std::stringstream listing;
+   scheduler::write_sites(listing);
+   EXPECT_NE(std::string::npos,
+             listing.str().find("0000000000000002 src/queue.cpp:20 pop tail Store disabled"));
+
+   EXPECT_THROW(filter.add_rule("disable line=20"), std::invalid_argument);
+   EXPECT_THROW(filter.add_rule("enable id=xyz"), std::invalid_argument);
+   scheduler::set_site_filter(scheduler::site_filter());
+   EXPECT_EQ(1, enabled[1]);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace test
+} // end namespace record_replay
@@ -1,7 +1,12 @@
 
 #include "instrumentation_TEST.cpp"
+#include "instrumentation_sites_TEST.cpp"
 #include "scheduler_TEST.cpp"
+#include "task_pool_TEST.cpp"
+#include <chrome_trace_TEST.cpp>
+#include <compressed_stream_TEST.cpp>
 #include <execution_io_TEST.cpp>
+#include <mapped_execution_TEST.cpp>
 
 #include <gtest/gtest.h>
 
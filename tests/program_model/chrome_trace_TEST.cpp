@@ -0,0 +1,112 @@
+
+#include <chrome_trace.hpp>
+
+#include <gtest/gtest.h>
+
+#include <mutex>
+#include <pthread.h>
+#include <sstream>
+
+
+namespace program_model {
+namespace test {
+
+namespace {
+
+std::size_t count(const std::string& str, const std::string& pattern)
+{
+   std::size_t n = 0;
+   for (auto pos = str.find(pattern); pos != std::string::npos; pos = str.find(pattern, pos + 1))
+      ++n;
+   return n;
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+
+TEST(ChromeTraceTest, ShowsInstructionsLockHoldsAndBlockedPeriods)
+{
+   std::mutex mut_1;
+   const lock_instruction lock_0{0, lock_operation::Lock, Object(&mut_1), {"test_file", 1}};
+   const lock_instruction unlock_0{0, lock_operation::Unlock, Object(&mut_1), {"test_file", 2}};
+   const thread_management_instruction join_0{0, thread_management_operation::Join, Thread(1),
+                                              {"test_file", 3}};
+   const lock_instruction lock_1{1, lock_operation::Lock, Object(&mut_1), {"test_file", 4}};
+   const lock_instruction unlock_1{1, lock_operation::Unlock, Object(&mut_1), {"test_file", 5}};
+
+   const auto state = [](const Tids& enabled, const NextSet& next) {
+      return std::make_shared<State>(enabled, next);
+   };
+   Execution E{state({0, 1}, {{0, {lock_0, true}}, {1, {lock_1, true}}})};
+   E.push_back(lock_0, state({0}, {{0, {unlock_0, true}}, {1, {lock_1, false}}}));
+   E.push_back(unlock_0, state({1}, {{0, {join_0, false}}, {1, {lock_1, true}}}));
+   E.push_back(lock_1, state({1}, {{0, {join_0, false}}, {1, {unlock_1, true}}}));
+   E.push_back(unlock_1, state({0}, {{0, {join_0, true}}}));
+   E.push_back(join_0, state({}, {}));
+
+   std::stringstream trace;
+   write_chrome_trace(trace, E, {0, 1000, 2000, 3000, 4500, 5000});
+   const auto json = trace.str();
+
+   EXPECT_EQ(5u, count(json, R"("cat":"instruction")"));
+   EXPECT_EQ(2u, count(json, R"("cat":"lock")"));
+   // thread 1 waits for the lock during step 2, thread 0 for the join during steps 3 and 4
+   EXPECT_EQ(2u, count(json, R"("cat":"blocked")"));
+   EXPECT_EQ(1u, count(json, R"("name":"blocked on Join 1","ts":2.000,"dur":2.500)"));
+   EXPECT_EQ(1u, count(json, R"("location":"test_file:5")"));
+
+   // Without step times, every step takes a microsecond
+   std::stringstream untimed;
+   write_chrome_trace(untimed, E);
+   EXPECT_EQ(1u, count(untimed.str(), R"("name":"blocked on Join 1","ts":2.000,"dur":2.000)"));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Readers share a hold until the last of them unlocks, a TryLock holds the lock only if it
+/// was free, and a semaphore gets no track.
+
+TEST(ChromeTraceTest, ShowsSharedAndTriedLockHolds)
+{
+   pthread_rwlock_t rwlock;
+   int semaphore;
+   const auto instruction = [&rwlock](const Thread::tid_t tid, const lock_operation operation,
+                                      const unsigned int line) {
+      return lock_instruction{tid, operation, Object(&rwlock), {"test_file", line}};
+   };
+   const auto read_0 = instruction(0, lock_operation::ReadLock, 1);
+   const auto read_1 = instruction(1, lock_operation::TryReadLock, 2);
+   const auto try_2 = instruction(2, lock_operation::TryLock, 3);
+   const auto unlock_0 = instruction(0, lock_operation::Unlock, 4);
+   const auto unlock_1 = instruction(1, lock_operation::Unlock, 5);
+   const auto unlock_2 = instruction(2, lock_operation::Unlock, 6);
+   const lock_instruction post_0{0, lock_operation::SemPost, Object(&semaphore), {"test_file", 7}};
+
+   const auto state = [](const Thread::tid_t tid, const lock_instruction& next) {
+      return std::make_shared<State>(Tids{tid}, NextSet{{tid, {next, true}}});
+   };
+   Execution E{state(0, read_0)};
+   E.push_back(read_0, state(1, read_1));
+   E.push_back(read_1, state(2, try_2));
+   E.push_back(try_2, state(0, unlock_0));
+   E.push_back(unlock_0, state(1, unlock_1));
+   E.push_back(unlock_1, state(2, try_2));
+   E.push_back(try_2, state(2, unlock_2));
+   E.push_back(unlock_2, state(0, post_0));
+   E.push_back(post_0, std::make_shared<State>(Tids{}, NextSet{}));
+
+   std::stringstream trace;
+   write_chrome_trace(trace, E);
+   const auto json = trace.str();
+
+   EXPECT_EQ(1u, count(json, R"("cat":"shared lock","name":"read by threads 0, 1","ts":0.000,)"
+                             R"("dur":5.000)"));
+   EXPECT_EQ(1u, count(json, R"("cat":"lock","name":"held by thread 2","ts":5.000,"dur":2.000)"));
+   EXPECT_EQ(1u, count(json, R"("name":"thread_name","pid":2)"));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace test
+} // end namespace program_model
@@ -0,0 +1,181 @@
+
+#include <compressed_stream.hpp>
+#include <execution_io.hpp>
+#include <mapped_execution.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sstream>
+
+
+namespace program_model {
+namespace test {
+
+namespace {
+
+std::string compress(const std::string& data)
+{
+   std::stringstream stream;
+   {
+      compressed_ostream compressed(stream);
+      compressed << data;
+   }
+   return stream.str();
+}
+
+std::string decompress(const std::string& data)
+{
+   std::stringstream stream(data);
+   decompressed_istream decompressed(stream);
+   return std::string(std::istreambuf_iterator<char>(decompressed),
+                      std::istreambuf_iterator<char>());
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Repetitive data, like a record, compresses well, and data that does not compress is
+/// stored as is, across several blocks.
+
+TEST(CompressedStreamTest, RoundTrip)
+{
+   std::string repetitive;
+   for (int step = 0; repetitive.size() < 3 * compressed_format::block_size; ++step)
+   {
+      repetitive += "(" + std::to_string(step % 4) + ",Store,0x7ffee4c0,test_file.cpp:" +
+                    std::to_string(12 + step % 3) + ")\n";
+   }
+   const auto compressed = compress(repetitive);
+   EXPECT_LT(compressed.size() * 10, repetitive.size());
+   EXPECT_EQ(repetitive, decompress(compressed));
+   const auto whole = compressed_format::decompress(compressed.data(), compressed.size());
+   EXPECT_EQ(repetitive, std::string(whole.begin(), whole.end()));
+
+   std::mt19937 generator(2017);
+   std::string random(compressed_format::block_size + 100, '\0');
+   for (auto& c : random)
+      c = static_cast<char>(generator());
+   const auto stored = compress(random);
+   EXPECT_LT(stored.size(), random.size() + 64);
+   EXPECT_EQ(random, decompress(stored));
+
+   EXPECT_EQ("", decompress(compress("")));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief A frame written by the reference lz4 tool (1.9.4, with the options -BX --content-size
+/// adding block checksums and the content size) decompresses to the original data, including its
+/// overlapping matches.
+
+TEST(CompressedStreamTest, DecompressesReferenceLZ4Frame)
+{
+   std::string expected;
+   for (int step = 0; step < 8; ++step)
+   {
+      expected += "(" + std::to_string(step % 4) + ",Store,0x7ffee4c0,test_file.cpp:" +
+                  std::to_string(12 + step % 3) + ")\n";
+   }
+   const unsigned char frame[] = {
+      0x04, 0x22, 0x4d, 0x18, 0x7c, 0x40, 0x30, 0x01, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0xca, 0x61, 0x00, 0x00, 0x00, 0xff, 0x19, 0x28, 0x30, 0x2c,
+      0x53, 0x74, 0x6f, 0x72, 0x65, 0x2c, 0x30, 0x78, 0x37, 0x66, 0x66, 0x65,
+      0x65, 0x34, 0x63, 0x30, 0x2c, 0x74, 0x65, 0x73, 0x74, 0x5f, 0x66, 0x69,
+      0x6c, 0x65, 0x2e, 0x63, 0x70, 0x70, 0x3a, 0x31, 0x32, 0x29, 0x0a, 0x28,
+      0x31, 0x26, 0x00, 0x0e, 0x5f, 0x33, 0x29, 0x0a, 0x28, 0x32, 0x26, 0x00,
+      0x0e, 0x5f, 0x34, 0x29, 0x0a, 0x28, 0x33, 0x26, 0x00, 0x0e, 0x00, 0x72,
+      0x00, 0x0f, 0x98, 0x00, 0x0f, 0x00, 0x72, 0x00, 0x0f, 0x98, 0x00, 0x0f,
+      0x00, 0x72, 0x00, 0x0f, 0x98, 0x00, 0x0f, 0x00, 0x72, 0x00, 0x0f, 0x98,
+      0x00, 0x0d, 0x50, 0x3a, 0x31, 0x33, 0x29, 0x0a, 0x36, 0x4b, 0x5e, 0xcf,
+      0x00, 0x00, 0x00, 0x00, 0x26, 0xeb, 0x22, 0x22};
+   const std::string compressed(reinterpret_cast<const char*>(frame), sizeof(frame));
+
+   EXPECT_EQ(expected, decompress(compressed));
+   const auto whole = compressed_format::decompress(compressed.data(), compressed.size());
+   EXPECT_EQ(expected, std::string(whole.begin(), whole.end()));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief mapped_execution reads a compressed record.bin.
+
+TEST(CompressedStreamTest, MappedExecution)
+{
+   int var = 0;
+   const visible_instruction_t store =
+      memory_instruction{0, memory_operation::Store, Object(&var), false, {"test_file", 1}};
+   NextSet next = {{0, next_t{store, true}}};
+   const auto state = std::make_shared<State>(Tids{0}, next);
+   Execution execution_write{state};
+   for (int step = 0; step < 1000; ++step)
+      execution_write.push_back(store, state);
+
+   {
+      std::ofstream output_file("mapped_execution_TEST.bin", std::ios::binary);
+      compressed_ostream compressed(output_file);
+      write_binary(compressed, execution_write);
+   }
+
+   const mapped_execution mapped("mapped_execution_TEST.bin");
+   ASSERT_EQ(1000u, mapped.size());
+   EXPECT_EQ(1000u, mapped.thread_steps(0).size());
+   EXPECT_TRUE(mapped.to_execution() == execution_write);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Truncated and corrupt compressed data, blocks larger than the block maximum size and
+/// checksums that do not match are detected.
+
+TEST(CompressedStreamTest, RejectsCorruptData)
+{
+   std::string data;
+   for (int line = 0; line < 1000; ++line)
+      data += "line " + std::to_string(line % 10) + "\n";
+   const auto compressed = compress(data);
+
+   const auto truncated = compressed.substr(0, compressed.size() / 2);
+   EXPECT_THROW(compressed_format::decompress(truncated.data(), truncated.size()),
+                std::runtime_error);
+   std::stringstream stream(truncated);
+   decompressed_istream decompressed(stream);
+   std::string line;
+   while (std::getline(decompressed, line))
+   {
+   }
+   EXPECT_TRUE(decompressed.bad());
+
+   // The frame descriptor is 7 bytes, followed by the size of the first block
+   auto corrupt = compressed;
+   corrupt[7 + 4] = static_cast<char>(0xff);
+   EXPECT_THROW(compressed_format::decompress(corrupt.data(), corrupt.size()), std::runtime_error);
+
+   auto oversized = compressed;
+   std::fill(oversized.begin() + 7, oversized.begin() + 7 + 4, static_cast<char>(0x7f));
+   EXPECT_THROW(compressed_format::decompress(oversized.data(), oversized.size()),
+                std::runtime_error);
+
+   auto checksum = compressed;
+   checksum.back() = static_cast<char>(~checksum.back());
+   EXPECT_THROW(compressed_format::decompress(checksum.data(), checksum.size()),
+                std::runtime_error);
+   std::stringstream checksum_stream(checksum);
+   decompressed_istream checksum_decompressed(checksum_stream);
+   while (std::getline(checksum_decompressed, line))
+   {
+   }
+   EXPECT_TRUE(checksum_decompressed.bad());
+
+   std::stringstream text("State {0} {}");
+   EXPECT_THROW(decompressed_istream{text}, std::runtime_error);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace test
+} // end namespace program_model
@@ -0,0 +1,232 @@
+
+#include <execution_io.hpp>
+#include <mapped_execution.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+
+namespace program_model {
+namespace test {
+
+/// @brief An Execution written by write_binary and mapped is the same Execution, and its views
+/// give access to the transitions and states without decoding the whole file.
+
+TEST(MappedExecutionTest, BinaryRoundTrip)
+{
+   int var = 0;
+   std::mutex mut;
+
+   NextSet next_0 = {
+      {0, next_t{thread_management_instruction{0, thread_management_operation::Spawn, Thread(1),
+                                               {"test_file", 1}},
+                 true}},
+   };
+   const auto state_0 = std::make_shared<State>(Tids{0}, next_0);
+
+   NextSet next_1 = {
+      {0, next_t{lock_instruction{0, lock_operation::Lock, Object(&mut), {"test_file", 2}}, true}},
+      {1, next_t{memory_instruction{1, memory_operation::Store, Object(&var), true,
+                                    {"other_file", 3}},
+                 true}}};
+   const auto state_1 = std::make_shared<State>(Tids{0, 1}, next_1);
+
+   NextSet next_2 = {
+      {0, next_t{lock_instruction{0, lock_operation::Lock, Object(&mut), {"test_file", 2}}, true}}};
+   const auto state_2 = std::make_shared<State>(Tids{0}, next_2);
+
+   Execution execution_write{state_0};
+   execution_write.push_back(next_0[0].instr, state_1);
+   execution_write.push_back(next_1[1].instr, state_2);
+   execution_write.push_back(next_2[0].instr, state_2);
+   execution_write.set_status(Execution::Status::DONE);
+
+   {
+      std::ofstream output_file("mapped_execution_TEST.bin", std::ios::binary);
+      write_binary(output_file, execution_write);
+   }
+
+   const mapped_execution mapped("mapped_execution_TEST.bin");
+   ASSERT_EQ(3u, mapped.size());
+   EXPECT_EQ(Execution::Status::DONE, mapped.status());
+
+   const auto store = mapped[2];
+   EXPECT_EQ(1, store.tid());
+   EXPECT_EQ("other_file", mapped.string(store.encoded_instr().file_name));
+   EXPECT_TRUE(store.instr() == next_1[1].instr);
+   EXPECT_TRUE(store.pre().is_enabled(1));
+   EXPECT_FALSE(store.post().is_enabled(1));
+   EXPECT_FALSE(store.post().next(1));
+   EXPECT_TRUE(store.post().next(0)->instr == next_2[0].instr);
+
+   std::vector<Thread::tid_t> tids;
+   for (const auto& transition : mapped)
+      tids.push_back(transition.tid());
+   EXPECT_EQ((std::vector<Thread::tid_t>{0, 1, 0}), tids);
+
+   auto execution_read = mapped.to_execution();
+   EXPECT_TRUE(execution_read == execution_write);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief The index of a record file gives the steps of each thread and object, and the state
+/// after each step, without scanning the transitions.
+
+TEST(MappedExecutionTest, IndexedQueries)
+{
+   int var = 0;
+   std::mutex mut;
+
+   const visible_instruction_t spawn =
+      thread_management_instruction{0, thread_management_operation::Spawn, Thread(1), {"file", 1}};
+   const visible_instruction_t lock =
+      lock_instruction{0, lock_operation::Lock, Object(&mut), {"file", 2}};
+   const visible_instruction_t store =
+      memory_instruction{1, memory_operation::Store, Object(&var), false, {"file", 3}};
+   const visible_instruction_t load =
+      memory_instruction{0, memory_operation::Load, Object(&var), false, {"file", 4}};
+
+   NextSet next_0 = {{0, next_t{spawn, true}}};
+   const auto state_0 = std::make_shared<State>(Tids{0}, next_0);
+   NextSet next_1 = {{0, next_t{lock, true}}, {1, next_t{store, true}}};
+   const auto state_1 = std::make_shared<State>(Tids{0, 1}, next_1);
+   NextSet next_2 = {{0, next_t{load, true}}, {1, next_t{store, true}}};
+   const auto state_2 = std::make_shared<State>(Tids{0, 1}, next_2);
+   NextSet next_3 = {{0, next_t{load, true}}};
+   const auto state_3 = std::make_shared<State>(Tids{0}, next_3);
+   const auto state_4 = std::make_shared<State>(Tids{}, NextSet{});
+
+   Execution execution{state_0};
+   execution.push_back(spawn, state_1);
+   execution.push_back(lock, state_2);
+   execution.push_back(store, state_3);
+   execution.push_back(load, state_4);
+
+   {
+      std::ofstream output_file("mapped_execution_TEST.bin", std::ios::binary);
+      write_binary(output_file, execution);
+   }
+
+   using steps_t = std::vector<uint32_t>;
+   const mapped_execution mapped("mapped_execution_TEST.bin");
+   ASSERT_TRUE(mapped.has_index());
+   const auto steps_0 = mapped.thread_steps(0);
+   EXPECT_EQ((steps_t{1, 2, 4}), steps_t(steps_0.begin(), steps_0.end()));
+   const auto steps_1 = mapped.thread_steps(1);
+   EXPECT_EQ((steps_t{3}), steps_t(steps_1.begin(), steps_1.end()));
+   EXPECT_TRUE(mapped.thread_steps(2).empty());
+
+   const auto steps_var = mapped.object_steps(Object(&var));
+   EXPECT_EQ((steps_t{3, 4}), steps_t(steps_var.begin(), steps_var.end()));
+   const auto steps_mut = mapped.object_steps(Object(&mut));
+   EXPECT_EQ((steps_t{2}), steps_t(steps_mut.begin(), steps_mut.end()));
+   EXPECT_TRUE(mapped.object_steps(Object(&execution)).empty());
+
+   EXPECT_TRUE(*mapped.state_after(0).decode() == *state_0);
+   EXPECT_TRUE(*mapped.state_after(2).decode() == *state_2);
+   EXPECT_EQ(0u, mapped.state_after(4).nr_enabled());
+   EXPECT_THROW(mapped.state_after(5), std::out_of_range);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Mapping a file that is not a record file throws.
+
+TEST(MappedExecutionTest, RejectsOtherFiles)
+{
+   {
+      std::ofstream output_file("mapped_execution_TEST.bin", std::ios::binary);
+      output_file << "State {0} {}\n=====\nDONE";
+      output_file << std::string(64, '\0');
+   }
+   EXPECT_THROW(mapped_execution("mapped_execution_TEST.bin"), std::runtime_error);
+   EXPECT_THROW(mapped_execution("does_not_exist.bin"), std::runtime_error);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Mapping a truncated record file or one with a corrupt header throws
+/// std::runtime_error, and so does accessing a corrupt instruction or state of a mapped file.
+
+TEST(MappedExecutionTest, RejectsTruncatedAndCorruptFiles)
+{
+   int var = 0;
+   const visible_instruction_t store =
+      memory_instruction{0, memory_operation::Store, Object(&var), false, {"test_file", 1}};
+   NextSet next = {{0, next_t{store, true}}};
+   const auto state = std::make_shared<State>(Tids{0}, next);
+   Execution execution{state};
+   execution.push_back(store, state);
+   execution.push_back(store, state);
+
+   std::stringstream stream;
+   write_binary(stream, execution);
+   const std::string record = stream.str();
+   record_format::file_header header;
+   std::memcpy(&header, record.data(), sizeof(header));
+
+   const auto map = [](const std::string& data) {
+      {
+         std::ofstream output_file("mapped_execution_TEST.bin", std::ios::binary);
+         output_file << data;
+      }
+      mapped_execution mapped("mapped_execution_TEST.bin");
+   };
+   // Maps data, expecting the header to be valid, and decodes the whole execution
+   const auto decode = [](const std::string& data) {
+      {
+         std::ofstream output_file("mapped_execution_TEST.bin", std::ios::binary);
+         output_file << data;
+      }
+      std::unique_ptr<mapped_execution> mapped;
+      EXPECT_NO_THROW(mapped.reset(new mapped_execution("mapped_execution_TEST.bin")));
+      if (mapped)
+         mapped->to_execution();
+   };
+   ASSERT_NO_THROW(decode(record));
+
+   EXPECT_THROW(map(record.substr(0, record.size() / 2)), std::runtime_error);
+
+   // Corrupts the instruction of the first transition
+   const auto instruction_offset =
+      header.transitions + offsetof(record_format::transition_t, instruction);
+   record_format::instruction_t instruction;
+   std::memcpy(&instruction, &record[instruction_offset], sizeof(instruction));
+   const auto with_instruction = [&](const record_format::instruction_t& corrupt) {
+      auto corrupt_record = record;
+      std::memcpy(&corrupt_record[instruction_offset], &corrupt, sizeof(corrupt));
+      return corrupt_record;
+   };
+   auto corrupt = instruction;
+   corrupt.file_name = 100;
+   EXPECT_THROW(decode(with_instruction(corrupt)), std::runtime_error);
+   corrupt = instruction;
+   corrupt.operation = 100;
+   EXPECT_THROW(decode(with_instruction(corrupt)), std::runtime_error);
+   corrupt = instruction;
+   corrupt.kind = 3;
+   EXPECT_THROW(decode(with_instruction(corrupt)), std::runtime_error);
+
+   // Corrupts the post state of the first transition
+   auto corrupt_post = record;
+   const uint64_t post = record.size();
+   std::memcpy(&corrupt_post[header.transitions + offsetof(record_format::transition_t, post)],
+               &post, sizeof(post));
+   EXPECT_THROW(decode(corrupt_post), std::runtime_error);
+
+   auto misaligned = record;
+   header.transitions += 4;
+   std::memcpy(&misaligned[0], &header, sizeof(header));
+   EXPECT_THROW(map(misaligned), std::runtime_error);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace test
+} // end namespace program_model
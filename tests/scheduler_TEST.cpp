@@ -1,13 +1,23 @@
 
 #include "include/test_helpers.hpp"
 
+#include <bounded_search.hpp>
+#include <execution_io.hpp>
+#include <prng.hpp>
 #include <replay.hpp>
+#include <scheduler_settings.hpp>
+#include <strategies/pct.hpp>
 
 #include <gtest/gtest.h>
 
 #include <boost/filesystem.hpp>
 
 #include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
 
 //--------------------------------------------------------------------------------------------------
 
@@ -46,10 +56,326 @@ INSTANTIATE_TEST_CASE_P(
    RealWorldPrograms, SchedulerDeadlockSanitityCheck,
    ::testing::Values(                                                                       //
       InstrumentedProgramTestData{"real_world/dining_philosophers.cpp", "3", "-std=c++14"}, //
+      InstrumentedProgramTestData{"real_world/producer_consumer.cpp", "3", "-std=c++14"},   //
+      InstrumentedProgramTestData{"real_world/readers_writers.cpp", "3", "-std=c++14"},     //
       InstrumentedProgramTestData{"real_world/work_stealing_queue.cpp", "3", "-std=c++14"}  //
       ));
 
 //--------------------------------------------------------------------------------------------------
 
+TEST(SchedulerCheckpointTest, BranchesFromCheckpointRunThrough)
+{
+   const auto output_dir = detail::test_data_dir / "checkpoint";
+   const auto instrumented_executable = scheduler::instrument(
+      detail::test_programs_dir / "real_world/dining_philosophers.cpp", output_dir / "instrumented",
+      "0", "-std=c++14");
+
+   scheduler::run_under_schedule(instrumented_executable, {},
+                                 scheduler::SchedulerSettings("NonPreemptive", 4),
+                                 std::chrono::milliseconds(3000), output_dir / "records");
+
+   for (int i = 0; i < 10; ++i)
+      ASSERT_EQ(0, scheduler::run_from_checkpoint({}, output_dir / "records"));
+
+   scheduler::release_checkpoint();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Whichever step the checkpoint is taken at, the re-created threads continue on intact
+/// frames and return from their start routine (restored_threads.c exits with 1 otherwise).
+
+TEST(SchedulerCheckpointTest, RestoredThreadsReturnFromTheirStartRoutine)
+{
+   const auto output_dir = detail::test_data_dir / "restored_threads";
+   const auto instrumented_executable = scheduler::instrument(
+      detail::test_programs_dir / "restored_threads.c", output_dir / "instrumented", "0", "");
+
+   scheduler::run_under_schedule(instrumented_executable, {},
+                                 scheduler::SchedulerSettings("NonPreemptive"),
+                                 std::chrono::milliseconds(3000), output_dir / "records");
+   program_model::Execution execution;
+   {
+      std::ifstream record((output_dir / "records" / "record.txt").string());
+      record >> execution;
+   }
+   ASSERT_LT(1u, execution.size());
+
+   for (unsigned int step = 1; step < execution.size(); ++step)
+   {
+      scheduler::run_under_schedule(instrumented_executable, {},
+                                    scheduler::SchedulerSettings("NonPreemptive", step),
+                                    std::chrono::milliseconds(3000), output_dir / "records");
+      for (int branch = 0; branch < 2; ++branch)
+      {
+         ASSERT_EQ(0, scheduler::run_from_checkpoint({}, output_dir / "records"))
+            << "checkpoint at step " << step;
+      }
+      scheduler::release_checkpoint();
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief A thread spinning on an object that is only written at a disabled site is not taken
+/// for deadlocked: its Await is woken once no other thread is enabled.
+
+TEST(SchedulerAwaitTest, AwaitIsWokenWithoutAVisibleWrite)
+{
+   const auto output_dir = detail::test_data_dir / "uninstrumented_writer";
+   boost::filesystem::create_directories(output_dir / "records");
+   const auto instrumented_executable = scheduler::instrument(
+      detail::test_programs_dir / "uninstrumented_writer.c", output_dir / "instrumented", "0", "");
+   const auto site_filter = boost::filesystem::absolute(output_dir / "site_filter.txt");
+   std::ofstream(site_filter.string()) << "disable function=set_flag\n";
+
+   auto settings = scheduler::SchedulerSettings("NonPreemptive");
+   settings.set_site_filter(site_filter);
+   scheduler::run_under_schedule(instrumented_executable, {}, settings,
+                                 std::chrono::milliseconds(3000), output_dir / "records");
+   program_model::Execution execution;
+   {
+      std::ifstream record((output_dir / "records" / "record.txt").string());
+      record >> execution;
+   }
+   EXPECT_EQ(program_model::Execution::Status::DONE, execution.status());
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief A thread spawned by a thread other than main waits in its first visible instruction until
+/// its spawning thread registered it, after which it runs on its cached registration.
+
+TEST(SchedulerRegistrationTest, ThreadsSpawnedByRegisteredThreadsRunThrough)
+{
+   const auto output_dir = detail::test_data_dir / "nested_spawn";
+   const auto instrumented_executable = scheduler::instrument(
+      detail::test_programs_dir / "nested_spawn.c", output_dir / "instrumented", "0", "");
+
+   for (uint64_t seed = 0; seed < 20; ++seed)
+   {
+      auto settings = scheduler::SchedulerSettings("Random");
+      settings.set_seed(seed);
+      scheduler::run_under_schedule(instrumented_executable, {}, settings,
+                                    std::chrono::milliseconds(3000), output_dir / "records");
+      program_model::Execution execution;
+      {
+         std::ifstream record((output_dir / "records" / "record.txt").string());
+         record >> execution;
+      }
+      ASSERT_EQ(program_model::Execution::Status::DONE, execution.status()) << "seed " << seed;
+      std::set<program_model::Thread::tid_t> tids;
+      for (program_model::Execution::index_t index = 1; index <= execution.size(); ++index)
+         tids.insert(boost::apply_visitor(program_model::get_tid(), execution[index].instr()));
+      // main, two parents and two children per parent
+      EXPECT_EQ(7u, tids.size()) << "seed " << seed;
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief The Scheduler writes its records to the output_dir of its settings, from where
+/// run_under_schedule moves them to the output directory of the run.
+
+TEST(SchedulerSettingsTest, RecordsAreMovedFromTheOutputDirOfTheSettings)
+{
+   const auto output_dir = detail::test_data_dir / "settings_output_dir";
+   const auto scheduler_output_dir = boost::filesystem::absolute(output_dir / "scheduler_output");
+   boost::filesystem::remove_all(output_dir / "records");
+   boost::filesystem::create_directories(scheduler_output_dir);
+   const auto instrumented_executable = scheduler::instrument(
+      detail::test_programs_dir / "nested_spawn.c", output_dir / "instrumented", "0", "");
+
+   auto settings = scheduler::SchedulerSettings("NonPreemptive");
+   settings.set_output_dir(scheduler_output_dir);
+   scheduler::run_under_schedule(instrumented_executable, {}, settings,
+                                 std::chrono::milliseconds(3000), output_dir / "records");
+   for (const auto* record : {"record.txt", "record_settings.txt", "sites.txt"})
+   {
+      EXPECT_TRUE(boost::filesystem::exists(output_dir / "records" / record)) << record;
+      EXPECT_FALSE(boost::filesystem::exists(scheduler_output_dir / record)) << record;
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST(BoundedSearchTest, PreemptionBoundOneFindsDiningPhilosophersDeadlock)
+{
+   const auto output_dir = detail::test_data_dir / "bounded_search";
+   const auto instrumented_executable = scheduler::instrument(
+      detail::test_programs_dir / "real_world/dining_philosophers.cpp", output_dir / "instrumented",
+      "0", "-std=c++14");
+
+   unsigned int nr_deadlocks = 0;
+   const auto count_deadlocks = [&nr_deadlocks](const program_model::Execution& execution) {
+      if (execution.status() == program_model::Execution::Status::DEADLOCK)
+         ++nr_deadlocks;
+   };
+
+   const auto nr_executions_0 =
+      scheduler::explore_bounded(instrumented_executable, scheduler::bounding::bound_t::Preemption,
+                                 0, count_deadlocks, std::chrono::milliseconds(3000),
+                                 output_dir / "records");
+   EXPECT_EQ(0u, nr_deadlocks);
+
+   const auto nr_executions_1 =
+      scheduler::explore_bounded(instrumented_executable, scheduler::bounding::bound_t::Preemption,
+                                 1, count_deadlocks, std::chrono::milliseconds(3000),
+                                 output_dir / "records");
+   EXPECT_LT(0u, nr_executions_0);
+   EXPECT_LT(nr_executions_0, nr_executions_1);
+   EXPECT_LT(0u, nr_deadlocks);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Two threads that each take two steps and never block have 6 interleavings: aabb and
+/// bbaa without preemptions, abba and baab with one, and abab and baba with two.
+
+TEST(BoundedSearchTest, ExploresEachScheduleWithinTheBoundOnce)
+{
+   using tid_t = program_model::Thread::tid_t;
+   int object = 0;
+   const auto store = [&object](const tid_t tid) {
+      return program_model::visible_instruction_t(program_model::memory_instruction(
+         tid, program_model::memory_operation::Store, program_model::Object(&object), false));
+   };
+   // Completes a prefix as PreemptionBounded does
+   const auto run = [&store](const scheduler::schedule_t& prefix) {
+      std::map<tid_t, unsigned int> nr_steps{{0, 2}, {1, 2}};
+      const auto state = [&nr_steps, &store] {
+         program_model::Tids enabled;
+         program_model::NextSet next;
+         for (const auto& thread : nr_steps)
+         {
+            if (thread.second == 0)
+               continue;
+            enabled.insert(thread.first);
+            next.emplace(thread.first, program_model::next_t{store(thread.first), true});
+         }
+         return std::make_shared<program_model::State>(enabled, next);
+      };
+      program_model::Execution execution{state()};
+      boost::optional<tid_t> current;
+      for (std::size_t step = 0; !state()->enabled().empty(); ++step)
+      {
+         const auto tid = step < prefix.size()
+                             ? prefix[step]
+                             : scheduler::bounding::default_choice(
+                                  scheduler::bounding::bound_t::Preemption,
+                                  state()->enabled(), current);
+         --nr_steps[tid];
+         execution.push_back(store(tid), state());
+         current = tid;
+      }
+      return execution;
+   };
+
+   std::set<scheduler::schedule_t> schedules;
+   const auto collect = [&schedules](const program_model::Execution& execution) {
+      EXPECT_TRUE(schedules.insert(scheduler::schedule(execution)).second);
+   };
+   const auto explore = [&](const unsigned int bound) {
+      schedules.clear();
+      return scheduler::explore_bounded(run, scheduler::bounding::bound_t::Preemption, bound,
+                                        collect);
+   };
+   EXPECT_EQ(2u, explore(0));
+   EXPECT_EQ(4u, explore(1));
+   EXPECT_EQ(6u, explore(2));
+   EXPECT_EQ(6u, explore(3));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST(PCTStrategyTest, RunIsReproducibleFromSeedDepthAndNrSteps)
+{
+   const auto output_dir = detail::test_data_dir / "pct";
+   const auto instrumented_executable = scheduler::instrument(
+      detail::test_programs_dir / "real_world/work_stealing_queue.cpp", output_dir / "instrumented",
+      "0", "-std=c++14");
+
+   const auto read_record = [&output_dir] {
+      std::ifstream record((output_dir / "records" / "record_short.txt").string());
+      std::stringstream stream;
+      stream << record.rdbuf();
+      return stream.str();
+   };
+
+   auto settings = scheduler::SchedulerSettings("PCT");
+   settings.set_seed(2017).set_depth(3).set_nr_steps(50);
+   scheduler::run_under_schedule(instrumented_executable, {}, settings,
+                                 std::chrono::milliseconds(3000), output_dir / "records");
+   const auto first = read_record();
+   scheduler::run_under_schedule(instrumented_executable, {}, settings,
+                                 std::chrono::milliseconds(3000), output_dir / "records");
+   EXPECT_EQ(first, read_record());
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief PCT draws only from prng, so its selections for a seed are the same with every
+/// standard library.
+
+TEST(PCTStrategyTest, SelectionsArePinnedBySeed)
+{
+   scheduler::TaskPool pool;
+   scheduler::PCT pct(2017, 3, 10);
+   std::vector<program_model::Thread::tid_t> selections;
+   for (unsigned int task_nr = 1; task_nr <= 10; ++task_nr)
+      selections.push_back(pct.select(pool, {0, 1, 2}, task_nr).second);
+   EXPECT_EQ((std::vector<program_model::Thread::tid_t>{0, 1, 1, 2, 2, 2, 2, 2, 2, 2}),
+             selections);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST(PrngTest, DrawsAreDeterminedBySeedAndWithinBound)
+{
+   scheduler::prng random(2017);
+   scheduler::prng same_seed(2017);
+   std::vector<unsigned int> counts(3, 0);
+   for (unsigned int i = 0; i < 3000; ++i)
+   {
+      const auto draw = random.below(counts.size());
+      ASSERT_EQ(draw, same_seed.below(counts.size()));
+      ASSERT_LT(draw, counts.size());
+      ++counts[draw];
+   }
+   for (const auto count : counts)
+   {
+      EXPECT_GT(count, 0u);
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST(SchedulerSettingsTest, ReadsWrittenSettingsWithEnvironmentOverrides)
+{
+   boost::filesystem::create_directories(detail::test_data_dir);
+   const auto filename = (detail::test_data_dir / "settings.txt").string();
+   {
+      auto settings = scheduler::SchedulerSettings("PCT", 5u);
+      settings.set_seed(2017).set_depth(2).set_output_dir("records").set_site_filter("sites.txt");
+      settings.set_trace_codec(scheduler::trace_codec_t::LZ4);
+      std::ofstream ofs(filename);
+      ofs << settings;
+   }
+   setenv(scheduler::SchedulerSettings::environment_variable("depth").c_str(), "4", 1);
+   const auto settings = scheduler::SchedulerSettings::read_from_file(filename);
+   unsetenv(scheduler::SchedulerSettings::environment_variable("depth").c_str());
+
+   EXPECT_EQ("PCT", settings.strategy_tag());
+   EXPECT_EQ(5u, *settings.checkpoint());
+   EXPECT_EQ(2017u, *settings.seed());
+   EXPECT_EQ(4u, settings.depth());
+   EXPECT_EQ(boost::filesystem::path("records"), settings.output_dir());
+   EXPECT_EQ(scheduler::trace_format_t::Text, settings.trace_format());
+   EXPECT_EQ(scheduler::trace_codec_t::LZ4, settings.trace_codec());
+   EXPECT_EQ(boost::filesystem::path("sites.txt"), settings.site_filter());
+}
+
+//--------------------------------------------------------------------------------------------------
+
 } // end namespace test
 } // end namespace record_replay
@@ -0,0 +1,224 @@
+
+#include <task_pool.hpp>
+
+#include <gtest/gtest.h>
+
+#include <pthread.h>
+#include <semaphore.h>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace record_replay {
+namespace test {
+
+/// @brief A ReadLock is only disabled by an exclusive holder, a Lock by any holder, and a TryLock
+/// never.
+
+TEST(TaskPoolTest, ReadersWriterLockRequestsAreEnabledByTheLockState)
+{
+   using namespace program_model;
+   pthread_rwlock_t rwlock;
+   const auto instruction = [&rwlock](const Thread::tid_t tid, const lock_operation operation) {
+      return visible_instruction_t(lock_instruction(tid, operation, Object(&rwlock)));
+   };
+   const auto perform = [](scheduler::TaskPool& pool, const Thread::tid_t tid) {
+      pool.set_current(tid);
+      pool.yield(tid);
+   };
+
+   scheduler::TaskPool pool;
+   for (Thread::tid_t tid = 0; tid < 3; ++tid)
+      pool.register_thread(tid);
+
+   pool.post(0, instruction(0, lock_operation::ReadLock));
+   perform(pool, 0);
+   pool.post(1, instruction(1, lock_operation::ReadLock));
+   pool.post(2, instruction(2, lock_operation::Lock));
+   EXPECT_EQ(Thread::Status::ENABLED, pool.status_protected(1));
+   EXPECT_EQ(Thread::Status::DISABLED, pool.status_protected(2));
+
+   perform(pool, 1);
+   pool.post(0, instruction(0, lock_operation::Unlock));
+   pool.post(1, instruction(1, lock_operation::Unlock));
+   perform(pool, 0);
+   EXPECT_EQ(Thread::Status::DISABLED, pool.status_protected(2));
+   perform(pool, 1);
+   EXPECT_EQ(Thread::Status::ENABLED, pool.status_protected(2));
+
+   perform(pool, 2);
+   pool.post(0, instruction(0, lock_operation::ReadLock));
+   pool.post(1, instruction(1, lock_operation::TryLock));
+   EXPECT_EQ(Thread::Status::DISABLED, pool.status_protected(0));
+   EXPECT_EQ(Thread::Status::ENABLED, pool.status_protected(1));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief A CondWait is disabled until a CondSignal or CondBroadcast wakes it, and an Await until
+/// a Store to the object it spins on, so that waiting threads are not scheduled.
+
+TEST(TaskPoolTest, WaitsAreDisabledUntilWoken)
+{
+   using namespace program_model;
+   pthread_cond_t cond;
+   int flag = 0;
+   const auto cond_instruction = [&cond](const Thread::tid_t tid, const lock_operation operation) {
+      return visible_instruction_t(lock_instruction(tid, operation, Object(&cond)));
+   };
+   const auto flag_instruction = [&flag](const Thread::tid_t tid,
+                                         const memory_operation operation) {
+      return visible_instruction_t(memory_instruction(tid, operation, Object(&flag), false));
+   };
+   const auto perform = [](scheduler::TaskPool& pool, const Thread::tid_t tid) {
+      pool.set_current(tid);
+      pool.yield(tid);
+   };
+
+   scheduler::TaskPool pool;
+   for (Thread::tid_t tid = 0; tid < 3; ++tid)
+      pool.register_thread(tid);
+
+   pool.post(0, cond_instruction(0, lock_operation::CondWait));
+   pool.post(1, cond_instruction(1, lock_operation::CondWait));
+   pool.post(2, cond_instruction(2, lock_operation::CondSignal));
+   EXPECT_EQ(Thread::Status::DISABLED, pool.status_protected(0));
+   EXPECT_EQ(Thread::Status::DISABLED, pool.status_protected(1));
+   perform(pool, 2);
+   EXPECT_EQ(Thread::Status::ENABLED, pool.status_protected(0));
+   EXPECT_EQ(Thread::Status::DISABLED, pool.status_protected(1));
+
+   perform(pool, 0);
+   pool.post(0, flag_instruction(0, memory_operation::Await));
+   pool.post(2, cond_instruction(2, lock_operation::CondBroadcast));
+   perform(pool, 2);
+   EXPECT_EQ(Thread::Status::ENABLED, pool.status_protected(1));
+   EXPECT_EQ(Thread::Status::DISABLED, pool.status_protected(0));
+
+   pool.post(2, flag_instruction(2, memory_operation::Load));
+   perform(pool, 2);
+   EXPECT_EQ(Thread::Status::DISABLED, pool.status_protected(0));
+   pool.post(2, flag_instruction(2, memory_operation::Store));
+   perform(pool, 2);
+   EXPECT_EQ(Thread::Status::ENABLED, pool.status_protected(0));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief An Await that no Store wakes, as the object is written where the scheduler does not see
+/// it, is woken after TaskPool::await_rounds rounds, or in the first round without an enabled
+/// thread.
+
+TEST(TaskPoolTest, AwaitsAreWokenWithoutAVisibleWrite)
+{
+   using namespace program_model;
+   int flag = 0;
+   int other = 0;
+   const auto instruction = [](const Thread::tid_t tid, const memory_operation operation,
+                               int& object) {
+      return visible_instruction_t(memory_instruction(tid, operation, Object(&object), false));
+   };
+
+   scheduler::TaskPool pool;
+   for (Thread::tid_t tid = 0; tid < 2; ++tid)
+      pool.register_thread(tid);
+
+   pool.post(0, instruction(0, memory_operation::Await, flag));
+   pool.post(1, instruction(1, memory_operation::Load, other));
+   for (unsigned int round = 1; round < scheduler::TaskPool::await_rounds; ++round)
+   {
+      pool.wake_stale_awaits();
+      ASSERT_EQ(Thread::Status::DISABLED, pool.status_protected(0)) << "round " << round;
+   }
+   pool.wake_stale_awaits();
+   EXPECT_EQ(Thread::Status::ENABLED, pool.status_protected(0));
+
+   pool.set_current(0);
+   pool.yield(0);
+   pool.post(0, instruction(0, memory_operation::Await, flag));
+   pool.set_current(1);
+   pool.yield(1);
+   pool.finish(1);
+   EXPECT_EQ(Thread::Status::DISABLED, pool.status_protected(0));
+   pool.wake_stale_awaits();
+   EXPECT_EQ(Thread::Status::ENABLED, pool.status_protected(0));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief TaskPool::enabled follows the status changes of the posts and stays sorted whatever
+/// the order in which threads post.
+
+TEST(TaskPoolTest, EnabledTidsFollowStatusChanges)
+{
+   using namespace program_model;
+   pthread_mutex_t mutex;
+   const auto instruction = [&mutex](const Thread::tid_t tid, const lock_operation operation) {
+      return visible_instruction_t(lock_instruction(tid, operation, Object(&mutex)));
+   };
+   using enabled_t = scheduler::TaskPool::enabled_t;
+
+   scheduler::TaskPool pool;
+   for (Thread::tid_t tid = 0; tid < 4; ++tid)
+      pool.register_thread(tid);
+   EXPECT_TRUE(pool.enabled().empty());
+
+   pool.post(2, instruction(2, lock_operation::Lock));
+   pool.post(0, instruction(0, lock_operation::Lock));
+   pool.post(3, instruction(3, lock_operation::Lock));
+   EXPECT_EQ((enabled_t{0, 2, 3}), pool.enabled());
+
+   pool.set_current(2);
+   pool.yield(2);
+   EXPECT_EQ((enabled_t{2}), pool.enabled());
+   pool.post(1, instruction(1, lock_operation::Lock));
+   pool.post(2, instruction(2, lock_operation::Unlock));
+   EXPECT_EQ((enabled_t{2}), pool.enabled());
+
+   pool.set_current(2);
+   pool.yield(2);
+   pool.finish(2);
+   EXPECT_EQ((enabled_t{0, 1, 3}), pool.enabled());
+   EXPECT_EQ((Tids{0, 1, 3}), pool.enabled_set());
+}
+
+//--------------------------------------------------------------------------------------------------
+
+// macOS does not implement unnamed semaphores
+#ifndef __APPLE__
+
+/// @brief A SemWait is disabled while the semaphore's value, initially read from the semaphore,
+/// is 0, so that a thread waiting for a SemPost is not scheduled.
+
+TEST(TaskPoolTest, SemaphoreWaitsAreDisabledUntilPosted)
+{
+   using namespace program_model;
+   sem_t semaphore;
+   ASSERT_EQ(0, sem_init(&semaphore, 0, 1));
+   const auto instruction = [&semaphore](const Thread::tid_t tid, const lock_operation operation) {
+      return visible_instruction_t(lock_instruction(tid, operation, Object(&semaphore)));
+   };
+
+   scheduler::TaskPool pool;
+   for (Thread::tid_t tid = 0; tid < 3; ++tid)
+      pool.register_thread(tid);
+
+   pool.post(0, instruction(0, lock_operation::SemWait));
+   EXPECT_EQ(Thread::Status::ENABLED, pool.status_protected(0));
+   pool.set_current(0);
+   pool.yield(0);
+   pool.post(1, instruction(1, lock_operation::SemWait));
+   pool.post(2, instruction(2, lock_operation::SemPost));
+   EXPECT_EQ(Thread::Status::DISABLED, pool.status_protected(1));
+
+   pool.set_current(2);
+   pool.yield(2);
+   EXPECT_EQ(Thread::Status::ENABLED, pool.status_protected(1));
+   sem_destroy(&semaphore);
+}
+
+#endif
+
+//--------------------------------------------------------------------------------------------------
+
+} // end namespace test
+} // end namespace record_replay
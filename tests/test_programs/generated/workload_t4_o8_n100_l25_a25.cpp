@@ -0,0 +1,83 @@
+
+//--------------------------------------------------------------------------------------------------
+/// @file workload_t4_o8_n100_l25_a25.cpp
+/// @brief Generated by GenerateWorkload (tests/generator/generate_workload.cpp).
+/// @details threads=4 objects=8 ops=100 lock-ratio=0.25 atomic-ratio=0.25 seed=0
+//--------------------------------------------------------------------------------------------------
+
+#include <atomic>
+#include <pthread.h>
+#include <thread>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+constexpr unsigned int nr_threads = 4;
+constexpr unsigned int nr_objects = 8;
+constexpr unsigned long nr_ops = 100;
+constexpr unsigned int seed = 0;
+
+// Thresholds on a draw from [0, 1000)
+constexpr unsigned int lock_threshold = 250;
+constexpr unsigned int atomic_threshold = 500;
+
+int shared[nr_objects];
+std::atomic<int> atomics[nr_objects];
+pthread_mutex_t mutexes[nr_objects];
+
+void work(const unsigned int index)
+{
+   // Odd, so never 0, which xorshift would never leave
+   unsigned int state = (seed + index) * 2654435761u | 1;
+   for (unsigned long op = 0; op < nr_ops; ++op)
+   {
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+      const unsigned int object = state % nr_objects;
+      const unsigned int kind = (state >> 16) % 1000;
+      if (kind < lock_threshold)
+      {
+         pthread_mutex_lock(&mutexes[object]);
+         shared[object] += 1;
+         pthread_mutex_unlock(&mutexes[object]);
+      }
+      else if (kind < atomic_threshold)
+      {
+         atomics[object].fetch_add(1);
+      }
+      else if (kind % 2 == 0)
+      {
+         shared[object] = static_cast<int>(op);
+      }
+      else
+      {
+         volatile int value = shared[object];
+         (void)value;
+      }
+   }
+}
+
+} // end namespace
+
+//--------------------------------------------------------------------------------------------------
+
+int main()
+{
+   for (auto& mutex : mutexes)
+   {
+      pthread_mutex_init(&mutex, nullptr);
+   }
+   std::vector<std::thread> threads;
+   for (unsigned int index = 0; index < nr_threads; ++index)
+   {
+      threads.emplace_back(work, index);
+   }
+   for (auto& thread : threads)
+   {
+      thread.join();
+   }
+   return 0;
+}
@@ -0,0 +1,54 @@
+//--------------------------------------------------------------------------------------------------
+/// @file nested_spawn.c
+/// @detail Threads spawned by threads other than main, each of which operates on shared memory
+/// as its first visible instruction, before its spawning thread may have registered it.
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+#include <pthread.h>
+
+#define NR_PARENTS 2
+#define NR_CHILDREN 2
+
+pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+int counter = 0;
+
+void* child(void* arg)
+{
+   pthread_mutex_lock(&lock);
+   ++counter;
+   pthread_mutex_unlock(&lock);
+   return NULL;
+}
+
+void* parent(void* arg)
+{
+   pthread_t children[NR_CHILDREN];
+   for (int i = 0; i < NR_CHILDREN; ++i)
+   {
+      pthread_create(&children[i], NULL, child, NULL);
+   }
+   pthread_mutex_lock(&lock);
+   ++counter;
+   pthread_mutex_unlock(&lock);
+   for (int i = 0; i < NR_CHILDREN; ++i)
+   {
+      pthread_join(children[i], NULL);
+   }
+   return NULL;
+}
+
+int main()
+{
+   pthread_t parents[NR_PARENTS];
+   for (int i = 0; i < NR_PARENTS; ++i)
+   {
+      pthread_create(&parents[i], NULL, parent, NULL);
+   }
+   for (int i = 0; i < NR_PARENTS; ++i)
+   {
+      pthread_join(parents[i], NULL);
+   }
+   return counter == NR_PARENTS * (NR_CHILDREN + 1) ? 0 : 1;
+}
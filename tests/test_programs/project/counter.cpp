@@ -0,0 +1,24 @@
+
+#include "counter.hpp"
+
+#include <mutex>
+
+
+namespace {
+
+std::mutex mutex;
+int counter = 0;
+
+} // end namespace
+
+void increment()
+{
+   std::lock_guard<std::mutex> lock(mutex);
+   ++counter;
+}
+
+int count()
+{
+   std::lock_guard<std::mutex> lock(mutex);
+   return counter;
+}
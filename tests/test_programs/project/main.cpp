@@ -0,0 +1,17 @@
+
+#include "counter.hpp"
+
+#include <thread>
+
+
+int nr_runs = 0;
+
+int main()
+{
+   ++nr_runs;
+   const int expected = 2 * nr_runs;
+   std::thread spawn_thread(increment);
+   increment();
+   spawn_thread.join();
+   return count() == expected ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+
+//--------------------------------------------------------------------------------------------------
+/// @file producer_consumer.cpp
+/// @detail A producer hands items to a number of consumers through a bounded buffer, waiting on
+/// condition variables while the buffer is full, resp. empty. Once all items are produced, it
+/// raises a flag on which the consumers spin before they exit.
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#ifndef NR_THREADS
+   #define NR_THREADS 2
+#endif
+
+//--------------------------------------------------------------------------------------------------
+
+struct buffer
+{
+   void put(const int item)
+   {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      while (m_items.size() == 1)
+         m_not_full.wait(lock);
+      m_items.push_back(item);
+      m_not_empty.notify_one();
+   }
+
+   int take()
+   {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      while (m_items.empty())
+         m_not_empty.wait(lock);
+      const int item = m_items.front();
+      m_items.pop_front();
+      m_not_full.notify_one();
+      return item;
+   }
+
+private:
+   std::mutex m_mutex;
+   std::condition_variable m_not_full;
+   std::condition_variable m_not_empty;
+   std::deque<int> m_items;
+
+}; // end struct buffer
+
+//--------------------------------------------------------------------------------------------------
+
+std::atomic<bool> done{false};
+
+/// @brief Consumer thread start routine
+
+void consumer(buffer& shared_buffer)
+{
+   shared_buffer.take();
+   while (!done.load())
+      ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int main()
+{
+   buffer shared_buffer;
+   std::array<std::thread, NR_THREADS> consumers;
+
+   for (auto& consumer_thread : consumers)
+   {
+      consumer_thread = std::thread(consumer, std::ref(shared_buffer));
+   }
+
+   for (int item = 0; item < NR_THREADS; ++item)
+   {
+      shared_buffer.put(item);
+   }
+   done.store(true);
+
+   for (auto& consumer_thread : consumers)
+   {
+      consumer_thread.join();
+   }
+
+   return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
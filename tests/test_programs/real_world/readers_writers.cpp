@@ -0,0 +1,99 @@
+
+//--------------------------------------------------------------------------------------------------
+/// @file readers_writers.cpp
+/// @detail A number of readers and a writer share a table protected by a readers-writer lock.
+/// The readers hold the lock shared at the same time, the writer excludes them. Each reader also
+/// counts its reads in a statistic that it only updates if its mutex is free.
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+#include <array>
+#include <thread>
+
+#ifndef NR_THREADS
+   #define NR_THREADS 2
+#endif
+
+//--------------------------------------------------------------------------------------------------
+
+struct table
+{
+   table() { pthread_rwlock_init(&m_lock, NULL); }
+
+   int read(const unsigned int index)
+   {
+      pthread_rwlock_rdlock(&m_lock);
+      const int value = m_values[index % NR_THREADS];
+      pthread_rwlock_unlock(&m_lock);
+      return value;
+   }
+
+   void write(const unsigned int index, const int value)
+   {
+      pthread_rwlock_wrlock(&m_lock);
+      m_values[index % NR_THREADS] = value;
+      pthread_rwlock_unlock(&m_lock);
+   }
+
+private:
+   pthread_rwlock_t m_lock;
+   std::array<int, NR_THREADS> m_values{};
+
+}; // end struct table
+
+//--------------------------------------------------------------------------------------------------
+
+struct statistic
+{
+   statistic() { pthread_mutex_init(&m_mutex, NULL); }
+
+   void count()
+   {
+      if (pthread_mutex_trylock(&m_mutex) == 0)
+      {
+         ++m_nr_counted;
+         pthread_mutex_unlock(&m_mutex);
+      }
+   }
+
+private:
+   pthread_mutex_t m_mutex;
+   unsigned int m_nr_counted = 0;
+
+}; // end struct statistic
+
+//--------------------------------------------------------------------------------------------------
+
+/// @brief Reader thread start routine
+
+void reader(const unsigned int id, table& shared_table, statistic& reads)
+{
+   shared_table.read(id);
+   reads.count();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int main()
+{
+   table shared_table;
+   statistic reads;
+   std::array<std::thread, NR_THREADS> readers;
+
+   for (unsigned int id = 0; id < NR_THREADS; ++id)
+   {
+      readers[id] = std::thread(reader, id, std::ref(shared_table), std::ref(reads));
+   }
+
+   shared_table.write(0, 1);
+
+   for (auto& reader : readers)
+   {
+      reader.join();
+   }
+
+   return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
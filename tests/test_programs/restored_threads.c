@@ -0,0 +1,62 @@
+//--------------------------------------------------------------------------------------------------
+/// @file restored_threads.c
+/// @detail Workers that keep values in their frame across visible instructions and return from
+/// their start routine. Run from a checkpoint, it only exits with 0 if the frames of the threads
+/// that were re-created in the branch survived.
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+#include <pthread.h>
+#include <stdint.h>
+
+#define NR_THREADS 3
+#define NR_VALUES 4
+
+pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+int total = 0;
+int sums[NR_THREADS];
+
+void* work(void* arg)
+{
+   const int id = (int)(intptr_t)arg;
+   int values[NR_VALUES];
+   for (int i = 0; i < NR_VALUES; ++i)
+   {
+      values[i] = 100 * id + i;
+   }
+   for (int i = 0; i < NR_VALUES; ++i)
+   {
+      pthread_mutex_lock(&lock);
+      total += values[i];
+      pthread_mutex_unlock(&lock);
+   }
+   int sum = 0;
+   for (int i = 0; i < NR_VALUES; ++i)
+   {
+      sum += values[i];
+   }
+   sums[id] = sum;
+   return NULL;
+}
+
+int main()
+{
+   pthread_t threads[NR_THREADS];
+   for (int id = 0; id < NR_THREADS; ++id)
+   {
+      pthread_create(&threads[id], NULL, work, (void*)(intptr_t)id);
+   }
+   int expected_total = 0;
+   for (int id = 0; id < NR_THREADS; ++id)
+   {
+      pthread_join(threads[id], NULL);
+      const int expected = NR_VALUES * 100 * id + NR_VALUES * (NR_VALUES - 1) / 2;
+      if (sums[id] != expected)
+      {
+         return 1;
+      }
+      expected_total += expected;
+   }
+   return total == expected_total ? 0 : 1;
+}
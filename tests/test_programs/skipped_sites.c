@@ -0,0 +1,39 @@
+//--------------------------------------------------------------------------------------------------
+/// @file skipped_sites.c
+/// @detail Writes that the inlined prologues skip: by a thread that sets the scheduler's
+/// wrapper_thread_uncontrolled flag itself, as the scheduler does once it stops controlling the
+/// execution, and in write_disabled, when run with the sites of that function disabled.
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+#include <pthread.h>
+
+extern __thread unsigned char wrapper_thread_uncontrolled
+   __attribute__((tls_model("initial-exec")));
+
+int hidden = 0;
+int disabled = 0;
+int visible = 0;
+
+void write_disabled()
+{
+   disabled = 1;
+}
+
+void* uncontrolled(void* arg)
+{
+   wrapper_thread_uncontrolled = 1;
+   hidden = 1;
+   return NULL;
+}
+
+int main()
+{
+   pthread_t thread;
+   pthread_create(&thread, NULL, uncontrolled, NULL);
+   pthread_join(thread, NULL);
+   write_disabled();
+   visible = 1;
+   return hidden + disabled + visible == 3 ? 0 : 1;
+}
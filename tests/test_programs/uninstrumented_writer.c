@@ -0,0 +1,32 @@
+//--------------------------------------------------------------------------------------------------
+/// @file uninstrumented_writer.c
+/// @detail The main thread spins until the writer sets flag. Run with the sites of set_flag
+/// disabled, the scheduler does not see the store that ends the spin loop.
+/// @author Susanne van den Elsen
+/// @date 2017
+//--------------------------------------------------------------------------------------------------
+
+#include <pthread.h>
+
+pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+int flag = 0;
+
+void* set_flag(void* arg)
+{
+   // Lock sites always post, so the writer only runs once it is scheduled
+   pthread_mutex_lock(&lock);
+   pthread_mutex_unlock(&lock);
+   flag = 1;
+   return NULL;
+}
+
+int main()
+{
+   pthread_t writer;
+   pthread_create(&writer, NULL, set_flag, NULL);
+   while (!flag)
+   {
+   }
+   pthread_join(writer, NULL);
+   return 0;
+}